@@ -21,36 +21,234 @@
 #include <stdlib.h>
 #include <string.h>
 
+static const char BASE64_ENCODE_TABLE[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// 0xFF marks characters outside the base64 alphabet.
+static const unsigned char BASE64_DECODE_TABLE[256] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x3E, 0xFF, 0xFF, 0xFF, 0x3F,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
+    0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10, 0x11, 0x12,
+    0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24,
+    0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30,
+    0x31, 0x32, 0x33, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF};
+
 unsigned char base64_value_to_base64(unsigned char value) {
-  if (value <= 25) {
-    return value + 'A';
-  } else if (value >= 26 && value <= 51) {
-    return (value - 26) + 'a';
-  } else if (value >= 52 && value <= 61) {
-    return (value - 52) + '0';
-  } else if (value == 62) {
-    return '+';
-  } else if (value == 63) {
-    return '/';
-  } else {
+  if (value > 63) {
     return '=';
   }
+  return (unsigned char)BASE64_ENCODE_TABLE[value];
 }
 
 unsigned char base64_base64_to_value(unsigned char b64) {
-  if (b64 >= 'A' && b64 <= 'Z') {
-    return b64 - 'A';
-  } else if (b64 >= 'a' && b64 <= 'z') {
-    return b64 - 'a' + 26;
-  } else if (b64 >= '0' && b64 <= '9') {
-    return b64 - '0' + 52;
-  } else if (b64 == '+') {
-    return 62;
-  } else if (b64 == '/') {
-    return 63;
-  } else {
-    return 0xFF;
+  return BASE64_DECODE_TABLE[b64];
+}
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define BASE64_HAS_X86_SIMD 1
+
+#include <immintrin.h>
+
+// 0 - scalar, 1 - SSSE3, 2 - AVX2. Racing initialization is benign; every
+// thread computes the same value.
+static int base64_simd_level(void) {
+  static int level = -1;
+  if (level < 0) {
+    if (__builtin_cpu_supports("avx2")) {
+      level = 2;
+    } else if (__builtin_cpu_supports("ssse3")) {
+      level = 1;
+    } else {
+      level = 0;
+    }
+  }
+  return level;
+}
+
+// Encode translation (W. Mula): index the per-range offset by
+// saturating-subtracting 51 (isolates 52..63) and bumping by one for
+// values above 25, then add the offset to the value.
+__attribute__((target("ssse3"))) static void base64_encode_translate_ssse3(
+    const unsigned char *values, size_t count, char *out) {
+  const __m128i offsets =
+      _mm_setr_epi8('A', 'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                    '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                    '0' - 52, '+' - 62, '/' - 63, 0, 0);
+  size_t idx = 0;
+  for (; idx + 16 <= count; idx += 16) {
+    const __m128i in = _mm_loadu_si128((const __m128i *)(values + idx));
+    __m128i indices = _mm_subs_epu8(in, _mm_set1_epi8(51));
+    const __m128i gt25 = _mm_cmpgt_epi8(in, _mm_set1_epi8(25));
+    indices = _mm_sub_epi8(indices, gt25);
+    const __m128i result =
+        _mm_add_epi8(in, _mm_shuffle_epi8(offsets, indices));
+    _mm_storeu_si128((__m128i *)(out + idx), result);
+  }
+  for (; idx < count; ++idx) {
+    out[idx] = BASE64_ENCODE_TABLE[values[idx] & 63];
+  }
+}
+
+__attribute__((target("avx2"))) static void base64_encode_translate_avx2(
+    const unsigned char *values, size_t count, char *out) {
+  const __m256i offsets = _mm256_broadcastsi128_si256(
+      _mm_setr_epi8('A', 'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                    '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                    '0' - 52, '+' - 62, '/' - 63, 0, 0));
+  size_t idx = 0;
+  for (; idx + 32 <= count; idx += 32) {
+    const __m256i in = _mm256_loadu_si256((const __m256i *)(values + idx));
+    __m256i indices = _mm256_subs_epu8(in, _mm256_set1_epi8(51));
+    const __m256i gt25 = _mm256_cmpgt_epi8(in, _mm256_set1_epi8(25));
+    indices = _mm256_sub_epi8(indices, gt25);
+    const __m256i result =
+        _mm256_add_epi8(in, _mm256_shuffle_epi8(offsets, indices));
+    _mm256_storeu_si256((__m256i *)(out + idx), result);
+  }
+  for (; idx < count; ++idx) {
+    out[idx] = BASE64_ENCODE_TABLE[values[idx] & 63];
+  }
+}
+
+// Decode translation (W. Mula): per-nibble LUTs flag characters outside the
+// alphabet, and a roll offset selected by the high nibble (adjusted for '/')
+// maps each char to its 6-bit value. Blocks containing an invalid char fall
+// back to the table so 0xFF positions match the scalar path.
+__attribute__((target("ssse3"))) static int base64_decode_translate_ssse3(
+    const char *b64, size_t count, unsigned char *out) {
+  const __m128i lut_lo =
+      _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                    0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+  const __m128i lut_hi =
+      _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10,
+                    0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0,
+                                         0, 0, 0, 0, 0, 0, 0);
+  int invalid = 0;
+  size_t idx = 0;
+  for (; idx + 16 <= count; idx += 16) {
+    const __m128i in = _mm_loadu_si128((const __m128i *)(b64 + idx));
+    const __m128i hi_nibbles =
+        _mm_and_si128(_mm_srli_epi32(in, 4), _mm_set1_epi8(0x0F));
+    const __m128i lo_nibbles = _mm_and_si128(in, _mm_set1_epi8(0x0F));
+    const __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+    const __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+    if (_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_and_si128(lo, hi),
+                                         _mm_setzero_si128())) != 0) {
+      invalid = 1;
+      for (size_t sub_idx = idx; sub_idx < idx + 16; ++sub_idx) {
+        out[sub_idx] = BASE64_DECODE_TABLE[(unsigned char)b64[sub_idx]];
+      }
+      continue;
+    }
+    const __m128i eq_2f = _mm_cmpeq_epi8(in, _mm_set1_epi8(0x2F));
+    const __m128i roll =
+        _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles));
+    _mm_storeu_si128((__m128i *)(out + idx), _mm_add_epi8(in, roll));
+  }
+  for (; idx < count; ++idx) {
+    out[idx] = BASE64_DECODE_TABLE[(unsigned char)b64[idx]];
+    if (out[idx] == 0xFF) {
+      invalid = 1;
+    }
+  }
+  return invalid;
+}
+
+__attribute__((target("avx2"))) static int base64_decode_translate_avx2(
+    const char *b64, size_t count, unsigned char *out) {
+  const __m256i lut_lo = _mm256_broadcastsi128_si256(
+      _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                    0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A));
+  const __m256i lut_hi = _mm256_broadcastsi128_si256(
+      _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10,
+                    0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10));
+  const __m256i lut_roll = _mm256_broadcastsi128_si256(_mm_setr_epi8(
+      0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0));
+  int invalid = 0;
+  size_t idx = 0;
+  for (; idx + 32 <= count; idx += 32) {
+    const __m256i in = _mm256_loadu_si256((const __m256i *)(b64 + idx));
+    const __m256i hi_nibbles =
+        _mm256_and_si256(_mm256_srli_epi32(in, 4), _mm256_set1_epi8(0x0F));
+    const __m256i lo_nibbles = _mm256_and_si256(in, _mm256_set1_epi8(0x0F));
+    const __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+    const __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+    if (_mm256_movemask_epi8(_mm256_cmpgt_epi8(
+            _mm256_and_si256(lo, hi), _mm256_setzero_si256())) != 0) {
+      invalid = 1;
+      for (size_t sub_idx = idx; sub_idx < idx + 32; ++sub_idx) {
+        out[sub_idx] = BASE64_DECODE_TABLE[(unsigned char)b64[sub_idx]];
+      }
+      continue;
+    }
+    const __m256i eq_2f = _mm256_cmpeq_epi8(in, _mm256_set1_epi8(0x2F));
+    const __m256i roll =
+        _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles));
+    _mm256_storeu_si256((__m256i *)(out + idx), _mm256_add_epi8(in, roll));
+  }
+  for (; idx < count; ++idx) {
+    out[idx] = BASE64_DECODE_TABLE[(unsigned char)b64[idx]];
+    if (out[idx] == 0xFF) {
+      invalid = 1;
+    }
+  }
+  return invalid;
+}
+
+#endif  // defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+
+void base64_values_to_base64_bulk(const unsigned char *values, size_t count,
+                                  char *out) {
+#ifdef BASE64_HAS_X86_SIMD
+  const int level = base64_simd_level();
+  if (level == 2) {
+    base64_encode_translate_avx2(values, count, out);
+    return;
+  } else if (level == 1) {
+    base64_encode_translate_ssse3(values, count, out);
+    return;
+  }
+#endif
+  for (size_t idx = 0; idx < count; ++idx) {
+    out[idx] = BASE64_ENCODE_TABLE[values[idx] & 63];
+  }
+}
+
+int base64_base64_to_values_bulk(const char *b64, size_t count,
+                                 unsigned char *out) {
+#ifdef BASE64_HAS_X86_SIMD
+  const int level = base64_simd_level();
+  if (level == 2) {
+    return base64_decode_translate_avx2(b64, count, out);
+  } else if (level == 1) {
+    return base64_decode_translate_ssse3(b64, count, out);
+  }
+#endif
+  int invalid = 0;
+  for (size_t idx = 0; idx < count; ++idx) {
+    out[idx] = BASE64_DECODE_TABLE[(unsigned char)b64[idx]];
+    if (out[idx] == 0xFF) {
+      invalid = 1;
+    }
   }
+  return invalid;
 }
 
 char *base64_number_str_to_base64_str(const char *n_str) {
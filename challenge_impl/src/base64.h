@@ -17,6 +17,8 @@
 #ifndef SEODISPARATE_COM_POOR_MANS_ANUBIS_BASE64_H_
 #define SEODISPARATE_COM_POOR_MANS_ANUBIS_BASE64_H_
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -25,6 +27,18 @@ unsigned char base64_value_to_base64(unsigned char value);
 
 unsigned char base64_base64_to_value(unsigned char b64);
 
+// Bulk translation between 6-bit values and base64 characters. On x86_64 an
+// AVX2 or SSSE3 kernel is picked at runtime; other targets (and short
+// tails) use a branchless table fallback. In-place use (out == values) is
+// allowed.
+void base64_values_to_base64_bulk(const unsigned char *values, size_t count,
+                                  char *out);
+
+// Returns 0 on success, nonzero if any input char was not in the base64
+// alphabet; invalid positions in out are set to 0xFF.
+int base64_base64_to_values_bulk(const char *b64, size_t count,
+                                 unsigned char *out);
+
 // Returned ptr must be free'd.
 char *base64_number_str_to_base64_str(const char *);
 
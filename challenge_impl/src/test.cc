@@ -140,6 +140,93 @@ int main() {
         CHECK_TRUE(vec.at(7) == 'V');
     }
 
+    // Test limbs_bit_length/limbs_b64_digit_count
+    {
+        std::vector<uint64_t> limbs{1};
+        CHECK_TRUE(limbs_bit_length(limbs) == 1);
+        CHECK_TRUE(limbs_b64_digit_count(limbs) == 1);
+
+        limbs = {0x8000000000000000ULL, 1};
+        CHECK_TRUE(limbs_bit_length(limbs) == 65);
+        CHECK_TRUE(limbs_b64_digit_count(limbs) == 11);
+    }
+
+    // Test mult_limbs_scalar and serialization against the b64 digit helpers
+    {
+        std::vector<uint64_t> limbs{1};
+        std::vector<char> digits{'B'};
+        const unsigned int factors[] = {59, 53, 47, 43, 41, 37, 31, 29, 23,
+                                        19, 17, 13, 11, 7,  5,  3,  2,  59,
+                                        53, 47, 43, 41, 37, 31, 29, 23, 19};
+        for (unsigned int f : factors) {
+            mult_limbs_scalar(limbs, f);
+            mult_b64_scalar(digits, f);
+        }
+        CHECK_TRUE(limbs_b64_digit_count(limbs) == digits.size());
+
+        Work_Factors wf;
+        wf.value = nullptr;
+        wf.value2 = &limbs;
+        wf.factors = nullptr;
+        uint64_t len = 0;
+        char *str = work_factors2_value_to_str(wf, &len);
+        CHECK_TRUE(len == digits.size());
+        bool digits_match = true;
+        for (size_t idx = 0; idx < digits.size() && idx < len; ++idx) {
+            if (str[idx] != digits.at(idx)) {
+                digits_match = false;
+                break;
+            }
+        }
+        CHECK_TRUE(digits_match);
+        std::free(str);
+    }
+
+    // Test base64 bulk translation against the per-char functions
+    {
+        unsigned char values[100];
+        char encoded[100];
+        unsigned char decoded[100];
+        for (size_t idx = 0; idx < 100; ++idx) {
+            values[idx] = static_cast<unsigned char>(idx % 64);
+        }
+        base64_values_to_base64_bulk(values, 100, encoded);
+        bool encode_matches = true;
+        for (size_t idx = 0; idx < 100; ++idx) {
+            if (static_cast<unsigned char>(encoded[idx]) !=
+                    base64_value_to_base64(values[idx])) {
+                encode_matches = false;
+                break;
+            }
+        }
+        CHECK_TRUE(encode_matches);
+
+        CHECK_TRUE(base64_base64_to_values_bulk(encoded, 100, decoded) == 0);
+        bool roundtrip_matches = true;
+        for (size_t idx = 0; idx < 100; ++idx) {
+            if (decoded[idx] != values[idx]) {
+                roundtrip_matches = false;
+                break;
+            }
+        }
+        CHECK_TRUE(roundtrip_matches);
+
+        // In-place encode is supported.
+        unsigned char inplace[100];
+        std::memcpy(inplace, values, 100);
+        base64_values_to_base64_bulk(inplace, 100,
+                                     reinterpret_cast<char *>(inplace));
+        CHECK_TRUE(std::memcmp(inplace, encoded, 100) == 0);
+
+        // Invalid chars are reported and marked 0xFF without disturbing
+        // neighboring positions.
+        encoded[50] = '=';
+        CHECK_TRUE(base64_base64_to_values_bulk(encoded, 100, decoded) != 0);
+        CHECK_TRUE(decoded[50] == 0xFF);
+        CHECK_TRUE(decoded[49] == values[49]);
+        CHECK_TRUE(decoded[51] == values[51]);
+    }
+
     std::cerr << "Passed: " << passed.load() << "\n";
     std::cerr << "Tested: " << tested.load() << std::endl;
     return passed.load() == tested.load() ? 0 : 1;
@@ -18,6 +18,7 @@ extern "C" {
 #include <data_structures/priority_heap.h>
 }
 
+#include <bit>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
@@ -148,6 +149,40 @@ void mult_b64_scalar(std::vector<char> &a, unsigned int scalar) {
   }
 }
 
+// 64-bit limb (little-endian) arithmetic used for challenge generation.
+// The value stays in limb form while multiplying and is converted to base64
+// digits only at serialization time in work_factors2_value_to_str.
+
+uint64_t limbs_bit_length(const std::vector<uint64_t> &limbs) {
+  if (limbs.empty()) {
+    return 0;
+  }
+  // The most significant limb is kept non-zero.
+  return (limbs.size() - 1) * 64 +
+         (64 - static_cast<uint64_t>(std::countl_zero(limbs.back())));
+}
+
+uint64_t limbs_b64_digit_count(const std::vector<uint64_t> &limbs) {
+  const uint64_t bits = limbs_bit_length(limbs);
+  if (bits == 0) {
+    return 1;
+  }
+  return (bits - 1) / 6 + 1;
+}
+
+void mult_limbs_scalar(std::vector<uint64_t> &limbs, uint64_t scalar) {
+  unsigned __int128 carry = 0;
+  for (size_t idx = 0; idx < limbs.size(); ++idx) {
+    const unsigned __int128 prod =
+        static_cast<unsigned __int128>(limbs[idx]) * scalar + carry;
+    limbs[idx] = static_cast<uint64_t>(prod);
+    carry = prod >> 64;
+  }
+  if (carry != 0) {
+    limbs.push_back(static_cast<uint64_t>(carry));
+  }
+}
+
 Work_Factors work_generate_target_factors2(uint64_t quads) {
   {
     srand(std::random_device()());
@@ -155,12 +190,12 @@ Work_Factors work_generate_target_factors2(uint64_t quads) {
 
   Work_Factors wf;
   wf.value = nullptr;
-  wf.value2 = std::malloc(sizeof(std::vector<char>));
-  std::vector<char> *b64 = new (wf.value2) std::vector<char>();
-  b64->push_back('B');
+  wf.value2 = std::malloc(sizeof(std::vector<uint64_t>));
+  std::vector<uint64_t> *limbs = new (wf.value2) std::vector<uint64_t>();
+  limbs->push_back(1);
   wf.factors = simple_archiver_priority_heap_init();
 
-  while (b64->size() / 4 < quads) {
+  while (limbs_b64_digit_count(*limbs) / 4 < quads) {
     int r = rand();
     if (r < 0) {
       r = -r;
@@ -221,14 +256,14 @@ Work_Factors work_generate_target_factors2(uint64_t quads) {
     uint16_t *ptr = static_cast<uint16_t *>(std::malloc(2));
     *ptr = static_cast<uint16_t>(r);
     simple_archiver_priority_heap_insert(wf.factors, r, ptr, nullptr);
-    mult_b64_scalar(*b64, r);
+    mult_limbs_scalar(*limbs, static_cast<uint64_t>(r));
   }
 
-  while (b64->size() % 4 != 0) {
+  while (limbs_b64_digit_count(*limbs) % 4 != 0) {
     uint16_t *ptr = static_cast<uint16_t *>(std::malloc(2));
     *ptr = 2;
     simple_archiver_priority_heap_insert(wf.factors, 2, ptr, nullptr);
-    mult_b64_scalar(*b64, 2);
+    mult_limbs_scalar(*limbs, 2);
   }
 
   return wf;
@@ -237,7 +272,7 @@ Work_Factors work_generate_target_factors2(uint64_t quads) {
 void work_cleanup_factors2(Work_Factors *wf2) {
   if (wf2) {
     if (wf2->value2) {
-      reinterpret_cast<std::vector<char> *>(wf2->value2)->~vector();
+      reinterpret_cast<std::vector<uint64_t> *>(wf2->value2)->~vector();
       std::free(wf2->value2);
       wf2->value2 = nullptr;
     }
@@ -248,15 +283,31 @@ void work_cleanup_factors2(Work_Factors *wf2) {
 }
 
 char *work_factors2_value_to_str(Work_Factors wf2, uint64_t *len_out) {
-  const std::vector<char> *b64 =
-      reinterpret_cast<std::vector<char> *>(wf2.value2);
+  const std::vector<uint64_t> *limbs =
+      reinterpret_cast<std::vector<uint64_t> *>(wf2.value2);
+  const uint64_t digit_count = limbs_b64_digit_count(*limbs);
   if (len_out) {
-    *len_out = b64->size();
+    *len_out = digit_count;
   }
 
-  char *ret = reinterpret_cast<char *>(std::malloc(b64->size() + 1));
-  std::memcpy(ret, b64->data(), b64->size());
-  ret[b64->size()] = 0;
+  // Digits are serialized least-significant first, 6 bits per digit, same as
+  // the digit-vector representation this replaced. Raw 6-bit values are
+  // extracted first, then translated to the alphabet in one in-place bulk
+  // pass (SIMD where available).
+  char *ret = reinterpret_cast<char *>(std::malloc(digit_count + 1));
+  for (uint64_t didx = 0; didx < digit_count; ++didx) {
+    const uint64_t bit = didx * 6;
+    const size_t limb_idx = static_cast<size_t>(bit / 64);
+    const uint64_t shift = bit % 64;
+    uint64_t value = limbs->at(limb_idx) >> shift;
+    if (shift > 58 && limb_idx + 1 < limbs->size()) {
+      value |= limbs->at(limb_idx + 1) << (64 - shift);
+    }
+    ret[didx] = static_cast<char>(value & 63);
+  }
+  base64_values_to_base64_bulk(reinterpret_cast<unsigned char *>(ret),
+                               digit_count, ret);
+  ret[digit_count] = 0;
   return ret;
 }
 
@@ -1,141 +1,660 @@
+// Load-generation harness for cxx_backend. Drives N concurrent connections
+// from a single epoll loop with a configurable mix of challenge-page
+// fetches, full challenge solves (GET page -> GET factors.js -> solve ->
+// POST answer), and plain forwarded GETs. Challenges are solved with the
+// same trial-division-over-base64 algorithm as the client worker JS, on
+// dedicated solver threads so solving never stalls the I/O loop. Reports
+// throughput and p50/p95/p99 latency per request class on exit.
+//
+// Run the server with a small --factors value (e.g. --factors=10) when load
+// testing; the default difficulty makes each solve take minutes by design.
+
 #include "../src/http.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
 #include <cstring>
+#include <deque>
+#include <format>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
 #include <thread>
+#include <vector>
 
+#include <errno.h>
+#include <sys/epoll.h>
 #include <unistd.h>
-#include <poll.h>
 
+#include "../src/helpers.h"
 #include "../src/poor_mans_print.h"
 
+#include "base64.h"
+
 void print_usage() {
-  PMA_Println("./program ( --cli-ipv4=0.0.0.0 | --cli-ipv6=:: ) ( --ser-ipv4=0.0.0.0 | --ser-ipv6=:: ) --port=9000");
+  PMA_Println("Args:");
+  PMA_Println("  --addr=<addr> : Server address (ipv4 or ipv6)");
+  PMA_Println("  --client-addr=<addr> : Local address to bind (default "
+              "0.0.0.0 or ::)");
+  PMA_Println("  --port=<port> : Server port");
+  PMA_Println("  --connections=<count> : Concurrent connections (default 8)");
+  PMA_Println("  --duration=<seconds> : Run time (default 10)");
+  PMA_Println(
+      "  --mix=<page>:<challenge>:<forward> : Request class weights "
+      "(default 4:1:4)");
+  PMA_Println("  --url=<url> : URL for page/forward requests (default \"/\")");
+  PMA_Println(
+      "  --api-url=<url> : Server answer endpoint (default \"/pma_api/\")");
+  PMA_Println(
+      "  --js-factors-url=<url> : Server worker-js endpoint (default "
+      "\"/pma_factors.js\")");
+  PMA_Println("  --solver-threads=<count> : Challenge solver threads "
+              "(default 1)");
 }
 
-int main(int argc, char **argv) {
-  int socket_fd = -1;
+enum class ReqClass { PAGE = 0, CHALLENGE = 1, FORWARD = 2, CLASS_COUNT = 3 };
 
-  if (argc != 4) {
-    print_usage();
-    return 0;
+const char *req_class_name(ReqClass req_class) {
+  switch (req_class) {
+    case ReqClass::PAGE:
+      return "page";
+    case ReqClass::CHALLENGE:
+      return "challenge";
+    case ReqClass::FORWARD:
+      return "forward";
+    default:
+      return "unknown";
   }
+}
 
+struct HarnessArgs {
+  std::string addr;
+  std::string client_addr;
+  std::string url = "/";
+  std::string api_url = "/pma_api/";
+  std::string js_factors_url = "/pma_factors.js";
   uint16_t port = 0;
+  uint32_t connections = 8;
+  uint32_t duration_seconds = 10;
+  uint32_t solver_threads = 1;
+  std::array<uint32_t, 3> mix = {4, 1, 4};
+  bool is_ipv6 = false;
+  bool valid = false;
+};
 
-  if (std::strncmp(argv[3], "--port=", 7) == 0) {
-    int to_port = std::atoi(argv[3] + 7);
-    if (to_port < 0 || to_port > 0xFFFF) {
-      PMA_Println("Invalid --port={} !", to_port);
-      print_usage();
-      return 1;
+std::optional<HarnessArgs> parse_harness_args(int argc, char **argv) {
+  HarnessArgs args;
+  for (int idx = 1; idx < argc; ++idx) {
+    if (std::strncmp(argv[idx], "--addr=", 7) == 0) {
+      args.addr = argv[idx] + 7;
+    } else if (std::strncmp(argv[idx], "--client-addr=", 14) == 0) {
+      args.client_addr = argv[idx] + 14;
+    } else if (std::strncmp(argv[idx], "--port=", 7) == 0) {
+      int to_port = std::atoi(argv[idx] + 7);
+      if (to_port <= 0 || to_port > 0xFFFF) {
+        PMA_EPrintln("Invalid --port={} !", to_port);
+        return std::nullopt;
+      }
+      args.port = static_cast<uint16_t>(to_port);
+    } else if (std::strncmp(argv[idx], "--connections=", 14) == 0) {
+      args.connections = static_cast<uint32_t>(std::atoi(argv[idx] + 14));
+    } else if (std::strncmp(argv[idx], "--duration=", 11) == 0) {
+      args.duration_seconds = static_cast<uint32_t>(std::atoi(argv[idx] + 11));
+    } else if (std::strncmp(argv[idx], "--solver-threads=", 17) == 0) {
+      args.solver_threads = static_cast<uint32_t>(std::atoi(argv[idx] + 17));
+    } else if (std::strncmp(argv[idx], "--url=", 6) == 0) {
+      args.url = argv[idx] + 6;
+    } else if (std::strncmp(argv[idx], "--api-url=", 10) == 0) {
+      args.api_url = argv[idx] + 10;
+    } else if (std::strncmp(argv[idx], "--js-factors-url=", 17) == 0) {
+      args.js_factors_url = argv[idx] + 17;
+    } else if (std::strncmp(argv[idx], "--mix=", 6) == 0) {
+      const std::string mix(argv[idx] + 6);
+      const size_t first_colon = mix.find(':');
+      const size_t second_colon =
+          first_colon == std::string::npos ? std::string::npos
+                                           : mix.find(':', first_colon + 1);
+      if (second_colon == std::string::npos) {
+        PMA_EPrintln("Invalid --mix=<page>:<challenge>:<forward> !");
+        return std::nullopt;
+      }
+      args.mix.at(0) =
+          static_cast<uint32_t>(std::atoi(mix.substr(0, first_colon).c_str()));
+      args.mix.at(1) = static_cast<uint32_t>(std::atoi(
+          mix.substr(first_colon + 1, second_colon - first_colon - 1)
+              .c_str()));
+      args.mix.at(2) = static_cast<uint32_t>(
+          std::atoi(mix.substr(second_colon + 1).c_str()));
+    } else {
+      PMA_EPrintln("Unknown arg \"{}\"!", argv[idx]);
+      return std::nullopt;
     }
-    port = static_cast<uint16_t>(to_port);
-  } else {
-    PMA_Println("Expected --port=... for second argument.");
-    print_usage();
-    return 1;
   }
 
-  PMA_Println("Using port {}", port);
+  if (args.addr.empty() || args.port == 0 || args.connections == 0 ||
+      args.duration_seconds == 0 ||
+      args.mix.at(0) + args.mix.at(1) + args.mix.at(2) == 0) {
+    return std::nullopt;
+  }
+  args.is_ipv6 = args.addr.find(':') != std::string::npos;
+  if (args.client_addr.empty()) {
+    args.client_addr = args.is_ipv6 ? "::" : "0.0.0.0";
+  }
+  if (args.solver_threads == 0) {
+    args.solver_threads = 1;
+  }
+  args.valid = true;
+  return args;
+}
 
-  if (std::strncmp(argv[1], "--cli-ipv4=", 11) == 0 && std::strncmp(argv[2], "--ser-ipv4=", 11) == 0) {
-    PMA_Println("Using ipv4 addr {}", argv[1] + 11);
-    const auto [err_enum, err_str, ret_socket_fd] = PMA_HTTP::connect_ipv4_socket_client(argv[2] + 11, argv[1] + 11, port);
+////////////////////////////////////////////////////////////////////////////////
+// Challenge solving (same algorithm as the client worker JS).
+////////////////////////////////////////////////////////////////////////////////
 
-    if (err_enum != PMA_HTTP::ErrorT::SUCCESS || ret_socket_fd < 0) {
-      PMA_EPrintln("Error {}: {}", PMA_HTTP::error_t_to_str(err_enum), err_str);
-      if (ret_socket_fd >= 0) {
-        close(ret_socket_fd);
+// Long division of the lsb-first base64 digit string by divisor. Replaces
+// digits with the quotient and returns the remainder.
+uint64_t revb64_long_div_mod(std::vector<uint8_t> &digits, uint64_t divisor) {
+  uint64_t rem = 0;
+  for (size_t idx = digits.size(); idx-- > 0;) {
+    const uint64_t value = rem * 64 + digits.at(idx);
+    digits.at(idx) = static_cast<uint8_t>(value / divisor);
+    rem = value % divisor;
+  }
+  while (digits.size() > 1 && digits.back() == 0) {
+    digits.pop_back();
+  }
+  return rem;
+}
+
+// Factors the challenge number (lsb-first base64 digit string) by trial
+// division and returns the canonical "NxM NxM ..." answer text.
+std::string solve_challenge(const std::string &challenge) {
+  std::vector<uint8_t> digits;
+  digits.reserve(challenge.size());
+  for (const char c : challenge) {
+    digits.push_back(base64_base64_to_value(static_cast<unsigned char>(c)));
+  }
+  while (digits.size() > 1 && digits.back() == 0) {
+    digits.pop_back();
+  }
+  if (digits.size() == 1 && digits.at(0) == 0) {
+    // A zero challenge has no factorization; don't loop on it.
+    return {};
+  }
+
+  std::string result;
+  uint64_t current = 2;
+  uint64_t current_count = 0;
+  while (digits.size() > 1 || digits.at(0) != 1) {
+    std::vector<uint8_t> quotient = digits;
+    if (revb64_long_div_mod(quotient, current) == 0) {
+      ++current_count;
+      digits = std::move(quotient);
+    } else {
+      if (current_count != 0) {
+        if (!result.empty()) {
+          result.push_back(' ');
+        }
+        result.append(std::format("{}x{}", current, current_count));
+        current_count = 0;
       }
-      return 1;
+      current = current == 2 ? 3 : current + 2;
     }
-    socket_fd = ret_socket_fd;
-  } else if (std::strncmp(argv[1], "--cli-ipv6=", 11) == 0 && std::strncmp(argv[2], "--ser-ipv6=", 11) == 0) {
-    PMA_Println("Using ipv6 addr {}", argv[1] + 11);
+  }
+  if (current_count != 0) {
+    if (!result.empty()) {
+      result.push_back(' ');
+    }
+    result.append(std::format("{}x{}", current, current_count));
+  }
+  return result;
+}
 
-    const auto [err_enum, err_str, ret_socket_fd] = PMA_HTTP::connect_ipv6_socket_client(argv[2] + 11, argv[1] + 11, port);
+struct SolveJob {
+  size_t conn_idx;
+  std::string challenge;
+};
 
-    if (err_enum != PMA_HTTP::ErrorT::SUCCESS) {
-      PMA_EPrintln("Error {}: {}", PMA_HTTP::error_t_to_str(err_enum), err_str);
-      if (ret_socket_fd >= 0) {
-        close(ret_socket_fd);
+struct SolveResult {
+  size_t conn_idx;
+  std::string factors_str;
+};
+
+struct SolverPool {
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<SolveJob> jobs;
+  std::deque<SolveResult> results;
+  std::atomic_bool stop{false};
+  std::vector<std::thread> threads;
+
+  void start(uint32_t thread_count) {
+    for (uint32_t idx = 0; idx < thread_count; ++idx) {
+      threads.emplace_back([this]() {
+        while (true) {
+          SolveJob job;
+          {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this]() { return stop.load() || !jobs.empty(); });
+            if (stop.load()) {
+              return;
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+          }
+          SolveResult result{job.conn_idx, solve_challenge(job.challenge)};
+          {
+            std::unique_lock<std::mutex> lock(mutex);
+            results.push_back(std::move(result));
+          }
+        }
+      });
+    }
+  }
+
+  void cleanup() {
+    stop.store(true);
+    cv.notify_all();
+    for (std::thread &t : threads) {
+      if (t.joinable()) {
+        t.join();
       }
-      return 1;
     }
-    socket_fd = ret_socket_fd;
-  } else {
-    PMA_Println("Expected --ipv4=... or --ipv6=... as first argument.");
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Connection state machine.
+////////////////////////////////////////////////////////////////////////////////
+
+struct Conn {
+  enum class State { IDLE, CONNECTING, WRITING, READING, SOLVING } state =
+      State::IDLE;
+  int fd = -1;
+  ReqClass req_class = ReqClass::PAGE;
+  // 0 - GET page, 1 - GET factors.js, 2 - POST answer.
+  int challenge_step = 0;
+  std::string out_buf;
+  size_t out_idx = 0;
+  std::string in_buf;
+  std::string challenge_id;
+  std::chrono::steady_clock::time_point start_time;
+};
+
+struct ClassStats {
+  std::vector<double> latencies_ms;
+  uint64_t errors = 0;
+};
+
+// Returns true once in_buf holds a full response (content-length consumed
+// or the chunked terminator seen).
+bool response_is_complete(const std::string &in_buf) {
+  const size_t headers_end = in_buf.find("\r\n\r\n");
+  if (headers_end == std::string::npos) {
+    return false;
+  }
+  const std::string headers =
+      PMA_HELPER::ascii_str_to_lower(in_buf.substr(0, headers_end + 4));
+  if (headers.find("transfer-encoding: chunked") != std::string::npos) {
+    return in_buf.size() >= headers_end + 4 + 5 &&
+           in_buf.compare(in_buf.size() - 5, 5, "0\r\n\r\n") == 0;
+  }
+  size_t content_length = 0;
+  if (const size_t cl_idx = headers.find("content-length:");
+      cl_idx != std::string::npos) {
+    content_length =
+        static_cast<size_t>(std::atoll(headers.c_str() + cl_idx + 15));
+  }
+  return in_buf.size() >= headers_end + 4 + content_length;
+}
+
+std::string response_body(const std::string &in_buf) {
+  const size_t headers_end = in_buf.find("\r\n\r\n");
+  if (headers_end == std::string::npos) {
+    return {};
+  }
+  return in_buf.substr(headers_end + 4);
+}
+
+bool response_is_200(const std::string &in_buf) {
+  const size_t line_end = in_buf.find("\r\n");
+  return line_end != std::string::npos &&
+         in_buf.substr(0, line_end).find(" 200") != std::string::npos;
+}
+
+// Extracts the value between start_marker and end_char, or empty.
+std::string extract_between(const std::string &body,
+                            const std::string &start_marker, char end_char) {
+  const size_t start_idx = body.find(start_marker);
+  if (start_idx == std::string::npos) {
+    return {};
+  }
+  const size_t value_idx = start_idx + start_marker.size();
+  const size_t end_idx = body.find(end_char, value_idx);
+  if (end_idx == std::string::npos) {
+    return {};
+  }
+  return body.substr(value_idx, end_idx - value_idx);
+}
+
+int main(int argc, char **argv) {
+  const std::optional<HarnessArgs> args_opt = parse_harness_args(argc, argv);
+  if (!args_opt.has_value() || !args_opt.value().valid) {
     print_usage();
-    return 0;
-  }
-
-  // Do write.
-  PMA_Println("Start write request");
-  std::string write_req("GET / HTTP/1.1\r\nHost: ");
-  write_req.append(argv[2] + 11);
-  write_req.append("\r\n\r\n");
-  while (true) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
-    ssize_t ret_write = write(socket_fd, write_req.data(), write_req.size());
-    if (ret_write == -1) {
-      if (errno == EAGAIN || errno == EWOULDBLOCK) {
-        continue;
-      } else {
+    return 1;
+  }
+  const HarnessArgs &args = args_opt.value();
+
+  const int epoll_fd = epoll_create1(0);
+  if (epoll_fd == -1) {
+    PMA_EPrintln("ERROR: Failed to create epoll fd, errno {}", errno);
+    return 1;
+  }
+
+  SolverPool solver_pool;
+  solver_pool.start(args.solver_threads);
+
+  std::vector<Conn> conns(args.connections);
+  std::array<ClassStats, static_cast<size_t>(ReqClass::CLASS_COUNT)> stats;
+  const uint32_t mix_total = args.mix.at(0) + args.mix.at(1) + args.mix.at(2);
+  uint64_t mix_counter = 0;
+
+  const auto connect_fn = [&args]() -> int {
+    const auto [err_enum, err_str, socket_fd] =
+        args.is_ipv6 ? PMA_HTTP::connect_ipv6_socket_client(
+                           args.addr, args.client_addr, args.port)
+                     : PMA_HTTP::connect_ipv4_socket_client(
+                           args.addr, args.client_addr, args.port);
+    if (err_enum != PMA_HTTP::ErrorT::SUCCESS) {
+      PMA_EPrintln("ERROR: connect failed: {}", err_str);
+      if (socket_fd >= 0) {
         close(socket_fd);
-        socket_fd = -1;
-        PMA_EPrintln("ERROR: Failed to write to socket, errno {}", errno);
+      }
+      return -1;
+    }
+    return socket_fd;
+  };
+
+  const auto get_request_fn = [&args](const std::string &url) {
+    return std::format("GET {} HTTP/1.1\r\nHost: {}\r\nAccept: */*\r\n\r\n",
+                       url, args.addr);
+  };
+
+  // Starts (or restarts) conns[conn_idx] on a fresh exchange; picks the
+  // next request class by mix weight unless mid-challenge.
+  std::function<void(size_t, bool)> begin_exchange_fn;
+  begin_exchange_fn = [&](size_t conn_idx, bool pick_new_class) {
+    Conn &conn = conns.at(conn_idx);
+    if (pick_new_class) {
+      const uint32_t pick = static_cast<uint32_t>(
+          mix_counter++ % static_cast<uint64_t>(mix_total));
+      if (pick < args.mix.at(0)) {
+        conn.req_class = ReqClass::PAGE;
+      } else if (pick < args.mix.at(0) + args.mix.at(1)) {
+        conn.req_class = ReqClass::CHALLENGE;
+      } else {
+        conn.req_class = ReqClass::FORWARD;
+      }
+      conn.challenge_step = 0;
+      conn.challenge_id.clear();
+      conn.start_time = std::chrono::steady_clock::now();
+    }
+
+    if (conn.req_class == ReqClass::CHALLENGE && conn.challenge_step == 1) {
+      conn.out_buf = get_request_fn(
+          std::format("{}?id={}", args.js_factors_url, conn.challenge_id));
+    } else if (conn.req_class == ReqClass::CHALLENGE &&
+               conn.challenge_step == 2) {
+      // out_buf already holds the POST; leave it.
+    } else {
+      conn.out_buf = get_request_fn(args.url);
+    }
+    conn.out_idx = 0;
+    conn.in_buf.clear();
+
+    if (conn.fd == -1) {
+      conn.fd = connect_fn();
+      if (conn.fd == -1) {
+        ++stats.at(static_cast<size_t>(conn.req_class)).errors;
+        conn.state = Conn::State::IDLE;
+        return;
+      }
+      struct epoll_event event;
+      std::memset(&event, 0, sizeof(event));
+      event.events = EPOLLIN | EPOLLOUT | EPOLLET;
+      event.data.u64 = conn_idx;
+      if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, conn.fd, &event) != 0) {
+        PMA_EPrintln("ERROR: epoll_ctl ADD failed, errno {}", errno);
+        close(conn.fd);
+        conn.fd = -1;
+        conn.state = Conn::State::IDLE;
+        return;
+      }
+    }
+    conn.state = Conn::State::WRITING;
+  };
+
+  const auto drop_conn_fn = [&](size_t conn_idx) {
+    Conn &conn = conns.at(conn_idx);
+    if (conn.fd != -1) {
+      epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn.fd, nullptr);
+      close(conn.fd);
+      conn.fd = -1;
+    }
+  };
+
+  // Drives writes then reads on a conn as far as EAGAIN allows. Returns
+  // true if the in-progress exchange completed.
+  const auto pump_conn_fn = [&](size_t conn_idx) -> bool {
+    Conn &conn = conns.at(conn_idx);
+    while (conn.state == Conn::State::WRITING) {
+      if (conn.out_idx >= conn.out_buf.size()) {
+        conn.state = Conn::State::READING;
         break;
       }
+      const ssize_t written = write(conn.fd, conn.out_buf.data() + conn.out_idx,
+                                    conn.out_buf.size() - conn.out_idx);
+      if (written > 0) {
+        conn.out_idx += static_cast<size_t>(written);
+      } else if (written == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return false;
+      } else {
+        // Server closed a kept-alive conn; reconnect and retry.
+        drop_conn_fn(conn_idx);
+        begin_exchange_fn(conn_idx, false);
+        return false;
+      }
+    }
+
+    while (conn.state == Conn::State::READING) {
+      std::array<char, 4096> buf;
+      const ssize_t amount_read = read(conn.fd, buf.data(), buf.size());
+      if (amount_read > 0) {
+        conn.in_buf.append(buf.data(), static_cast<size_t>(amount_read));
+        if (response_is_complete(conn.in_buf)) {
+          return true;
+        }
+      } else if (amount_read == -1 &&
+                 (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return false;
+      } else {
+        if (response_is_complete(conn.in_buf)) {
+          drop_conn_fn(conn_idx);
+          return true;
+        }
+        drop_conn_fn(conn_idx);
+        begin_exchange_fn(conn_idx, false);
+        return false;
+      }
+    }
+    return false;
+  };
+
+  const auto record_fn = [&](size_t conn_idx) {
+    Conn &conn = conns.at(conn_idx);
+    const double ms =
+        std::chrono::duration_cast<std::chrono::duration<double, std::milli> >(
+            std::chrono::steady_clock::now() - conn.start_time)
+            .count();
+    stats.at(static_cast<size_t>(conn.req_class)).latencies_ms.push_back(ms);
+  };
+
+  // Handles a completed response; advances challenge flows and otherwise
+  // records the sample and begins the next exchange.
+  const auto on_response_fn = [&](size_t conn_idx) {
+    Conn &conn = conns.at(conn_idx);
+    if (conn.req_class != ReqClass::CHALLENGE) {
+      if (response_is_200(conn.in_buf)) {
+        record_fn(conn_idx);
+      } else {
+        ++stats.at(static_cast<size_t>(conn.req_class)).errors;
+      }
+      begin_exchange_fn(conn_idx, true);
+      return;
+    }
+
+    ClassStats &challenge_stats =
+        stats.at(static_cast<size_t>(ReqClass::CHALLENGE));
+    const std::string body = response_body(conn.in_buf);
+    if (conn.challenge_step == 0) {
+      // Challenge page; pull the id from the factors.js link. An id-less
+      // body means this client is already verified, which still counts.
+      conn.challenge_id = extract_between(
+          body, std::format("{}?id=", args.js_factors_url), '"');
+      if (conn.challenge_id.empty()) {
+        record_fn(conn_idx);
+        begin_exchange_fn(conn_idx, true);
+        return;
+      }
+      conn.challenge_step = 1;
+      begin_exchange_fn(conn_idx, false);
+    } else if (conn.challenge_step == 1) {
+      // Worker JS; pull the number and hashed id, then hand off to a
+      // solver thread.
+      const std::string challenge =
+          extract_between(body, "let ret = [ \"", '"');
+      conn.challenge_id = extract_between(body, "\"id\": \"", '"');
+      if (challenge.empty() || conn.challenge_id.empty()) {
+        ++challenge_stats.errors;
+        begin_exchange_fn(conn_idx, true);
+        return;
+      }
+      conn.state = Conn::State::SOLVING;
+      {
+        std::unique_lock<std::mutex> lock(solver_pool.mutex);
+        solver_pool.jobs.push_back(SolveJob{conn_idx, challenge});
+      }
+      solver_pool.cv.notify_one();
     } else {
-      break;
-    }
-  }
-
-  // Read response.
-  PMA_Println("Start read response");
-  while (true) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
-    struct pollfd pfd = {socket_fd, POLLIN, 0};
-    int ret = poll(&pfd, 1, /* milliseconds */ 1000);
-    if (ret == -1) {
-      close(socket_fd);
-      socket_fd = -1;
-      PMA_Println("Error while polling socket_fd, errno {}", errno);
-      break;
-    } else if ((pfd.revents & POLLHUP) != 0 || (pfd.revents & POLLERR) != 0) {
-      PMA_Println("POLLHUP | POLLERR");
-      close(socket_fd);
-      socket_fd = -1;
-      break;
-    } else if ((pfd.revents & POLLIN) != 0) {
-      PMA_Println("POLLIN");
-      std::array<char, 1024> buf{0};
-      ssize_t read_ret = read(socket_fd, buf.data(), buf.size() - 1);
-      if (read_ret == -1) {
-        if (errno == EAGAIN || errno == EWOULDBLOCK) {
-          continue;
-        } else {
-          close(socket_fd);
-          socket_fd = -1;
-          PMA_Println("Error reading from socket, errno {}", errno);
-          break;
+      // Answer POST response.
+      if (response_is_200(conn.in_buf)) {
+        record_fn(conn_idx);
+      } else {
+        ++challenge_stats.errors;
+      }
+      begin_exchange_fn(conn_idx, true);
+    }
+  };
+
+  const auto start_time = std::chrono::steady_clock::now();
+  const auto end_time =
+      start_time + std::chrono::seconds(args.duration_seconds);
+
+  for (size_t conn_idx = 0; conn_idx < conns.size(); ++conn_idx) {
+    begin_exchange_fn(conn_idx, true);
+    if (pump_conn_fn(conn_idx)) {
+      on_response_fn(conn_idx);
+    }
+  }
+
+  std::array<struct epoll_event, 64> events;
+  while (std::chrono::steady_clock::now() < end_time) {
+    const int event_count =
+        epoll_wait(epoll_fd, events.data(), events.size(), 10);
+    for (int event_idx = 0; event_idx < event_count; ++event_idx) {
+      const size_t conn_idx = static_cast<size_t>(
+          events.at(static_cast<size_t>(event_idx)).data.u64);
+      Conn &conn = conns.at(conn_idx);
+      if (conn.state == Conn::State::WRITING ||
+          conn.state == Conn::State::READING) {
+        if (pump_conn_fn(conn_idx)) {
+          on_response_fn(conn_idx);
+        }
+      }
+    }
+
+    // Completed solves turn into answer POSTs.
+    std::deque<SolveResult> done;
+    {
+      std::unique_lock<std::mutex> lock(solver_pool.mutex);
+      done.swap(solver_pool.results);
+    }
+    for (SolveResult &result : done) {
+      Conn &conn = conns.at(result.conn_idx);
+      const std::string json = std::format(
+          "{{\"type\": \"factors\", \"id\": \"{}\", \"factors\": \"{}\"}}",
+          conn.challenge_id, result.factors_str);
+      conn.out_buf = std::format(
+          "POST {} HTTP/1.1\r\nHost: {}\r\nContent-Type: "
+          "application/json\r\nContent-Length: {}\r\n\r\n{}",
+          args.api_url, args.addr, json.size(), json);
+      conn.challenge_step = 2;
+      begin_exchange_fn(result.conn_idx, false);
+      if (pump_conn_fn(result.conn_idx)) {
+        on_response_fn(result.conn_idx);
+      }
+    }
+
+    // Restart conns idled by connect failures.
+    for (size_t conn_idx = 0; conn_idx < conns.size(); ++conn_idx) {
+      if (conns.at(conn_idx).state == Conn::State::IDLE) {
+        begin_exchange_fn(conn_idx, true);
+        if (pump_conn_fn(conn_idx)) {
+          on_response_fn(conn_idx);
         }
-      } else if (read_ret > 0) {
-        buf.at(read_ret) = 0;
-        PMA_Println("Read: {}", buf.data());
-      } else if (read_ret == 0) {
-        PMA_Println("EOF");
-        close(socket_fd);
-        socket_fd = -1;
-        break;
       }
     }
   }
 
-  PMA_Println("End of loop...");
-  std::this_thread::sleep_for(std::chrono::milliseconds(100));
-  if (socket_fd >= 0) {
-    close(socket_fd);
+  solver_pool.cleanup();
+  for (size_t conn_idx = 0; conn_idx < conns.size(); ++conn_idx) {
+    drop_conn_fn(conn_idx);
   }
+  close(epoll_fd);
+
+  const double elapsed_seconds =
+      std::chrono::duration_cast<std::chrono::duration<double> >(
+          std::chrono::steady_clock::now() - start_time)
+          .count();
+
+  PMA_Println("{:<10} {:>8} {:>8} {:>10} {:>10} {:>10} {:>10}", "class",
+              "count", "errors", "req/sec", "p50_ms", "p95_ms", "p99_ms");
+  for (size_t class_idx = 0;
+       class_idx < static_cast<size_t>(ReqClass::CLASS_COUNT); ++class_idx) {
+    ClassStats &class_stats = stats.at(class_idx);
+    std::sort(class_stats.latencies_ms.begin(), class_stats.latencies_ms.end());
+    const size_t count = class_stats.latencies_ms.size();
+    const auto percentile_fn = [&class_stats, count](double fraction) {
+      if (count == 0) {
+        return 0.0;
+      }
+      size_t idx = static_cast<size_t>(fraction * static_cast<double>(count));
+      if (idx >= count) {
+        idx = count - 1;
+      }
+      return class_stats.latencies_ms.at(idx);
+    };
+    PMA_Println("{:<10} {:>8} {:>8} {:>10.1f} {:>10.2f} {:>10.2f} {:>10.2f}",
+                req_class_name(static_cast<ReqClass>(class_idx)), count,
+                class_stats.errors,
+                static_cast<double>(count) / elapsed_seconds,
+                percentile_fn(0.50), percentile_fn(0.95), percentile_fn(0.99));
+  }
+
   return 0;
 }
@@ -24,6 +24,7 @@
 
 // local includes
 #include "constants.h"
+#include "helpers.h"
 #include "poor_mans_print.h"
 
 void pma_print_usage() {
@@ -34,6 +35,11 @@ void pma_print_usage() {
   PMA_Println(
       "  --factors=<quads> : Generate factors challenge with <quads> 24-bit "
       "segments");
+  PMA_Println(
+      "  --factors-band=<min>:<max> : Enable adaptive difficulty; issued "
+      "challenges use between <min> and <max> quads depending on measured "
+      "solve times and load");
+  PMA_Println("    example: \"--factors-band=1100:4400\"");
   PMA_Println("  --dest-url=<url> : Destination URL for verified clients;");
   PMA_Println("    example: \"--dest-url=http://127.0.0.1:9999\"");
   PMA_Println("  --addr-port=<addr>:<port> : Listening addr/port;");
@@ -44,6 +50,16 @@ void pma_print_usage() {
   PMA_Println(
       "  NOTE: There is no longer a hard limit on the number of ports one can "
       "listen to");
+  PMA_Println(
+      "  --peer-listen=<addr>:<port> : UDP addr/port to receive peer-sync "
+      "datagrams on; enables fleet-wide sharing of verified clients");
+  PMA_Println("    example: \"--peer-listen=10.0.0.1:7070\"");
+  PMA_Println(
+      "  --peer=<addr>:<port> : Peer instance to notify of verified clients;");
+  PMA_Println("    example: \"--peer=10.0.0.2:7070\"");
+  PMA_Println(
+      "  NOTICE: Specify --peer=... multiple times for more peers; the peer "
+      "port must only be reachable from the fleet's own network");
   PMA_Println(
       "  --port-to-dest-url=<port>:<url> : Ensure requests from listening on "
       "<port> is forwarded to <url>");
@@ -61,6 +77,10 @@ void pma_print_usage() {
   PMA_Println(
       "  --api-url=<url> : Set endpoint for client to POST to this software;");
   PMA_Println("    example: \"--api-url=/pma_api\"");
+  PMA_Println(
+      "  --metrics-url=<url> : Set endpoint serving Prometheus-format "
+      "metrics (disabled when unset);");
+  PMA_Println("    example: \"--metrics-url=/pma_metrics\"");
   PMA_Println(
       "  --js-factors-url=<url> : Set endpoint for client to request "
       "factors.js from this software;");
@@ -74,6 +94,11 @@ void pma_print_usage() {
   PMA_Println(
       "  --threads=<integer> : Defaults to 4. Setting it to 3x of your maximum "
       "thread count is a sane value");
+  PMA_Println(
+      "  --accept-shards=<count> : Create <count> SO_REUSEPORT listeners per "
+      "addr/port, each accepted by its own thread so the kernel "
+      "load-balances new connections (default 1; single main-thread accept "
+      "loop)");
   PMA_Println(
       "  --enable-thread-limit : Use alternative thread usage implementation; "
       "no thread pool, just up to a maximum of spawned threads");
@@ -102,17 +127,36 @@ void pma_print_usage() {
   PMA_Println(
       "  --important-warning-has-been-read : Use this option to enable "
       "potentially dangerous options");
+  PMA_Println(
+      "  --disable-epoll : Use the old sleep-poll accept loop instead of "
+      "blocking on epoll for new connections");
+  PMA_Println(
+      "  --cached-asset-exts=<ext>[,<ext>...] : Cache forwarded GET "
+      "responses for paths with these file extensions in memory (LRU with "
+      "TTL) so repeat asset fetches skip the origin;");
+  PMA_Println("    example: \"--cached-asset-exts=css,js,png,ico,svg\"");
+  PMA_Println(
+      "  --enable-event-workers : Handle connections as nonblocking state "
+      "machines multiplexed over epoll on a fixed set of worker threads "
+      "(count set with --threads=...) instead of one thread per connection");
 }
 
 PMA_ARGS::Args::Args(int argc, char **argv)
     : default_dest_url("https://seodisparate.com"),
       addr_ports(),
+      peers(),
+      peer_listen(),
       port_to_dest_urls(),
       api_url("/pma_api/"),
       js_factors_url("/pma_factors.js"),
+      metrics_url(),
       sqlite_path("sqlite_db"),
+      cached_asset_exts(),
       factors(DEFAULT_FACTORS_QUADS),
+      factors_min(DEFAULT_FACTORS_QUADS),
+      factors_max(DEFAULT_FACTORS_QUADS),
       thread_count(),
+      accept_shards(1),
       flags(),
       challenge_timeout(CHALLENGE_FACTORS_TIMEOUT_MINUTES),
       allowed_timeout(ALLOWED_IP_TIMEOUT_MINUTES),
@@ -143,6 +187,28 @@ PMA_ARGS::Args::Args(int argc, char **argv)
         flags.set(2);
         return;
       }
+    } else if (std::strncmp(argv[0], "--factors-band=", 15) == 0) {
+      const std::string band(argv[0] + 15);
+      const auto colon_idx = band.find(':');
+      if (colon_idx == std::string::npos) {
+        PMA_EPrintln(
+            "ERROR: Failed to parse args! Invalid "
+            "--factors-band=<min>:<max>!");
+        flags.set(2);
+        return;
+      }
+      this->factors_min = std::strtoull(band.c_str(), nullptr, 10);
+      this->factors_max =
+          std::strtoull(band.c_str() + colon_idx + 1, nullptr, 10);
+      if (factors_min == 0 || factors_min == ULLONG_MAX || factors_max == 0 ||
+          factors_max == ULLONG_MAX || factors_min > factors_max) {
+        PMA_EPrintln(
+            "ERROR: Failed to parse args! Invalid "
+            "--factors-band=<min>:<max>!");
+        flags.set(2);
+        return;
+      }
+      flags.set(10);
     } else if (std::strncmp(argv[0], "--dest-url=", 11) == 0) {
       this->default_dest_url = std::string(argv[0] + 11);
       if (this->default_dest_url.empty()) {
@@ -217,6 +283,81 @@ PMA_ARGS::Args::Args(int argc, char **argv)
       }
 
       this->addr_ports.emplace_back(addr, port);
+    } else if (std::strncmp(argv[0], "--peer=", 7) == 0 ||
+               std::strncmp(argv[0], "--peer-listen=", 14) == 0) {
+      const bool is_listen = std::strncmp(argv[0], "--peer-listen=", 14) == 0;
+      const size_t value_idx = is_listen ? 14 : 7;
+      const char *const arg_name = is_listen ? "--peer-listen" : "--peer";
+      std::string addr;
+      std::string port_temp;
+      uint16_t port;
+
+      // Find last colon as colons are used in ipv6
+      size_t last_colon_idx = 0;
+      for (size_t idx = value_idx; argv[0][idx] != 0; ++idx) {
+        if (argv[0][idx] == ':') {
+          last_colon_idx = idx;
+        }
+      }
+      if (last_colon_idx == 0) {
+        PMA_EPrintln("ERROR: Invalid address for {}=... !", arg_name);
+        flags.set(2);
+        return;
+      }
+
+      bool first = true;
+      for (size_t idx = value_idx; argv[0][idx] != 0; ++idx) {
+        if (first) {
+          if (idx == last_colon_idx) {
+            first = false;
+            continue;
+          } else {
+            addr.push_back(argv[0][idx]);
+          }
+        } else {
+          port_temp.push_back(argv[0][idx]);
+        }
+      }
+
+      if (first || port_temp.empty() || addr.empty()) {
+        PMA_EPrintln("ERROR: Failed to parse {}=<addr>:<port> !", arg_name);
+        flags.set(2);
+        return;
+      }
+
+      try {
+        unsigned long parsed = std::stoul(port_temp);
+        if (parsed > 0xFFFF) {
+          PMA_EPrintln(
+              "ERROR: Failed to parse port from "
+              "{}=<addr>:<port> (port number too large)!",
+              arg_name);
+          flags.set(2);
+          return;
+        }
+        port = static_cast<uint16_t>(parsed);
+      } catch (const std::invalid_argument &e) {
+        PMA_EPrintln(
+            "ERROR: Failed to parse port from "
+            "{}=<addr>:<port> (invalid argument)!",
+            arg_name);
+        flags.set(2);
+        return;
+      } catch (const std::out_of_range &e) {
+        PMA_EPrintln(
+            "ERROR: Failed to parse port from "
+            "{}=<addr>:<port> (out of range)!",
+            arg_name);
+        flags.set(2);
+        return;
+      }
+
+      if (is_listen) {
+        this->peer_listen = AddrPort{addr, port};
+        flags.set(11);
+      } else {
+        this->peers.emplace_back(addr, port);
+      }
     } else if (std::strncmp(argv[0], "--port-to-dest-url=", 19) == 0) {
       std::string port_temp;
       std::string url;
@@ -301,6 +442,41 @@ PMA_ARGS::Args::Args(int argc, char **argv)
       if (!this->api_url.ends_with('/')) {
         this->api_url.push_back('/');
       }
+    } else if (std::strncmp(argv[0], "--metrics-url=", 14) == 0) {
+      this->metrics_url = std::string(argv[0] + 14);
+      if (this->metrics_url.empty()) {
+        PMA_EPrintln(
+            "ERROR: Failed to parse --metrics-url=<url> (url is empty)!");
+        flags.set(2);
+        return;
+      }
+      if (!this->metrics_url.ends_with('/')) {
+        this->metrics_url.push_back('/');
+      }
+    } else if (std::strncmp(argv[0], "--cached-asset-exts=", 20) == 0) {
+      const std::string exts(argv[0] + 20);
+      std::string ext;
+      for (char c : exts) {
+        if (c == ',') {
+          if (!ext.empty()) {
+            this->cached_asset_exts.insert(
+                PMA_HELPER::ascii_str_to_lower(ext));
+            ext.clear();
+          }
+        } else if (c != '.') {
+          ext.push_back(c);
+        }
+      }
+      if (!ext.empty()) {
+        this->cached_asset_exts.insert(PMA_HELPER::ascii_str_to_lower(ext));
+      }
+      if (this->cached_asset_exts.empty()) {
+        PMA_EPrintln(
+            "ERROR: Failed to parse --cached-asset-exts=<ext>[,<ext>...] (no "
+            "extensions)!");
+        flags.set(2);
+        return;
+      }
     } else if (std::strncmp(argv[0], "--js-factors-url=", 17) == 0) {
       this->js_factors_url = std::string(argv[0] + 17);
       if (this->js_factors_url.empty()) {
@@ -376,6 +552,28 @@ PMA_ARGS::Args::Args(int argc, char **argv)
         flags.set(2);
         return;
       }
+    } else if (std::strncmp(argv[0], "--accept-shards=", 16) == 0) {
+      try {
+        unsigned long parsed = std::stoul(std::string(argv[0] + 16));
+        if (parsed == 0 || parsed > 0xFFFFFFFF) {
+          PMA_EPrintln(
+              "ERROR: Failed to parse --accept-shards=... (must be nonzero "
+              "and not too large!)");
+          flags.set(2);
+          return;
+        }
+        accept_shards = static_cast<uint32_t>(parsed);
+      } catch (const std::invalid_argument &e) {
+        PMA_EPrintln(
+            "ERROR: Failed to parse --accept-shards=... (invalid argument!)");
+        flags.set(2);
+        return;
+      } catch (const std::out_of_range &e) {
+        PMA_EPrintln(
+            "ERROR: Failed to parse --accept-shards=... (out of range!)");
+        flags.set(2);
+        return;
+      }
     } else if (std::strcmp(argv[0], "--enable-thread-limit") == 0) {
       flags.set(6);
     } else if (std::strcmp(argv[0], "--enable-libcurl") == 0) {
@@ -432,6 +630,10 @@ PMA_ARGS::Args::Args(int argc, char **argv)
       flags.set(3);
     } else if (std::strcmp(argv[0], "--enable-unknown-arg-error") == 0) {
       flags.set(7);
+    } else if (std::strcmp(argv[0], "--disable-epoll") == 0) {
+      flags.set(8);
+    } else if (std::strcmp(argv[0], "--enable-event-workers") == 0) {
+      flags.set(9);
     } else {
       unknown_args.push_back(std::string(argv[0]));
     }
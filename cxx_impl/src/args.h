@@ -25,6 +25,7 @@
 #include <string>
 #include <tuple>
 #include <unordered_map>
+#include <unordered_set>
 
 namespace PMA_ARGS {
 
@@ -43,13 +44,28 @@ struct Args {
 
   std::string default_dest_url;
   std::deque<AddrPort> addr_ports;
+  /// Peer-sync fleet members (--peer); only used when flag 11 is set.
+  std::deque<AddrPort> peers;
+  /// UDP addr/port receiving peer-sync datagrams (--peer-listen).
+  std::optional<AddrPort> peer_listen;
   std::unordered_map<uint16_t, std::string> port_to_dest_urls;
   std::string api_url;
   std::string js_factors_url;
+  /// Empty by default; metrics endpoint is disabled when empty.
+  std::string metrics_url;
   std::string sqlite_path;
   std::string mysql_conf_path;
+  /// Lowercased file extensions (without the ".") whose forwarded GET
+  /// responses are cached in memory; empty disables the asset cache.
+  std::unordered_set<std::string> cached_asset_exts;
   uint64_t factors;
+  /// Adaptive difficulty band (--factors-band); only used when flag 10 is
+  /// set. Both default to the configured factors.
+  uint64_t factors_min;
+  uint64_t factors_max;
   std::optional<uint32_t> thread_count;
+  /// SO_REUSEPORT listeners (each with its own accept thread) per addr/port.
+  uint32_t accept_shards;
   // 0 - enable trusting "x-real-ip" header
   // 1 - enable "override-dest-url" header
   // 2 - failed to parse args
@@ -58,6 +74,10 @@ struct Args {
   // 5 - use libcurl
   // 6 - enable thread-limit
   // 7 - error on unknown args
+  // 8 - use sleep-poll accept loop instead of epoll
+  // 9 - enable event workers (epoll-driven connection handling)
+  // 10 - adaptive challenge difficulty (--factors-band)
+  // 11 - peer sync of the allowed-IP set (--peer-listen)
   std::bitset<32> flags;
   uint32_t challenge_timeout;
   uint32_t allowed_timeout;
@@ -0,0 +1,95 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "asset_cache.h"
+
+// Standard library includes
+#include <utility>
+
+// Local includes
+#include "constants.h"
+
+AssetCache::AssetCache()
+    : AssetCache(ASSET_CACHE_TTL, ASSET_CACHE_MAX_TOTAL_BYTES) {}
+
+AssetCache::AssetCache(std::chrono::seconds ttl, size_t max_total_bytes)
+    : mutex(),
+      lru(),
+      map(),
+      ttl(ttl),
+      max_total(max_total_bytes),
+      total(0) {}
+
+std::optional<AssetCache::CachedResponse> AssetCache::lookup(
+    const std::string &key, TimePoint now) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  auto iter = map.find(key);
+  if (iter == map.end()) {
+    return std::nullopt;
+  }
+
+  if (now - iter->second->stored >= ttl) {
+    erase_entry(iter->second);
+    return std::nullopt;
+  }
+
+  lru.splice(lru.begin(), lru, iter->second);
+  return lru.front().response;
+}
+
+void AssetCache::insert(const std::string &key, std::string content_type,
+                        std::string body, TimePoint now) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  if (auto iter = map.find(key); iter != map.end()) {
+    erase_entry(iter->second);
+  }
+
+  const size_t body_size = body.size();
+  lru.push_front(Entry{
+      key,
+      CachedResponse{std::move(content_type),
+                     std::make_shared<const std::string>(std::move(body))},
+      now});
+  map.insert(std::make_pair(key, lru.begin()));
+  total += body_size;
+
+  while (total > max_total && lru.size() > 1) {
+    erase_entry(std::prev(lru.end()));
+  }
+}
+
+size_t AssetCache::entry_count() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return lru.size();
+}
+
+size_t AssetCache::total_bytes() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return total;
+}
+
+void AssetCache::erase_entry(std::list<Entry>::iterator iter) {
+  total -= iter->response.body->size();
+  map.erase(iter->key);
+  lru.erase(iter);
+}
+
+AssetCache &asset_cache_get() {
+  static AssetCache internal_global_asset_cache{};
+  return internal_global_asset_cache;
+}
@@ -0,0 +1,89 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef SEODISPARATE_COM_POOR_MANS_ANUBIS_ASSET_CACHE_H_
+#define SEODISPARATE_COM_POOR_MANS_ANUBIS_ASSET_CACHE_H_
+
+// Standard library includes
+#include <chrono>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+/// LRU cache of proxied static asset responses, keyed by
+/// "local_port:path". Entries hold the response body and content type and
+/// expire after a TTL; total cached bytes are capped by evicting the least
+/// recently used entries. Bodies are handed out as shared_ptrs so a hit can
+/// be written to the client after the lock is dropped, even if the entry is
+/// evicted in the meantime.
+class AssetCache {
+ public:
+  using TimePoint = std::chrono::time_point<std::chrono::steady_clock>;
+
+  struct CachedResponse {
+    std::string content_type;
+    std::shared_ptr<const std::string> body;
+  };
+
+  AssetCache();
+  AssetCache(std::chrono::seconds ttl, size_t max_total_bytes);
+
+  // disallow copy
+  AssetCache(const AssetCache &) = delete;
+  AssetCache &operator=(const AssetCache &) = delete;
+
+  // disallow move (holds a mutex)
+  AssetCache(AssetCache &&) = delete;
+  AssetCache &operator=(AssetCache &&) = delete;
+
+  /// Returns the cached response and refreshes its LRU position, or
+  /// std::nullopt on a miss. Expired entries are erased on lookup.
+  std::optional<CachedResponse> lookup(const std::string &key, TimePoint now);
+
+  /// Inserts or replaces an entry, then evicts least recently used entries
+  /// until the total byte cap is respected.
+  void insert(const std::string &key, std::string content_type,
+              std::string body, TimePoint now);
+
+  size_t entry_count();
+  size_t total_bytes();
+
+ private:
+  struct Entry {
+    std::string key;
+    CachedResponse response;
+    TimePoint stored;
+  };
+
+  /// Must be called with the mutex held.
+  void erase_entry(std::list<Entry>::iterator iter);
+
+  std::mutex mutex;
+  // Most recently used entries are at the front.
+  std::list<Entry> lru;
+  std::unordered_map<std::string, std::list<Entry>::iterator> map;
+  std::chrono::seconds ttl;
+  size_t max_total;
+  size_t total;
+};
+
+AssetCache &asset_cache_get();
+
+#endif
@@ -0,0 +1,149 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "backend_pool.h"
+
+// Standard library includes
+#include <cerrno>
+
+// Unix includes
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+// Local includes
+#include "constants.h"
+
+BackendPool::BackendPool()
+    : BackendPool(BACKEND_POOL_IDLE_TIMEOUT, BACKEND_POOL_MAX_IDLE_PER_KEY) {}
+
+BackendPool::BackendPool(std::chrono::seconds idle_timeout,
+                         size_t max_idle_per_key)
+    : idle_timeout(idle_timeout),
+      max_idle_per_key(max_idle_per_key),
+      mutex(),
+      conns() {}
+
+bool BackendPool::fd_usable(int fd) {
+  char peek_byte;
+  ssize_t peek_ret =
+      recv(fd, &peek_byte, 1, MSG_PEEK | MSG_DONTWAIT);
+  if (peek_ret == 0) {
+    // Peer closed the connection.
+    return false;
+  } else if (peek_ret > 0) {
+    // Unexpected data would be misattributed to the next forwarded request.
+    return false;
+  }
+  return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+int BackendPool::acquire(const std::string &key, TimePoint now) {
+  std::vector<Entry> stale;
+  int fd = -1;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto iter = conns.find(key);
+    if (iter == conns.end()) {
+      return -1;
+    }
+    // Newest entries first; older ones are more likely to have been closed
+    // by the origin's own keep-alive timeout.
+    while (!iter->second.empty()) {
+      Entry entry = iter->second.back();
+      iter->second.pop_back();
+      if (now - entry.stored > idle_timeout) {
+        stale.push_back(entry);
+        continue;
+      }
+      fd = entry.fd;
+      break;
+    }
+    if (iter->second.empty()) {
+      conns.erase(iter);
+    }
+  }
+  for (const Entry &entry : stale) {
+    close(entry.fd);
+  }
+  // Validation does a syscall per candidate; do it outside the lock and only
+  // retry through acquire() so other threads aren't held up.
+  if (fd >= 0 && !fd_usable(fd)) {
+    close(fd);
+    return acquire(key, now);
+  }
+  return fd;
+}
+
+void BackendPool::release(const std::string &key, int fd, TimePoint now) {
+  if (fd < 0) {
+    return;
+  }
+  if (key.empty() || !fd_usable(fd)) {
+    close(fd);
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<Entry> &entries = conns[key];
+    if (entries.size() < max_idle_per_key) {
+      entries.push_back(Entry{fd, now});
+      return;
+    }
+  }
+  close(fd);
+}
+
+void BackendPool::prune(TimePoint now) {
+  std::vector<Entry> stale;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto iter = conns.begin(); iter != conns.end();) {
+      std::vector<Entry> &entries = iter->second;
+      for (size_t idx = 0; idx < entries.size();) {
+        if (now - entries.at(idx).stored > idle_timeout) {
+          stale.push_back(entries.at(idx));
+          entries.at(idx) = entries.back();
+          entries.pop_back();
+        } else {
+          ++idx;
+        }
+      }
+      if (entries.empty()) {
+        iter = conns.erase(iter);
+      } else {
+        ++iter;
+      }
+    }
+  }
+  for (const Entry &entry : stale) {
+    close(entry.fd);
+  }
+}
+
+size_t BackendPool::idle_count() {
+  std::lock_guard<std::mutex> lock(mutex);
+  size_t total = 0;
+  for (const auto &pair : conns) {
+    total += pair.second.size();
+  }
+  return total;
+}
+
+BackendPool &backend_pool_get() {
+  static BackendPool pool{};
+  return pool;
+}
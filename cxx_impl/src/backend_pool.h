@@ -0,0 +1,81 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef SEODISPARATE_COM_POOR_MANS_ANUBIS_BACKEND_POOL_H_
+#define SEODISPARATE_COM_POOR_MANS_ANUBIS_BACKEND_POOL_H_
+
+// Standard library includes
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// Keep-alive pool of backend (origin) connections keyed by "addr:port".
+/// Forwarding handlers hand back their destination fd when a client
+/// connection ends, and later forwards to the same origin ride the warm
+/// connection instead of performing a fresh TCP handshake.
+class BackendPool {
+ public:
+  using TimePoint = std::chrono::time_point<std::chrono::steady_clock>;
+
+  BackendPool();
+  BackendPool(std::chrono::seconds idle_timeout, size_t max_idle_per_key);
+
+  // disallow copy
+  BackendPool(const BackendPool &) = delete;
+  BackendPool &operator=(const BackendPool &) = delete;
+
+  // disallow move (holds a mutex)
+  BackendPool(BackendPool &&) = delete;
+  BackendPool &operator=(BackendPool &&) = delete;
+
+  /// Returns a validated pooled fd for the key, or -1 if none is available
+  /// (caller connects fresh). Entries that idled past the timeout or whose
+  /// peer has closed/sent unexpected data are closed and skipped.
+  int acquire(const std::string &key, TimePoint now);
+
+  /// Hands a still-open fd back to the pool. The fd is closed instead when
+  /// the key's idle list is full or the key is empty.
+  void release(const std::string &key, int fd, TimePoint now);
+
+  /// Closes entries that idled past the timeout. Called periodically from
+  /// the accept loop alongside cached_allowed expiry.
+  void prune(TimePoint now);
+
+  size_t idle_count();
+
+ private:
+  struct Entry {
+    int fd;
+    TimePoint stored;
+  };
+
+  /// Returns true if the fd still looks usable: peer has not closed and has
+  /// not sent data we would misattribute to the next forward.
+  static bool fd_usable(int fd);
+
+  std::chrono::seconds idle_timeout;
+  size_t max_idle_per_key;
+  std::mutex mutex;
+  std::unordered_map<std::string, std::vector<Entry> > conns;
+};
+
+/// Process-wide pool used by the socket forwarding path.
+BackendPool &backend_pool_get();
+
+#endif
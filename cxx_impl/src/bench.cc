@@ -0,0 +1,218 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+// Microbenchmarks for the request hot paths. Each benchmark reports ops/sec
+// and heap allocations per op (counted via global operator new/delete
+// overrides) so runs can be compared release-to-release. Build with the
+// "bench" target.
+
+// standard library includes
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <format>
+#include <functional>
+#include <new>
+#include <string>
+#include <string_view>
+
+// third party includes
+#include <blake3.h>
+
+// local includes
+#include "db.h"
+#include "helpers.h"
+#include "http.h"
+#include "poor_mans_print.h"
+#include "work.h"
+
+static std::atomic_size_t alloc_count{0};
+
+void *operator new(std::size_t size) {
+  alloc_count.fetch_add(1, std::memory_order_relaxed);
+  void *ptr = std::malloc(size);
+  if (!ptr) {
+    throw std::bad_alloc{};
+  }
+  return ptr;
+}
+
+void *operator new[](std::size_t size) {
+  alloc_count.fetch_add(1, std::memory_order_relaxed);
+  void *ptr = std::malloc(size);
+  if (!ptr) {
+    throw std::bad_alloc{};
+  }
+  return ptr;
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+void run_bench(const std::string &name, uint64_t iterations,
+               const std::function<void()> &fn) {
+  // Warmup so one-time setup costs are not attributed to the first
+  // measured iteration.
+  fn();
+
+  const size_t allocs_before = alloc_count.load();
+  const auto time_before = std::chrono::steady_clock::now();
+  for (uint64_t iter = 0; iter < iterations; ++iter) {
+    fn();
+  }
+  const auto time_after = std::chrono::steady_clock::now();
+  const size_t allocs_after = alloc_count.load();
+
+  const double seconds =
+      std::chrono::duration_cast<std::chrono::duration<double> >(time_after -
+                                                                 time_before)
+          .count();
+  const double ops_per_sec =
+      seconds > 0.0 ? static_cast<double>(iterations) / seconds : 0.0;
+  const double allocs_per_op =
+      static_cast<double>(allocs_after - allocs_before) /
+      static_cast<double>(iterations);
+
+  PMA_Println("{:<48} {:>14.1f} ops/sec {:>10.2f} allocs/op ({} iters)", name,
+              ops_per_sec, allocs_per_op, iterations);
+}
+
+int main() {
+  // work_generate_target_factors2 across quad sizes.
+  for (const uint64_t quads : {10ull, 100ull, 550ull, 2200ull}) {
+    const uint64_t iterations = quads <= 100 ? 50 : 5;
+    run_bench(std::format("work_generate_target_factors2 quads={}", quads),
+              iterations, [quads]() {
+                Work_Factors wf = work_generate_target_factors2(quads);
+                work_cleanup_factors2(&wf);
+              });
+  }
+
+  // Request parsing on a typical browser request.
+  {
+    const std::string raw_req =
+        "GET /path/to/page?id=0123456789abcdef&x=1 HTTP/1.1\r\n"
+        "Host: example.com\r\n"
+        "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:109.0) "
+        "Gecko/20100101 Firefox/115.0\r\n"
+        "Accept: "
+        "text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+        "Accept-Language: en-US,en;q=0.5\r\n"
+        "Accept-Encoding: gzip, deflate, br\r\n"
+        "Connection: keep-alive\r\n"
+        "Upgrade-Insecure-Requests: 1\r\n"
+        "X-Real-IP: 203.0.113.7\r\n"
+        "\r\n";
+    run_bench("handle_request_parse", 20000, [&raw_req]() {
+      PMA_HTTP::Request req = PMA_HTTP::handle_request_parse(raw_req);
+      if (req.error_enum != PMA_HTTP::ErrorT::SUCCESS) {
+        PMA_EPrintln("ERROR: handle_request_parse failed in bench!");
+        std::exit(1);
+      }
+    });
+    run_bench("handle_request_parse_view", 20000, [&raw_req]() {
+      PMA_HTTP::RequestView view = PMA_HTTP::handle_request_parse_view(raw_req);
+      if (view.error_enum != PMA_HTTP::ErrorT::SUCCESS) {
+        PMA_EPrintln("ERROR: handle_request_parse_view failed in bench!");
+        std::exit(1);
+      }
+    });
+  }
+
+  // JSON parsing on an answer-sized body.
+  {
+    std::string json = "{\"type\": \"answer\", \"id\": \"0123456789abcdef\", "
+                       "\"factors\": \"";
+    for (size_t idx = 0; idx < 4096; ++idx) {
+      json.push_back(static_cast<char>('a' + (idx % 26)));
+    }
+    json.append("\"}");
+    run_bench("parse_simple_json", 20000, [&json]() {
+      const auto [err, keyvals] = PMA_HTTP::parse_simple_json(json);
+      if (err != PMA_HTTP::ErrorT::SUCCESS) {
+        PMA_EPrintln("ERROR: parse_simple_json failed in bench!");
+        std::exit(1);
+      }
+    });
+    run_bench("parse_simple_json_streaming", 20000, [&json]() {
+      const PMA_HTTP::ErrorT err = PMA_HTTP::parse_simple_json_streaming(
+          json, json.size(), [](std::string_view, std::string_view) {});
+      if (err != PMA_HTTP::ErrorT::SUCCESS) {
+        PMA_EPrintln("ERROR: parse_simple_json_streaming failed in bench!");
+        std::exit(1);
+      }
+    });
+  }
+
+  // exec_sqlite_statement against an in-memory db.
+  {
+    auto [ctx, err, err_msg] = PMA_SQL::init_sqlite(":memory:");
+    if (err != PMA_SQL::ErrorT::SUCCESS) {
+      PMA_EPrintln("ERROR: Failed to init in-memory sqlite: {}", err_msg);
+      return 1;
+    }
+    run_bench("exec_sqlite_statement INSERT ALLOWED_IP", 20000, [&ctx]() {
+      const auto [err_enum, msg] = PMA_SQL::exec_sqlite_statement<0>(
+          ctx, "INSERT INTO ALLOWED_IP (IP, PORT) VALUES (?, ?)", std::nullopt,
+          std::string("203.0.113.7"), 8080);
+      if (err_enum != PMA_SQL::ErrorT::SUCCESS) {
+        PMA_EPrintln("ERROR: sqlite INSERT failed in bench! {}", msg);
+        std::exit(1);
+      }
+    });
+    run_bench("is_allowed_ip_port SELECT", 20000, [&ctx]() {
+      const auto [err_enum, msg, is_allowed] = PMA_SQL::is_allowed_ip_port(
+          ctx, "203.0.113.7", 8080);
+      if (err_enum != PMA_SQL::ErrorT::SUCCESS || !is_allowed) {
+        PMA_EPrintln("ERROR: sqlite SELECT failed in bench! {}", msg);
+        std::exit(1);
+      }
+    });
+  }
+
+  // Hash helpers over an answer-sized buffer.
+  {
+    std::string buf;
+    for (size_t idx = 0; idx < 4096; ++idx) {
+      buf.push_back(static_cast<char>('a' + (idx % 26)));
+    }
+    run_bench("blake3 hash 4KiB hex", 20000, [&buf]() {
+      std::array<uint8_t, BLAKE3_OUT_LEN> hash_data;
+      blake3_hasher hasher;
+      blake3_hasher_init(&hasher);
+      blake3_hasher_update(&hasher, buf.data(), buf.size());
+      blake3_hasher_finalize(&hasher, hash_data.data(), BLAKE3_OUT_LEN);
+      const std::string hex =
+          PMA_HELPER::raw_to_hexadecimal<BLAKE3_OUT_LEN>(hash_data);
+      if (hex.empty()) {
+        std::exit(1);
+      }
+    });
+    run_bench("sha1_digest_hex 4KiB", 20000, [&buf]() {
+      const std::array<char, 40> hex = PMA_HELPER::sha1_digest_hex(
+          reinterpret_cast<uint8_t *>(buf.data()), buf.size());
+      if (hex.at(0) == 0 && hex.at(1) == 0) {
+        std::exit(1);
+      }
+    });
+  }
+
+  return 0;
+}
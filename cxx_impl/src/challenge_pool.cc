@@ -0,0 +1,180 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "challenge_pool.h"
+
+// Standard library includes
+#include <bit>
+#include <cstdint>
+#include <optional>
+
+// Local includes
+#include "constants.h"
+
+ChallengePool::ChallengePool() : quads(0) {}
+
+ChallengePool::ChallengePool(uint64_t quads, uint32_t capacity)
+    : quads(quads),
+      stop_var(std::make_shared<std::atomic_bool>(false)),
+      ring(std::make_shared<Ring>(
+          std::bit_ceil(capacity >= 2 ? static_cast<size_t>(capacity) : 2))),
+      head_idx(std::make_shared<std::atomic_size_t>(0)),
+      tail_idx(std::make_shared<std::atomic_size_t>(0)) {
+  for (size_t idx = 0; idx < ring->size(); ++idx) {
+    ring->at(idx).seq.store(idx, std::memory_order_relaxed);
+    ring->at(idx).wf.value = nullptr;
+    ring->at(idx).wf.value2 = nullptr;
+    ring->at(idx).wf.factors = nullptr;
+  }
+  producer_thread = std::thread(producer_function, quads, stop_var, ring,
+                                head_idx, tail_idx);
+}
+
+ChallengePool::~ChallengePool() { cleanup(); }
+
+ChallengePool::ChallengePool(ChallengePool &&other)
+    : quads(other.quads),
+      stop_var(std::move(other.stop_var)),
+      ring(std::move(other.ring)),
+      head_idx(std::move(other.head_idx)),
+      tail_idx(std::move(other.tail_idx)),
+      producer_thread(std::move(other.producer_thread)) {}
+
+ChallengePool &ChallengePool::operator=(ChallengePool &&other) {
+  cleanup();
+  quads = other.quads;
+  stop_var = std::move(other.stop_var);
+  ring = std::move(other.ring);
+  head_idx = std::move(other.head_idx);
+  tail_idx = std::move(other.tail_idx);
+  producer_thread = std::move(other.producer_thread);
+  return *this;
+}
+
+Work_Factors ChallengePool::get(uint64_t quads) {
+  if (ring && quads == this->quads) {
+    Work_Factors wf;
+    if (try_pop(*ring, *head_idx, &wf)) {
+      return wf;
+    }
+  }
+  // Pool is empty, not running, or keyed on a different difficulty.
+  return work_generate_target_factors2(quads);
+}
+
+void ChallengePool::producer_function(
+    uint64_t quads, std::shared_ptr<std::atomic_bool> stop_var,
+    std::shared_ptr<Ring> ring, std::shared_ptr<std::atomic_size_t> head_idx,
+    std::shared_ptr<std::atomic_size_t> tail_idx) {
+  while (!stop_var->load()) {
+    Work_Factors wf = work_generate_target_factors2(quads);
+    while (!try_push(*ring, *tail_idx, wf)) {
+      // Ring is full; wait for the request path to drain it.
+      std::this_thread::sleep_for(SLEEP_MILLISECONDS_CHRONO);
+      if (stop_var->load()) {
+        work_cleanup_factors2(&wf);
+        return;
+      }
+    }
+  }
+}
+
+bool ChallengePool::try_push(Ring &ring, std::atomic_size_t &tail_idx,
+                             Work_Factors wf) {
+  const size_t mask = ring.size() - 1;
+  size_t pos = tail_idx.load(std::memory_order_relaxed);
+  while (true) {
+    Slot &slot = ring[pos & mask];
+    const size_t seq = slot.seq.load(std::memory_order_acquire);
+    const intptr_t dif =
+        static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+    if (dif == 0) {
+      if (tail_idx.compare_exchange_weak(pos, pos + 1,
+                                         std::memory_order_relaxed)) {
+        slot.wf = wf;
+        slot.seq.store(pos + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (dif < 0) {
+      // Full.
+      return false;
+    } else {
+      pos = tail_idx.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+bool ChallengePool::try_pop(Ring &ring, std::atomic_size_t &head_idx,
+                            Work_Factors *wf_out) {
+  const size_t mask = ring.size() - 1;
+  size_t pos = head_idx.load(std::memory_order_relaxed);
+  while (true) {
+    Slot &slot = ring[pos & mask];
+    const size_t seq = slot.seq.load(std::memory_order_acquire);
+    const intptr_t dif =
+        static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+    if (dif == 0) {
+      if (head_idx.compare_exchange_weak(pos, pos + 1,
+                                         std::memory_order_relaxed)) {
+        *wf_out = slot.wf;
+        slot.wf.value = nullptr;
+        slot.wf.value2 = nullptr;
+        slot.wf.factors = nullptr;
+        slot.seq.store(pos + ring.size(), std::memory_order_release);
+        return true;
+      }
+    } else if (dif < 0) {
+      // Empty.
+      return false;
+    } else {
+      pos = head_idx.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+void ChallengePool::cleanup() {
+  if (stop_var) {
+    stop_var->store(true);
+  }
+  if (producer_thread.joinable()) {
+    producer_thread.join();
+  }
+  if (ring) {
+    Work_Factors wf;
+    while (try_pop(*ring, *head_idx, &wf)) {
+      work_cleanup_factors2(&wf);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Process-wide pool.
+////////////////////////////////////////////////////////////////////////////////
+
+static std::optional<ChallengePool> internal_global_pool{};
+
+void challenge_pool_start(uint64_t quads, uint32_t capacity) {
+  internal_global_pool.emplace(quads, capacity);
+}
+
+void challenge_pool_stop() { internal_global_pool.reset(); }
+
+Work_Factors challenge_pool_get(uint64_t quads) {
+  if (internal_global_pool.has_value()) {
+    return internal_global_pool->get(quads);
+  }
+  return work_generate_target_factors2(quads);
+}
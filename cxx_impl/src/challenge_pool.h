@@ -0,0 +1,94 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef SEODISPARATE_COM_POOR_MANS_ANUBIS_CHALLENGE_POOL_H_
+#define SEODISPARATE_COM_POOR_MANS_ANUBIS_CHALLENGE_POOL_H_
+
+// Standard library includes
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Local includes
+#include "work.h"
+
+/// Keeps a bounded lock-free ring of pre-generated Work_Factors so that
+/// challenge issuance on the request path is a pop instead of a full
+/// work_generate_target_factors2 run. Challenges are random and independent
+/// of the client, so a single background producer keyed on the configured
+/// quads can generate them ahead of time.
+class ChallengePool {
+ public:
+  ChallengePool();
+  ChallengePool(uint64_t quads, uint32_t capacity);
+  ~ChallengePool();
+
+  // disallow copy
+  ChallengePool(const ChallengePool &) = delete;
+  ChallengePool &operator=(const ChallengePool &) = delete;
+
+  // allow move
+  ChallengePool(ChallengePool &&);
+  ChallengePool &operator=(ChallengePool &&);
+
+  /// Pops a pre-generated Work_Factors. Generates inline if the pool is
+  /// empty or the requested quads don't match the pool's difficulty.
+  Work_Factors get(uint64_t quads);
+
+ private:
+  // Bounded MPMC ring slot; "seq" tracks whether the slot holds a value for
+  // the current lap (Vyukov-style bounded queue).
+  struct Slot {
+    std::atomic_size_t seq;
+    Work_Factors wf;
+  };
+
+  using Ring = std::vector<Slot>;
+
+  static void producer_function(uint64_t quads,
+                                std::shared_ptr<std::atomic_bool> stop_var,
+                                std::shared_ptr<Ring> ring,
+                                std::shared_ptr<std::atomic_size_t> head_idx,
+                                std::shared_ptr<std::atomic_size_t> tail_idx);
+
+  static bool try_push(Ring &ring, std::atomic_size_t &tail_idx,
+                       Work_Factors wf);
+  static bool try_pop(Ring &ring, std::atomic_size_t &head_idx,
+                      Work_Factors *wf_out);
+
+  void cleanup();
+
+  uint64_t quads;
+  std::shared_ptr<std::atomic_bool> stop_var;
+  std::shared_ptr<Ring> ring;
+  std::shared_ptr<std::atomic_size_t> head_idx;
+  std::shared_ptr<std::atomic_size_t> tail_idx;
+  std::thread producer_thread;
+};
+
+/// Starts the process-wide pool used by the challenge issuing paths.
+void challenge_pool_start(uint64_t quads, uint32_t capacity);
+
+/// Stops the process-wide pool and frees any pooled challenges.
+void challenge_pool_stop();
+
+/// Returns a pre-generated Work_Factors from the process-wide pool, or
+/// generates one inline if the pool isn't running or doesn't match quads.
+Work_Factors challenge_pool_get(uint64_t quads);
+
+#endif
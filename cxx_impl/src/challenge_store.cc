@@ -0,0 +1,164 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "challenge_store.h"
+
+// Standard library includes
+#include <utility>
+
+// Local includes
+#include "constants.h"
+
+ChallengeStore::ChallengeStore() : ttl(std::chrono::seconds(0)) {}
+
+ChallengeStore::ChallengeStore(std::chrono::seconds ttl, FlushFn flush_fn)
+    : ttl(ttl),
+      stop_var(std::make_shared<std::atomic_bool>(false)),
+      mutex(std::make_shared<std::mutex>()),
+      cv(std::make_shared<std::condition_variable>()),
+      entries(std::make_shared<Entries>()),
+      pending(std::make_shared<Pending>()) {
+  writer_thread = std::thread(writer_function, stop_var, mutex, cv, pending,
+                              std::move(flush_fn));
+}
+
+ChallengeStore::~ChallengeStore() { cleanup(); }
+
+ChallengeStore::ChallengeStore(ChallengeStore &&other)
+    : ttl(other.ttl),
+      stop_var(std::move(other.stop_var)),
+      mutex(std::move(other.mutex)),
+      cv(std::move(other.cv)),
+      entries(std::move(other.entries)),
+      pending(std::move(other.pending)),
+      writer_thread(std::move(other.writer_thread)) {}
+
+ChallengeStore &ChallengeStore::operator=(ChallengeStore &&other) {
+  cleanup();
+  ttl = other.ttl;
+  stop_var = std::move(other.stop_var);
+  mutex = std::move(other.mutex);
+  cv = std::move(other.cv);
+  entries = std::move(other.entries);
+  pending = std::move(other.pending);
+  writer_thread = std::move(other.writer_thread);
+  return *this;
+}
+
+void ChallengeStore::insert(std::string id, std::string factors_hash,
+                            std::string ip, uint16_t port) {
+  {
+    std::unique_lock<std::mutex> lock(*mutex);
+    prune_expired_locked();
+    entries->insert_or_assign(
+        id, Entry{factors_hash, ip, port,
+                  std::chrono::steady_clock::now() + ttl});
+    pending->push_back(PendingWrite{std::move(id), std::move(factors_hash),
+                                    std::move(ip), port, false});
+  }
+  cv->notify_one();
+}
+
+std::optional<std::tuple<std::string, uint16_t> > ChallengeStore::lookup(
+    const std::string &id, const std::string &factors_hash) {
+  std::unique_lock<std::mutex> lock(*mutex);
+  auto iter = entries->find(id);
+  if (iter == entries->end() ||
+      iter->second.expiry < std::chrono::steady_clock::now() ||
+      iter->second.factors_hash != factors_hash) {
+    return std::nullopt;
+  }
+  return std::tuple<std::string, uint16_t>{iter->second.ip, iter->second.port};
+}
+
+bool ChallengeStore::contains(const std::string &id) {
+  std::unique_lock<std::mutex> lock(*mutex);
+  auto iter = entries->find(id);
+  return iter != entries->end() &&
+         iter->second.expiry >= std::chrono::steady_clock::now();
+}
+
+std::optional<std::chrono::milliseconds> ChallengeStore::elapsed_since_insert(
+    const std::string &id) {
+  std::unique_lock<std::mutex> lock(*mutex);
+  auto iter = entries->find(id);
+  const auto now = std::chrono::steady_clock::now();
+  if (iter == entries->end() || iter->second.expiry < now) {
+    return std::nullopt;
+  }
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+      ttl - (iter->second.expiry - now));
+}
+
+void ChallengeStore::erase(std::string id) {
+  {
+    std::unique_lock<std::mutex> lock(*mutex);
+    entries->erase(id);
+    pending->push_back(PendingWrite{std::move(id), {}, {}, 0, true});
+  }
+  cv->notify_one();
+}
+
+void ChallengeStore::writer_function(
+    std::shared_ptr<std::atomic_bool> stop_var,
+    std::shared_ptr<std::mutex> mutex,
+    std::shared_ptr<std::condition_variable> cv,
+    std::shared_ptr<Pending> pending, FlushFn flush_fn) {
+  Pending batch;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(*mutex);
+      cv->wait_for(lock, CONN_TRY_LOCK_DURATION, [&]() {
+        return stop_var->load() || !pending->empty();
+      });
+      batch.swap(*pending);
+    }
+    // Flush outside of the lock so the request path is never blocked on the
+    // database.
+    for (const PendingWrite &write : batch) {
+      flush_fn(write);
+    }
+    batch.clear();
+    if (stop_var->load()) {
+      // Drain anything queued after the last swap.
+      std::unique_lock<std::mutex> lock(*mutex);
+      if (pending->empty()) {
+        return;
+      }
+    }
+  }
+}
+
+void ChallengeStore::prune_expired_locked() {
+  const auto now = std::chrono::steady_clock::now();
+  for (auto iter = entries->begin(); iter != entries->end();) {
+    if (iter->second.expiry < now) {
+      iter = entries->erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+}
+
+void ChallengeStore::cleanup() {
+  if (stop_var) {
+    stop_var->store(true);
+    cv->notify_one();
+  }
+  if (writer_thread.joinable()) {
+    writer_thread.join();
+  }
+}
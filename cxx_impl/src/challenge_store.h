@@ -0,0 +1,115 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef SEODISPARATE_COM_POOR_MANS_ANUBIS_CHALLENGE_STORE_H_
+#define SEODISPARATE_COM_POOR_MANS_ANUBIS_CHALLENGE_STORE_H_
+
+// Standard library includes
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+
+/// In-process challenge table (id -> answer-hash/ip/port) acting as the
+/// authoritative store for the short challenge lifetime, with asynchronous
+/// write-behind to the database for durability across restarts. Lookups and
+/// inserts on the request path touch only memory; a writer thread drains the
+/// queued inserts/deletes through the provided flush fn.
+class ChallengeStore {
+ public:
+  struct PendingWrite {
+    std::string id;
+    std::string factors_hash;
+    std::string ip;
+    uint16_t port;
+    // Insert when unset.
+    bool is_delete;
+  };
+
+  using FlushFn = std::function<void(const PendingWrite &)>;
+
+  ChallengeStore();
+  ChallengeStore(std::chrono::seconds ttl, FlushFn flush_fn);
+  ~ChallengeStore();
+
+  // disallow copy
+  ChallengeStore(const ChallengeStore &) = delete;
+  ChallengeStore &operator=(const ChallengeStore &) = delete;
+
+  // allow move
+  ChallengeStore(ChallengeStore &&);
+  ChallengeStore &operator=(ChallengeStore &&);
+
+  /// Stores a challenge entry and queues the write-behind insert.
+  void insert(std::string id, std::string factors_hash, std::string ip,
+              uint16_t port);
+
+  /// Returns ip and port of the unexpired entry matching id and factors
+  /// hash, or nullopt. Does not remove the entry.
+  std::optional<std::tuple<std::string, uint16_t> > lookup(
+      const std::string &id, const std::string &factors_hash);
+
+  bool contains(const std::string &id);
+
+  /// Milliseconds since the unexpired entry matching id was inserted, or
+  /// nullopt. Derived from the stored expiry and the configured ttl.
+  std::optional<std::chrono::milliseconds> elapsed_since_insert(
+      const std::string &id);
+
+  /// Removes an entry and queues the write-behind delete.
+  void erase(std::string id);
+
+ private:
+  struct Entry {
+    std::string factors_hash;
+    std::string ip;
+    uint16_t port;
+    std::chrono::steady_clock::time_point expiry;
+  };
+
+  using Entries = std::unordered_map<std::string, Entry>;
+  using Pending = std::deque<PendingWrite>;
+
+  static void writer_function(std::shared_ptr<std::atomic_bool> stop_var,
+                              std::shared_ptr<std::mutex> mutex,
+                              std::shared_ptr<std::condition_variable> cv,
+                              std::shared_ptr<Pending> pending,
+                              FlushFn flush_fn);
+
+  // Drops expired entries. Expects "mutex" to be held.
+  void prune_expired_locked();
+
+  void cleanup();
+
+  std::chrono::seconds ttl;
+  std::shared_ptr<std::atomic_bool> stop_var;
+  std::shared_ptr<std::mutex> mutex;
+  std::shared_ptr<std::condition_variable> cv;
+  std::shared_ptr<Entries> entries;
+  std::shared_ptr<Pending> pending;
+  std::thread writer_thread;
+};
+
+#endif
@@ -0,0 +1,50 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "conn_arena.h"
+
+// Local includes
+#include "constants.h"
+
+ConnArena::ConnArena() : blocks() {
+  blocks.push_back(Block{std::make_unique<char[]>(CONN_ARENA_BLOCK_SIZE), 0,
+                         CONN_ARENA_BLOCK_SIZE});
+}
+
+void *ConnArena::alloc(size_t size) {
+  // Round up so the next allocation is aligned for any type.
+  constexpr size_t align = alignof(std::max_align_t);
+  size = (size + align - 1) / align * align;
+
+  Block *block = &blocks.back();
+  if (block->size - block->used < size) {
+    const size_t new_size =
+        size > CONN_ARENA_BLOCK_SIZE ? size : CONN_ARENA_BLOCK_SIZE;
+    blocks.push_back(Block{std::make_unique<char[]>(new_size), 0, new_size});
+    block = &blocks.back();
+  }
+
+  void *ptr = block->data.get() + block->used;
+  block->used += size;
+  return ptr;
+}
+
+void ConnArena::reset() {
+  blocks.resize(1);
+  blocks.front().used = 0;
+}
+
+size_t ConnArena::block_count() const { return blocks.size(); }
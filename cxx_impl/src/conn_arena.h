@@ -0,0 +1,61 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef SEODISPARATE_COM_POOR_MANS_ANUBIS_CONN_ARENA_H_
+#define SEODISPARATE_COM_POOR_MANS_ANUBIS_CONN_ARENA_H_
+
+// Standard library includes
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/// Bump arena for per-connection scratch memory (request read buffer and
+/// similar short-lived allocations). alloc() just advances an offset in the
+/// current block, and reset() reclaims everything at once, so a recycled
+/// arena serves any number of connections without repeated global-allocator
+/// round trips. Not thread-safe; each connection handler owns its own arena.
+class ConnArena {
+ public:
+  ConnArena();
+
+  // disallow copy
+  ConnArena(const ConnArena &) = delete;
+  ConnArena &operator=(const ConnArena &) = delete;
+
+  // allow move
+  ConnArena(ConnArena &&) = default;
+  ConnArena &operator=(ConnArena &&) = default;
+
+  /// Returned memory is aligned for any type and valid until reset().
+  void *alloc(size_t size);
+
+  /// Reclaims all allocations; blocks past the first are released so a
+  /// one-off oversized request does not pin memory for the arena's lifetime.
+  void reset();
+
+  size_t block_count() const;
+
+ private:
+  struct Block {
+    std::unique_ptr<char[]> data;
+    size_t used;
+    size_t size;
+  };
+
+  std::vector<Block> blocks;
+};
+
+#endif
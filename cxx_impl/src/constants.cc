@@ -165,6 +165,37 @@ const char *JS_FACTORS_WORKER =
     "    return \"A\";\n"
     "}\n"
     "\n"
+    "function varint_append(value, bytes) {\n"
+    "    while (value >= 128) {\n"
+    "        bytes.push((value % 128) + 128);\n"
+    "        value = Math.floor(value / 128);\n"
+    "    }\n"
+    "    bytes.push(value);\n"
+    "}\n"
+    "\n"
+    "function bytes_to_b64(bytes) {\n"
+    "    let out = \"\";\n"
+    "    let idx = 0;\n"
+    "    for (; idx + 3 <= bytes.length; idx += 3) {\n"
+    "        out += val_to_b64(bytes[idx] >> 2);\n"
+    "        out += val_to_b64(((bytes[idx] & 3) << 4) | (bytes[idx + 1] >> "
+    "4));\n"
+    "        out += val_to_b64(((bytes[idx + 1] & 15) << 2) | (bytes[idx + 2] "
+    ">> 6));\n"
+    "        out += val_to_b64(bytes[idx + 2] & 63);\n"
+    "    }\n"
+    "    if (idx + 1 === bytes.length) {\n"
+    "        out += val_to_b64(bytes[idx] >> 2);\n"
+    "        out += val_to_b64((bytes[idx] & 3) << 4);\n"
+    "    } else if (idx + 2 === bytes.length) {\n"
+    "        out += val_to_b64(bytes[idx] >> 2);\n"
+    "        out += val_to_b64(((bytes[idx] & 3) << 4) | (bytes[idx + 1] >> "
+    "4));\n"
+    "        out += val_to_b64((bytes[idx + 1] & 15) << 2);\n"
+    "    }\n"
+    "    return out;\n"
+    "}\n"
+    "\n"
     "function revb64_long_div_mod(b64_str, val) {\n"
     "    let result = \"\";\n"
     "    let rem = 0;\n"
@@ -194,8 +225,7 @@ const char *JS_FACTORS_WORKER =
     "          ret = inner_ret;\n"
     "      } else {\n"
     "          if (current_count !== 0) {\n"
-    "              result.push(String(current) + \"x\" + "
-    "String(current_count));\n"
+    "              result.push([current, current_count]);\n"
     "          }\n"
     "          if (current === 2) {\n"
     "              current += 1;\n"
@@ -210,14 +240,15 @@ const char *JS_FACTORS_WORKER =
     "  }\n"
     "  \n"
     "  if (current_count !== 0) {\n"
-    "      result.push(String(current) + \"x\" + String(current_count));\n"
+    "      result.push([current, current_count]);\n"
     "  }\n"
     "  \n"
-    "  let result_str = \"\";\n"
+    "  let bytes = [];\n"
     "  for (let idx = 0; idx < result.length; ++idx) {\n"
-    "    result_str += result[idx] + \" \";\n"
+    "    varint_append(result[idx][0], bytes);\n"
+    "    varint_append(result[idx][1], bytes);\n"
     "  }\n"
-    "  result_str = result_str.trim();\n"
+    "  let result_str = bytes_to_b64(bytes);\n"
     "\n"
     "    let xhr = new XMLHttpRequest();\n"
     "    let url = \"{API_URL}\";\n"
@@ -232,7 +263,7 @@ const char *JS_FACTORS_WORKER =
     "            }\n"
     "        }\n"
     "    };\n"
-    "    let data = JSON.stringify({\"type\": \"factors\",\n"
+    "    let data = JSON.stringify({\"type\": \"factors-bin\",\n"
     "                               \"id\": \"{UUID}\",\n"
     "                               \"factors\": result_str});\n"
     "    xhr.send(data);\n"
@@ -46,6 +46,8 @@ constexpr size_t CACHED_CLEAR_SECONDS = 3600;
 constexpr std::chrono::seconds CACHED_CLEAR_T =
     std::chrono::seconds(CACHED_CLEAR_SECONDS);
 
+constexpr size_t CACHED_ALLOWED_SHARD_COUNT = 16;
+
 constexpr std::chrono::milliseconds CONN_TRY_LOCK_DURATION =
     std::chrono::milliseconds(500);
 
@@ -56,10 +58,57 @@ constexpr uint32_t CHALLENGE_FACTORS_TIMEOUT_MINUTES = 1;
 
 constexpr int SOCKET_BACKLOG_SIZE = 2048;
 
+constexpr int EPOLL_MAX_EVENTS = 32;
+constexpr int EPOLL_WAIT_TIMEOUT_MILLISECONDS = 1000;
+
 constexpr uint32_t DEFAULT_THREAD_COUNT = 4;
 
+// Bounded admission queue in ThreadLimit (rounded up to a power of two);
+// connections past this are rejected with 503 instead of queueing.
+constexpr size_t THREAD_LIMIT_QUEUE_CAPACITY = 1024;
+
+// Requests served per kept-alive client connection before it is closed.
+constexpr uint16_t KEEP_ALIVE_MAX_REQUESTS = 100;
+
 constexpr uint_fast8_t CONNECTION_RETRY_COUNT_MAX = 100;
 constexpr std::chrono::milliseconds CONNECTION_RETRY_DELAY =
     std::chrono::milliseconds(50);
 
+// Stale-entry cleanup scheduler: how often the scheduler thread wakes up and
+// how many rows each batched delete may remove.
+constexpr std::chrono::seconds STALE_CLEANUP_INTERVAL =
+    std::chrono::seconds(10);
+constexpr uint32_t STALE_CLEANUP_BATCH_SIZE = 256;
+
+constexpr size_t MSQL_POOL_MAX_IDLE_SIZE = 16;
+
+constexpr size_t CURL_POOL_MAX_IDLE_SIZE = 16;
+
+constexpr std::chrono::seconds BACKEND_POOL_IDLE_TIMEOUT =
+    std::chrono::seconds(30);
+constexpr size_t BACKEND_POOL_MAX_IDLE_PER_KEY = 8;
+
+// First arena block fits the request read buffer plus parse/response scratch
+// so a typical connection never leaves its initial block.
+constexpr size_t CONN_ARENA_BLOCK_SIZE =
+    static_cast<size_t>(REQ_READ_BUF_SIZE) + 1024 * 8;
+constexpr size_t THREAD_DATA_POOL_MAX_IDLE_SIZE = 16;
+
+constexpr uint32_t CHALLENGE_POOL_CAPACITY = 64;
+
+// In-memory static asset cache: entry TTL, total byte cap, and the largest
+// single response body that will be cached.
+constexpr std::chrono::seconds ASSET_CACHE_TTL = std::chrono::seconds(60);
+constexpr size_t ASSET_CACHE_MAX_TOTAL_BYTES = 8 * 1024 * 1024;
+constexpr size_t ASSET_CACHE_MAX_ENTRY_BYTES = 1024 * 1024;
+
+// Adaptive challenge difficulty: solve-time EWMA weight (1/2^shift), the
+// solve time the controller steers toward, the active-connection count
+// treated as full load, and the clamp on solve-time scaling.
+constexpr uint64_t DIFFICULTY_EWMA_SHIFT = 3;
+constexpr uint64_t DIFFICULTY_TARGET_SOLVE_MILLISECONDS = 3000;
+constexpr uint64_t DIFFICULTY_FULL_LOAD_CONNECTIONS = 256;
+constexpr double DIFFICULTY_MIN_SCALE = 0.25;
+constexpr double DIFFICULTY_MAX_SCALE = 4.0;
+
 #endif
@@ -21,20 +21,33 @@
 #include <sqlite3.h>
 
 // Standard Library includes.
+#include <atomic>
 #include <cstdlib>
 #include <cstring>
 #include <format>
 #include <optional>
 #include <random>
+#include <thread>
+#include <utility>
 
 // Local includes.
+#include "challenge_pool.h"
+#include "challenge_store.h"
+#include "constants.h"
+#include "difficulty.h"
 #include "helpers.h"
+#include "poor_mans_print.h"
 #include "work.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 // Internal Functions.
 ////////////////////////////////////////////////////////////////////////////////
 
+// In-process authoritative store for live challenges; the db only sees
+// write-behind copies (for durability across restarts). Unset when
+// challenge_store_start() was never called.
+static std::optional<ChallengeStore> internal_challenge_store{};
+
 std::optional<std::tuple<PMA_SQL::SQLITECtx, PMA_SQL::ErrorT, std::string>>
 internal_exec_sqlite_statement(const PMA_SQL::SQLITECtx &ctx,
                                std::string stmt) {
@@ -135,26 +148,49 @@ std::string PMA_SQL::error_t_to_string(PMA_SQL::ErrorT err) {
       return "FailedToFetchFromAllowedIPs";
     case PMA_SQL::ErrorT::FAILED_TO_FETCH_FROM_ID_TO_PORT:
       return "FailedToFetchFromIDToPort";
+    case PMA_SQL::ErrorT::INVALID_COMPACT_ANSWER:
+      return "InvalidCompactAnswer";
     default:
       return "Unknown error";
   }
 }
 
-PMA_SQL::SQLITECtx::SQLITECtx() : ctx(nullptr) {}
+PMA_SQL::SQLITECtx::SQLITECtx()
+    : ctx(nullptr),
+      stmts_mutex(std::make_shared<std::mutex>()),
+      stmts(std::make_shared<
+            std::unordered_map<std::string, StmtCacheEntry> >()) {}
 
-PMA_SQL::SQLITECtx::SQLITECtx(std::string sqlite_path) : ctx(nullptr) {
+PMA_SQL::SQLITECtx::SQLITECtx(std::string sqlite_path) : SQLITECtx() {
   sqlite3 *db = nullptr;
-  int ret = sqlite3_open(sqlite_path.c_str(), &db);
+  // FULLMUTEX since a single long-lived ctx is shared across threads.
+  int ret = sqlite3_open_v2(
+      sqlite_path.c_str(), &db,
+      SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_FULLMUTEX,
+      nullptr);
 
   if (db && ret == SQLITE_OK) {
     ctx = reinterpret_cast<void *>(db);
     sqlite3_busy_timeout(db, 5000);
+    // WAL mode so that readers don't serialize behind the writer.
+    sqlite3_exec(db, "PRAGMA journal_mode=WAL", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "PRAGMA synchronous=NORMAL", nullptr, nullptr, nullptr);
+  } else if (db) {
+    sqlite3_close(db);
   }
 }
 
 PMA_SQL::SQLITECtx::~SQLITECtx() {
   if (ctx) {
     sqlite3 *db = reinterpret_cast<sqlite3 *>(ctx);
+    if (stmts) {
+      for (auto &pair : *stmts) {
+        if (pair.second.sqli3_stmt) {
+          sqlite3_finalize(pair.second.sqli3_stmt);
+        }
+      }
+      stmts->clear();
+    }
     sqlite3_close(db);
   }
 }
@@ -162,14 +198,18 @@ PMA_SQL::SQLITECtx::~SQLITECtx() {
 PMA_SQL::SQLITECtx::SQLITECtx(SQLITECtx &&other) {
   this->ctx = other.ctx;
   other.ctx = nullptr;
+  this->stmts_mutex = std::move(other.stmts_mutex);
+  this->stmts = std::move(other.stmts);
 }
 
-PMA_SQL::SQLITECtx *PMA_SQL::SQLITECtx::operator=(SQLITECtx &&other) {
-  this->~SQLITECtx();
-  this->ctx = other.ctx;
-  other.ctx = nullptr;
+PMA_SQL::SQLITECtx &PMA_SQL::SQLITECtx::operator=(SQLITECtx &&other) {
+  // Swap instead of destroying in place; "other"'s destructor then
+  // releases this ctx's previous resources.
+  std::swap(this->ctx, other.ctx);
+  std::swap(this->stmts_mutex, other.stmts_mutex);
+  std::swap(this->stmts, other.stmts);
 
-  return this;
+  return *this;
 }
 
 void *PMA_SQL::SQLITECtx::get_ctx() const { return ctx; }
@@ -178,6 +218,67 @@ sqlite3 *PMA_SQL::SQLITECtx::get_sqlite_ctx() const {
   return reinterpret_cast<sqlite3 *>(ctx);
 }
 
+sqlite3_stmt *PMA_SQL::SQLITECtx::acquire_stmt(const std::string &stmt) const {
+  sqlite3 *db = reinterpret_cast<sqlite3 *>(ctx);
+  if (!db) {
+    return nullptr;
+  }
+
+  if (stmts_mutex && stmts) {
+    std::lock_guard<std::mutex> lock(*stmts_mutex);
+    auto iter = stmts->find(stmt);
+    if (iter != stmts->end()) {
+      if (!iter->second.in_use) {
+        iter->second.in_use = true;
+        sqlite3_reset(iter->second.sqli3_stmt);
+        sqlite3_clear_bindings(iter->second.sqli3_stmt);
+        return iter->second.sqli3_stmt;
+      }
+      // Cached handle is in use on another thread. Fall through to prepare a
+      // temporary statement that release_stmt() will finalize.
+    } else {
+      sqlite3_stmt *prepared = nullptr;
+      int ret = sqlite3_prepare_v2(db, stmt.c_str(),
+                                   static_cast<int>(stmt.size()), &prepared,
+                                   nullptr);
+      if (ret != SQLITE_OK) {
+        return nullptr;
+      }
+      stmts->emplace(stmt, StmtCacheEntry{prepared, true});
+      return prepared;
+    }
+  }
+
+  sqlite3_stmt *prepared = nullptr;
+  int ret = sqlite3_prepare_v2(db, stmt.c_str(), static_cast<int>(stmt.size()),
+                               &prepared, nullptr);
+  if (ret != SQLITE_OK) {
+    return nullptr;
+  }
+  return prepared;
+}
+
+void PMA_SQL::SQLITECtx::release_stmt(sqlite3_stmt *sqli3_stmt) const {
+  if (!sqli3_stmt) {
+    return;
+  }
+
+  if (stmts_mutex && stmts) {
+    std::lock_guard<std::mutex> lock(*stmts_mutex);
+    // The set of statement texts is small and fixed per run, so a linear scan
+    // for the owning entry is cheap.
+    for (auto &pair : *stmts) {
+      if (pair.second.sqli3_stmt == sqli3_stmt) {
+        sqlite3_reset(sqli3_stmt);
+        pair.second.in_use = false;
+        return;
+      }
+    }
+  }
+
+  sqlite3_finalize(sqli3_stmt);
+}
+
 void PMA_SQL::exec_sqlite_stmt_str_cleanup(void *ud) {
   char *buf = reinterpret_cast<char *>(ud);
   delete[] buf;
@@ -269,78 +370,148 @@ PMA_SQL::init_sqlite(std::string filepath) {
                                                          ErrorT::SUCCESS, {});
 }
 
-std::tuple<PMA_SQL::ErrorT, std::string> PMA_SQL::cleanup_stale_id_to_ports(
-    PMA_SQL::SQLITECtx &ctx, uint32_t challenge_timeout) {
-  sqlite3 *db = ctx.get_sqlite_ctx();
-  if (!db) {
-    return {ErrorT::DB_ALREADY_FAILED_TO_INIT, {}};
-  }
-
-  std::string stmt = std::format(
-      "DELETE FROM ID_TO_PORT WHERE datetime(ON_TIME, '{} minutes') < "
-      "datetime('now')",
-      challenge_timeout);
+void PMA_SQL::challenge_store_start(PMA_SQL::SQLITECtx &ctx) {
+  SQLITECtx *ctx_ptr = &ctx;
+  internal_challenge_store.emplace(
+      std::chrono::seconds(CHALLENGE_FACTORS_TIMEOUT_MINUTES * 60),
+      [ctx_ptr](const ChallengeStore::PendingWrite &write) {
+        if (write.is_delete) {
+          exec_sqlite_statement<0, std::string>(
+              *ctx_ptr, "DELETE FROM CHALLENGE_FACTOR WHERE ID = ?",
+              std::nullopt, write.id);
+        } else {
+          SqliteStmtRow<>::exec_sqlite_stmt_with_rows<
+              0, std::string, std::string, std::string, int>(
+              *ctx_ptr,
+              "INSERT INTO CHALLENGE_FACTOR (ID, FACTORS, IP, PORT) VALUES "
+              "(?, ?, ?, ?)",
+              std::nullopt, write.id, write.factors_hash, write.ip,
+              write.port);
+        }
+      });
+}
 
-  {
-    auto opt_tuple = internal_exec_sqlite_statement(ctx, stmt);
-    if (opt_tuple.has_value()) {
-      const auto [unused, err_enum, err_msg] = std::move(opt_tuple.value());
-      return {err_enum, err_msg};
+void PMA_SQL::challenge_store_stop() { internal_challenge_store.reset(); }
+
+// Cleanup scheduler thread state; see cleanup_scheduler_start().
+static std::atomic_bool internal_cleanup_scheduler_running{false};
+static std::thread internal_cleanup_scheduler_thread{};
+
+void PMA_SQL::cleanup_scheduler_start(PMA_SQL::SQLITECtx &ctx,
+                                      uint32_t challenge_timeout,
+                                      uint32_t allowed_timeout) {
+  if (internal_cleanup_scheduler_running.exchange(true)) {
+    return;
+  }
+  SQLITECtx *ctx_ptr = &ctx;
+  internal_cleanup_scheduler_thread = std::thread([ctx_ptr, challenge_timeout,
+                                                   allowed_timeout]() {
+    auto time_prev = std::chrono::steady_clock::now();
+    while (internal_cleanup_scheduler_running.load()) {
+      std::this_thread::sleep_for(SLEEP_MILLISECONDS_CHRONO);
+      const auto time_now = std::chrono::steady_clock::now();
+      if (time_now - time_prev < STALE_CLEANUP_INTERVAL) {
+        continue;
+      }
+      time_prev = time_now;
+
+      // One batch at a time per table, repeating while whole batches are
+      // being deleted, so a crawl-wave backlog drains without ever holding
+      // the db for one big DELETE scan.
+      const auto drain_fn =
+          [](std::tuple<ErrorT, std::string, size_t> (*cleanup_fn)(
+                 SQLITECtx &, uint32_t, uint32_t),
+             SQLITECtx &ctx, uint32_t timeout) {
+            while (internal_cleanup_scheduler_running.load()) {
+              const auto [err, err_msg, deleted] =
+                  cleanup_fn(ctx, timeout, STALE_CLEANUP_BATCH_SIZE);
+              if (err != ErrorT::SUCCESS) {
+                PMA_EPrintln("WARNING: Stale-entry cleanup failed: {}, {}",
+                             error_t_to_string(err), err_msg);
+                return;
+              } else if (deleted < STALE_CLEANUP_BATCH_SIZE) {
+                return;
+              }
+            }
+          };
+
+      drain_fn(cleanup_stale_id_to_ports, *ctx_ptr, challenge_timeout);
+      drain_fn(cleanup_stale_challenges, *ctx_ptr, challenge_timeout);
+      drain_fn(cleanup_stale_entries, *ctx_ptr, allowed_timeout);
     }
-  }
+  });
+}
 
-  return {ErrorT::SUCCESS, {}};
+void PMA_SQL::cleanup_scheduler_stop() {
+  if (!internal_cleanup_scheduler_running.exchange(false)) {
+    return;
+  }
+  if (internal_cleanup_scheduler_thread.joinable()) {
+    internal_cleanup_scheduler_thread.join();
+  }
 }
 
-std::tuple<PMA_SQL::ErrorT, std::string> PMA_SQL::cleanup_stale_challenges(
-    PMA_SQL::SQLITECtx &ctx, uint32_t challenge_timeout) {
+// Shared body of the cleanup_stale_* functions: deletes rows whose ON_TIME
+// is older than "timeout" minutes. The comparison keeps ON_TIME bare (the
+// offset is applied to 'now' instead) so the ON_TIME index is usable, and a
+// nonzero limit bounds the delete through a rowid subquery since DELETE ...
+// LIMIT needs a nonstandard sqlite build flag.
+static std::tuple<PMA_SQL::ErrorT, std::string, size_t>
+internal_cleanup_stale_table(PMA_SQL::SQLITECtx &ctx, const char *table,
+                             uint32_t timeout, uint32_t limit) {
   sqlite3 *db = ctx.get_sqlite_ctx();
   if (!db) {
-    return {ErrorT::DB_ALREADY_FAILED_TO_INIT, {}};
+    return {PMA_SQL::ErrorT::DB_ALREADY_FAILED_TO_INIT, {}, 0};
   }
 
-  std::string stmt = std::format(
-      "DELETE FROM CHALLENGE_FACTOR WHERE datetime(ON_TIME, '{} minutes') < "
-      "datetime('now')",
-      challenge_timeout);
+  std::string stmt;
+  if (limit == 0) {
+    stmt = std::format(
+        "DELETE FROM {} WHERE ON_TIME < datetime('now', '-{} minutes')", table,
+        timeout);
+  } else {
+    stmt = std::format(
+        "DELETE FROM {} WHERE rowid IN (SELECT rowid FROM {} WHERE ON_TIME < "
+        "datetime('now', '-{} minutes') LIMIT {})",
+        table, table, timeout, limit);
+  }
 
   {
     auto opt_tuple = internal_exec_sqlite_statement(ctx, stmt);
     if (opt_tuple.has_value()) {
-      const auto [unused, error_enum, msg] = std::move(opt_tuple.value());
-      return {error_enum, msg};
+      const auto [unused, err_enum, err_msg] = std::move(opt_tuple.value());
+      return {err_enum, err_msg, 0};
     }
   }
 
-  return {ErrorT::SUCCESS, {}};
+  return {PMA_SQL::ErrorT::SUCCESS, {},
+          static_cast<size_t>(sqlite3_changes(db))};
 }
 
-std::tuple<PMA_SQL::ErrorT, std::string> PMA_SQL::cleanup_stale_entries(
-    PMA_SQL::SQLITECtx &ctx, uint32_t allowed_timeout) {
-  sqlite3 *db = ctx.get_sqlite_ctx();
-  if (!db) {
-    return {ErrorT::DB_ALREADY_FAILED_TO_INIT, {}};
-  }
-
-  std::string stmt = std::format(
-      "DELETE FROM ALLOWED_IP WHERE datetime(ON_TIME, '{} minutes') < "
-      "datetime('now')",
-      allowed_timeout);
+std::tuple<PMA_SQL::ErrorT, std::string, size_t>
+PMA_SQL::cleanup_stale_id_to_ports(PMA_SQL::SQLITECtx &ctx,
+                                   uint32_t challenge_timeout,
+                                   uint32_t limit) {
+  return internal_cleanup_stale_table(ctx, "ID_TO_PORT", challenge_timeout,
+                                      limit);
+}
 
-  {
-    auto opt_tuple = internal_exec_sqlite_statement(ctx, stmt);
-    if (opt_tuple.has_value()) {
-      const auto [unused, error_enum, msg] = std::move(opt_tuple.value());
-      return {error_enum, msg};
-    }
-  }
+std::tuple<PMA_SQL::ErrorT, std::string, size_t>
+PMA_SQL::cleanup_stale_challenges(PMA_SQL::SQLITECtx &ctx,
+                                  uint32_t challenge_timeout, uint32_t limit) {
+  return internal_cleanup_stale_table(ctx, "CHALLENGE_FACTOR",
+                                      challenge_timeout, limit);
+}
 
-  return {ErrorT::SUCCESS, {}};
+std::tuple<PMA_SQL::ErrorT, std::string, size_t>
+PMA_SQL::cleanup_stale_entries(PMA_SQL::SQLITECtx &ctx,
+                               uint32_t allowed_timeout, uint32_t limit) {
+  return internal_cleanup_stale_table(ctx, "ALLOWED_IP", allowed_timeout,
+                                      limit);
 }
 
 std::tuple<PMA_SQL::ErrorT, std::string, std::string> PMA_SQL::init_id_to_port(
-    SQLITECtx &ctx, uint16_t port,
-    std::vector<uint8_t> (*hasher_fn)(void *data, size_t size)) {
+    SQLITECtx &ctx, uint16_t port, PMA_HELPER::HasherFn hasher_fn) {
   bool exists_with_id = true;
   std::string id_hashed;
   while (exists_with_id) {
@@ -387,8 +558,7 @@ std::tuple<PMA_SQL::ErrorT, std::string, std::string> PMA_SQL::init_id_to_port(
 std::tuple<PMA_SQL::ErrorT, std::string, std::string, std::string>
 PMA_SQL::generate_challenge(SQLITECtx &ctx, uint64_t quads,
                             std::string client_ip, std::string hashed_id,
-                            std::vector<uint8_t> (*hasher_fn)(void *data,
-                                                              size_t size)) {
+                            PMA_HELPER::HasherFn hasher_fn) {
   uint16_t port = 0;
   {
     const auto [err_enum, err_msg, opt_vec] =
@@ -412,7 +582,7 @@ PMA_SQL::generate_challenge(SQLITECtx &ctx, uint64_t quads,
                              std::nullopt, hashed_id);
   }
 
-  Work_Factors factors = work_generate_target_factors2(quads);
+  Work_Factors factors = challenge_pool_get(quads);
   GenericCleanup<Work_Factors> factors_cleanup(
       factors, [](Work_Factors *ptr) { work_cleanup_factors2(ptr); });
 
@@ -440,6 +610,12 @@ PMA_SQL::generate_challenge(SQLITECtx &ctx, uint64_t quads,
 
     hash_id = PMA_HELPER::next_hash(optv.value(), hasher_fn);
 
+    if (internal_challenge_store.has_value() &&
+        internal_challenge_store->contains(hash_id)) {
+      exists_with_id = true;
+      continue;
+    }
+
     const auto [err_enum, err_msg, opt_vec] =
         SqliteStmtRow<std::string>::exec_sqlite_stmt_with_rows<0, std::string>(
             ctx, "SELECT ID FROM CHALLENGE_FACTOR WHERE ID = ?", std::nullopt,
@@ -468,8 +644,11 @@ PMA_SQL::generate_challenge(SQLITECtx &ctx, uint64_t quads,
     hash = PMA_HELPER::raw_to_hexadecimal<BLAKE3_OUT_LEN>(hash_data);
   }
 
-  // Insert challenge into db.
-  {
+  // Insert challenge into the store (write-behind to db), or directly into
+  // the db if the store is not running.
+  if (internal_challenge_store.has_value()) {
+    internal_challenge_store->insert(hash_id, hash, client_ip, port);
+  } else {
     const auto [err_enum, err_msg, opt_vec] =
         SqliteStmtRow<>::exec_sqlite_stmt_with_rows<0, std::string, std::string,
                                                     std::string, int>(
@@ -486,20 +665,44 @@ PMA_SQL::generate_challenge(SQLITECtx &ctx, uint64_t quads,
   return {ErrorT::SUCCESS, challenge_str, answer_str, hash_id};
 }
 
-std::tuple<PMA_SQL::ErrorT, std::string, uint16_t> PMA_SQL::verify_answer(
-    SQLITECtx &ctx, std::string answer, std::string ipaddr, std::string id) {
-  std::string hash;
-  // get hash
-  {
-    std::array<uint8_t, BLAKE3_OUT_LEN> hash_data;
-    blake3_hasher hasher;
-    blake3_hasher_init(&hasher);
+// Shared tail of verify_answer/verify_answer_compact: the answer hash is
+// already computed, look it up and promote the client to ALLOWED_IP.
+static std::tuple<PMA_SQL::ErrorT, std::string, uint16_t>
+internal_verify_answer_hash(PMA_SQL::SQLITECtx &ctx, const std::string &hash,
+                            const std::string &ipaddr, const std::string &id) {
+  using ErrorT = PMA_SQL::ErrorT;
+  using PMA_SQL::exec_sqlite_statement;
+  using PMA_SQL::SqliteStmtRow;
+
+  if (internal_challenge_store.has_value()) {
+    auto entry_opt = internal_challenge_store->lookup(id, hash);
+    if (entry_opt.has_value()) {
+      const auto [stored_ip, port] = entry_opt.value();
+      if (stored_ip != ipaddr) {
+        return {ErrorT::CLIENT_IP_DOES_NOT_MATCH_STORED_IP,
+                "client ip address mismatch", 0};
+      }
 
-    blake3_hasher_update(&hasher, answer.c_str(), answer.size());
+      // A verified answer means the entry's age is the client's solve time.
+      const auto elapsed_opt =
+          internal_challenge_store->elapsed_since_insert(id);
+      if (elapsed_opt.has_value()) {
+        difficulty_controller_get().record_solve(elapsed_opt.value());
+      }
 
-    blake3_hasher_finalize(&hasher, hash_data.data(), BLAKE3_OUT_LEN);
+      internal_challenge_store->erase(id);
 
-    hash = PMA_HELPER::raw_to_hexadecimal<BLAKE3_OUT_LEN>(hash_data);
+      const auto [err_enum, err_msg] = exec_sqlite_statement<0>(
+          ctx, "INSERT INTO ALLOWED_IP (IP, PORT) VALUES (?, ?)", std::nullopt,
+          ipaddr, port);
+      if (err_enum != ErrorT::SUCCESS) {
+        return {err_enum, err_msg, 0};
+      }
+
+      return {ErrorT::SUCCESS, {}, port};
+    }
+    // Miss: fall through to the db in case the challenge was persisted by a
+    // previous run of this process.
   }
 
   std::string stored_ip;
@@ -550,6 +753,71 @@ std::tuple<PMA_SQL::ErrorT, std::string, uint16_t> PMA_SQL::verify_answer(
   return {ErrorT::SUCCESS, {}, port};
 }
 
+std::tuple<PMA_SQL::ErrorT, std::string, uint16_t> PMA_SQL::verify_answer(
+    SQLITECtx &ctx, std::string answer, std::string ipaddr, std::string id) {
+  std::string hash;
+  // get hash
+  {
+    std::array<uint8_t, BLAKE3_OUT_LEN> hash_data;
+    blake3_hasher hasher;
+    blake3_hasher_init(&hasher);
+
+    blake3_hasher_update(&hasher, answer.c_str(), answer.size());
+
+    blake3_hasher_finalize(&hasher, hash_data.data(), BLAKE3_OUT_LEN);
+
+    hash = PMA_HELPER::raw_to_hexadecimal<BLAKE3_OUT_LEN>(hash_data);
+  }
+
+  return internal_verify_answer_hash(ctx, hash, ipaddr, id);
+}
+
+std::tuple<PMA_SQL::ErrorT, std::string, uint16_t>
+PMA_SQL::verify_answer_compact(SQLITECtx &ctx, std::string_view answer,
+                               std::string ipaddr, std::string id) {
+  const auto bytes_opt = PMA_HELPER::b64_to_bytes(answer);
+  if (!bytes_opt.has_value() || bytes_opt.value().empty()) {
+    return {ErrorT::INVALID_COMPACT_ANSWER, "malformed compact answer", 0};
+  }
+
+  // Stream the canonical factors text into the hasher pair by pair.
+  blake3_hasher hasher;
+  blake3_hasher_init(&hasher);
+
+  const std::vector<uint8_t> &bytes = bytes_opt.value();
+  size_t idx = 0;
+  bool first = true;
+  while (idx < bytes.size()) {
+    const auto [factor, factor_consumed] =
+        PMA_HELPER::varint_decode(bytes.data() + idx, bytes.size() - idx);
+    if (factor_consumed == 0) {
+      return {ErrorT::INVALID_COMPACT_ANSWER, "truncated factor varint", 0};
+    }
+    idx += factor_consumed;
+
+    const auto [count, count_consumed] =
+        PMA_HELPER::varint_decode(bytes.data() + idx, bytes.size() - idx);
+    if (count_consumed == 0) {
+      return {ErrorT::INVALID_COMPACT_ANSWER, "truncated exponent varint", 0};
+    }
+    idx += count_consumed;
+
+    const std::string part = first ? std::format("{}x{}", factor, count)
+                                   : std::format(" {}x{}", factor, count);
+    first = false;
+    blake3_hasher_update(&hasher, part.c_str(), part.size());
+  }
+
+  std::string hash;
+  {
+    std::array<uint8_t, BLAKE3_OUT_LEN> hash_data;
+    blake3_hasher_finalize(&hasher, hash_data.data(), BLAKE3_OUT_LEN);
+    hash = PMA_HELPER::raw_to_hexadecimal<BLAKE3_OUT_LEN>(hash_data);
+  }
+
+  return internal_verify_answer_hash(ctx, hash, ipaddr, id);
+}
+
 std::tuple<PMA_SQL::ErrorT, std::string, std::unordered_set<uint16_t>>
 PMA_SQL::get_allowed_ip_ports(SQLITECtx &ctx, std::string ipaddr) {
   const auto [err_enum, err_msg, opt_vec] =
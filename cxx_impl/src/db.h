@@ -21,11 +21,14 @@
 #include <cstdint>
 #include <cstring>
 #include <format>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <tuple>
 #include <type_traits>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -33,6 +36,7 @@
 #include <sqlite3.h>
 
 // local includes
+#include "helpers.h"
 #include "poor_mans_print.h"
 
 namespace PMA_SQL {
@@ -46,7 +50,8 @@ enum class ErrorT {
   EXEC_GENERIC_INVALID_STATE,
   CLIENT_IP_DOES_NOT_MATCH_STORED_IP,
   FAILED_TO_FETCH_FROM_ALLOWED_IPS,
-  FAILED_TO_FETCH_FROM_ID_TO_PORT
+  FAILED_TO_FETCH_FROM_ID_TO_PORT,
+  INVALID_COMPACT_ANSWER
 };
 
 std::string error_t_to_string(ErrorT err);
@@ -61,14 +66,30 @@ class SQLITECtx {
   SQLITECtx *operator=(const SQLITECtx &) = delete;
 
   SQLITECtx(SQLITECtx &&);
-  SQLITECtx *operator=(SQLITECtx &&);
+  SQLITECtx &operator=(SQLITECtx &&);
 
   void *get_ctx() const;
 
   sqlite3 *get_sqlite_ctx() const;
 
+  // Returns a prepared statement for the given SQL text, reusing a cached
+  // handle (reset with cleared bindings) when one exists and is not in use.
+  // Returns nullptr on prepare failure. Must be paired with release_stmt().
+  sqlite3_stmt *acquire_stmt(const std::string &stmt) const;
+
+  // Returns a statement from acquire_stmt() to the cache, or finalizes it if
+  // it is not a cached handle.
+  void release_stmt(sqlite3_stmt *sqli3_stmt) const;
+
  private:
+  struct StmtCacheEntry {
+    sqlite3_stmt *sqli3_stmt;
+    bool in_use;
+  };
+
   void *ctx;
+  std::shared_ptr<std::mutex> stmts_mutex;
+  std::shared_ptr<std::unordered_map<std::string, StmtCacheEntry> > stmts;
 };
 
 void exec_sqlite_stmt_str_cleanup(void *ud);
@@ -121,29 +142,49 @@ struct SqliteStmtRow {
 // string is err message.
 std::tuple<SQLITECtx, ErrorT, std::string> init_sqlite(std::string filepath);
 
-// string is err message.
-std::tuple<ErrorT, std::string> cleanup_stale_id_to_ports(SQLITECtx &ctx,
-                                                          uint32_t timeout);
+// Starts the in-process challenge store used by generate_challenge and
+// verify_answer, with write-behind persistence of challenge rows into the
+// given ctx. The ctx must outlive the store; stop the store with
+// challenge_store_stop() before the ctx is cleaned up.
+void challenge_store_start(SQLITECtx &ctx);
 
-// string is err message.
-std::tuple<ErrorT, std::string> cleanup_stale_challenges(SQLITECtx &ctx,
-                                                         uint32_t timeout);
+void challenge_store_stop();
 
-// string is err message.
-std::tuple<ErrorT, std::string> cleanup_stale_entries(SQLITECtx &ctx,
-                                                      uint32_t timeout);
+// Starts the background scheduler that incrementally expires stale
+// ID_TO_PORT/CHALLENGE_FACTOR/ALLOWED_IP rows in LIMIT-ed batches (on the
+// ON_TIME indexes), so no request ever carries cleanup work. The ctx must
+// outlive the scheduler; stop it with cleanup_scheduler_stop() before the
+// ctx is cleaned up.
+void cleanup_scheduler_start(SQLITECtx &ctx, uint32_t challenge_timeout,
+                             uint32_t allowed_timeout);
+
+void cleanup_scheduler_stop();
+
+// string is err message, size_t is rows deleted. A nonzero limit caps the
+// rows deleted per call (batched cleanup); 0 deletes all stale rows.
+std::tuple<ErrorT, std::string, size_t> cleanup_stale_id_to_ports(
+    SQLITECtx &ctx, uint32_t timeout, uint32_t limit = 0);
+
+// string is err message, size_t is rows deleted. A nonzero limit caps the
+// rows deleted per call (batched cleanup); 0 deletes all stale rows.
+std::tuple<ErrorT, std::string, size_t> cleanup_stale_challenges(
+    SQLITECtx &ctx, uint32_t timeout, uint32_t limit = 0);
+
+// string is err message, size_t is rows deleted. A nonzero limit caps the
+// rows deleted per call (batched cleanup); 0 deletes all stale rows.
+std::tuple<ErrorT, std::string, size_t> cleanup_stale_entries(
+    SQLITECtx &ctx, uint32_t timeout, uint32_t limit = 0);
 
 // last string is id.
 std::tuple<ErrorT, std::string, std::string> init_id_to_port(
-    SQLITECtx &ctx, uint16_t port,
-    std::vector<uint8_t> (*hasher_fn)(void *data, size_t size));
+    SQLITECtx &ctx, uint16_t port, PMA_HELPER::HasherFn hasher_fn);
 
 // On error, first string is err message. On SUCCESS, first string is challenge
 // in base64 and second string is hashed answer.
 // Last string is id.
 std::tuple<ErrorT, std::string, std::string, std::string> generate_challenge(
     SQLITECtx &ctx, uint64_t quads, std::string client_ip, std::string id,
-    std::vector<uint8_t> (*hasher_fn)(void *data, size_t size));
+    PMA_HELPER::HasherFn hasher_fn);
 
 // string is error msg, uint16_t is destination port of initial challenge
 // generation request.
@@ -152,6 +193,14 @@ std::tuple<ErrorT, std::string, uint16_t> verify_answer(SQLITECtx &ctx,
                                                         std::string ipaddr,
                                                         std::string id);
 
+// Same as verify_answer, but the answer is base64-wrapped little-endian
+// varint (factor, exponent) pairs. The canonical "NxM NxM ..." text is
+// reconstructed pair by pair and streamed into the hasher, so the full
+// answer string is never materialized.
+std::tuple<ErrorT, std::string, uint16_t> verify_answer_compact(
+    SQLITECtx &ctx, std::string_view answer, std::string ipaddr,
+    std::string id);
+
 std::tuple<ErrorT, std::string, std::unordered_set<uint16_t>>
 get_allowed_ip_ports(SQLITECtx &ctx, std::string ipaddr);
 
@@ -176,16 +225,12 @@ std::tuple<PMA_SQL::ErrorT, std::string> PMA_SQL::exec_sqlite_statement(
 
   int ret = sqlite3_step(sqli3_stmt.value());
   if (ret != SQLITE_OK && ret != SQLITE_DONE) {
-    sqlite3_finalize(sqli3_stmt.value());
+    ctx.release_stmt(sqli3_stmt.value());
     return {PMA_SQL::ErrorT::EXEC_GENERIC_INVALID_STATE,
             "Failed to step generic exec stmt"};
   }
 
-  ret = sqlite3_finalize(sqli3_stmt.value());
-  if (ret != SQLITE_OK) {
-    return {PMA_SQL::ErrorT::EXEC_GENERIC_INVALID_STATE,
-            "Failed to finalize generic exec stmt"};
-  }
+  ctx.release_stmt(sqli3_stmt.value());
 
   return {PMA_SQL::ErrorT::SUCCESS, "Success"};
 }
@@ -199,7 +244,7 @@ std::tuple<PMA_SQL::ErrorT, std::string> PMA_SQL::exec_sqlite_statement(
       if (sizeof(Arg) > 4) {
         int ret = sqlite3_bind_int64(sqli3_stmt.value(), IDX, arg);
         if (ret != SQLITE_OK) {
-          sqlite3_finalize(sqli3_stmt.value());
+          ctx.release_stmt(sqli3_stmt.value());
           return {PMA_SQL::ErrorT::FAILED_TO_PREPARE_EXEC_GENERIC,
                   "Bind int64 failed"};
         }
@@ -208,7 +253,7 @@ std::tuple<PMA_SQL::ErrorT, std::string> PMA_SQL::exec_sqlite_statement(
       } else {
         int ret = sqlite3_bind_int(sqli3_stmt.value(), IDX, arg);
         if (ret != SQLITE_OK) {
-          sqlite3_finalize(sqli3_stmt.value());
+          ctx.release_stmt(sqli3_stmt.value());
           return {PMA_SQL::ErrorT::FAILED_TO_PREPARE_EXEC_GENERIC,
                   "Bind int failed"};
         }
@@ -222,7 +267,7 @@ std::tuple<PMA_SQL::ErrorT, std::string> PMA_SQL::exec_sqlite_statement(
                                   static_cast<int>(arg.size()),
                                   exec_sqlite_stmt_str_cleanup);
       if (ret != SQLITE_OK) {
-        sqlite3_finalize(sqli3_stmt.value());
+        ctx.release_stmt(sqli3_stmt.value());
         return {PMA_SQL::ErrorT::FAILED_TO_PREPARE_EXEC_GENERIC,
                 "Bind text failed"};
       }
@@ -232,7 +277,7 @@ std::tuple<PMA_SQL::ErrorT, std::string> PMA_SQL::exec_sqlite_statement(
       // TODO handle more than integers and strings
       int ret = sqlite3_bind_null(sqli3_stmt.value(), IDX);
       if (ret != SQLITE_OK) {
-        sqlite3_finalize(sqli3_stmt.value());
+        ctx.release_stmt(sqli3_stmt.value());
         return {PMA_SQL::ErrorT::FAILED_TO_PREPARE_EXEC_GENERIC,
                 "Bind NULL failed"};
       }
@@ -240,13 +285,10 @@ std::tuple<PMA_SQL::ErrorT, std::string> PMA_SQL::exec_sqlite_statement(
                                                      args...);
     }
   } else {
-    sqli3_stmt = nullptr;
-    int ret = sqlite3_prepare_v2(ctx.get_sqlite_ctx(), stmt.c_str(),
-                                 static_cast<int>(stmt.size()),
-                                 &sqli3_stmt.value(), nullptr);
-    if (ret != SQLITE_OK) {
+    sqli3_stmt = ctx.acquire_stmt(stmt);
+    if (sqli3_stmt.value() == nullptr) {
       return {PMA_SQL::ErrorT::FAILED_TO_PREPARE_EXEC_GENERIC,
-              "sqlite3_prepare_v2 failed"};
+              "acquire_stmt failed"};
     }
     return exec_sqlite_statement<1, Arg, Args...>(ctx, stmt, sqli3_stmt, arg,
                                                   args...);
@@ -279,14 +321,14 @@ PMA_SQL::SqliteStmtRow<SArgs...>::exec_sqlite_stmt_fetch_rows(
     std::vector<PMA_SQL::SqliteStmtRow<SArgs...>> v) {
   int ret = sqlite3_step(sqli3_stmt.value());
   if (ret == SQLITE_DONE) {
-    sqlite3_finalize(sqli3_stmt.value());
+    ctx.release_stmt(sqli3_stmt.value());
     return {ErrorT::SUCCESS, {}, v};
   } else if (ret == SQLITE_ROW) {
     v.push_back({});
     return exec_sqlite_stmt_fetch_rows<0, SArgs...>(ctx, stmt, sqli3_stmt,
                                                     std::move(v));
   } else {
-    sqlite3_finalize(sqli3_stmt.value());
+    ctx.release_stmt(sqli3_stmt.value());
     return {ErrorT::EXEC_GENERIC_INVALID_STATE, "sqlite3_step failed",
             std::nullopt};
   }
@@ -313,7 +355,7 @@ PMA_SQL::SqliteStmtRow<SArgs...>::exec_sqlite_stmt_fetch_rows(
         sqlite3_column_text(sqli3_stmt.value(), IDX));
     std::get<IDX>(v.back().row) = val;
   } else {
-    sqlite3_finalize(sqli3_stmt.value());
+    ctx.release_stmt(sqli3_stmt.value());
     return {ErrorT::EXEC_GENERIC_INVALID_STATE, "Arg not int or std::string",
             std::nullopt};
   }
@@ -329,19 +371,16 @@ PMA_SQL::SqliteStmtRow<SArgs...>::exec_sqlite_stmt_with_rows(
     const PMA_SQL::SQLITECtx &ctx, std::string stmt,
     std::optional<sqlite3_stmt *> sqli3_stmt) {
   if (!sqli3_stmt.has_value()) {
-    sqli3_stmt = nullptr;
-    int ret = sqlite3_prepare_v2(ctx.get_sqlite_ctx(), stmt.c_str(),
-                                 static_cast<int>(stmt.size()),
-                                 &sqli3_stmt.value(), nullptr);
-    if (ret != SQLITE_OK) {
+    sqli3_stmt = ctx.acquire_stmt(stmt);
+    if (sqli3_stmt.value() == nullptr) {
       return {PMA_SQL::ErrorT::FAILED_TO_PREPARE_EXEC_GENERIC,
-              "sqlite3_prepare_v2 failed", std::nullopt};
+              "acquire_stmt failed", std::nullopt};
     }
   }
 
   int ret = sqlite3_step(sqli3_stmt.value());
   if (ret == SQLITE_DONE) {
-    sqlite3_finalize(sqli3_stmt.value());
+    ctx.release_stmt(sqli3_stmt.value());
     return {ErrorT::SUCCESS, {}, std::nullopt};
   } else if (ret == SQLITE_ROW) {
     std::vector<SqliteStmtRow<SArgs...>> v;
@@ -349,7 +388,7 @@ PMA_SQL::SqliteStmtRow<SArgs...>::exec_sqlite_stmt_with_rows(
     return exec_sqlite_stmt_fetch_rows<0, SArgs...>(ctx, stmt, sqli3_stmt,
                                                     std::move(v));
   } else {
-    sqlite3_finalize(sqli3_stmt.value());
+    ctx.release_stmt(sqli3_stmt.value());
     return {ErrorT::EXEC_GENERIC_INVALID_STATE, "sqlite3_step failed",
             std::nullopt};
   }
@@ -367,7 +406,7 @@ PMA_SQL::SqliteStmtRow<SArgs...>::exec_sqlite_stmt_with_rows(
       if (sizeof(Arg) > 4) {
         int ret = sqlite3_bind_int64(sqli3_stmt.value(), IDX, arg);
         if (ret != SQLITE_OK) {
-          sqlite3_finalize(sqli3_stmt.value());
+          ctx.release_stmt(sqli3_stmt.value());
           return {PMA_SQL::ErrorT::FAILED_TO_PREPARE_EXEC_GENERIC,
                   "Bind int64 failed", std::nullopt};
         }
@@ -376,7 +415,7 @@ PMA_SQL::SqliteStmtRow<SArgs...>::exec_sqlite_stmt_with_rows(
       } else {
         int ret = sqlite3_bind_int(sqli3_stmt.value(), IDX, arg);
         if (ret != SQLITE_OK) {
-          sqlite3_finalize(sqli3_stmt.value());
+          ctx.release_stmt(sqli3_stmt.value());
           return {PMA_SQL::ErrorT::FAILED_TO_PREPARE_EXEC_GENERIC,
                   "Bind int failed", std::nullopt};
         }
@@ -390,7 +429,7 @@ PMA_SQL::SqliteStmtRow<SArgs...>::exec_sqlite_stmt_with_rows(
                                   static_cast<int>(arg.size()),
                                   exec_sqlite_stmt_str_cleanup);
       if (ret != SQLITE_OK) {
-        sqlite3_finalize(sqli3_stmt.value());
+        ctx.release_stmt(sqli3_stmt.value());
         return {PMA_SQL::ErrorT::FAILED_TO_PREPARE_EXEC_GENERIC,
                 "Bind text failed", std::nullopt};
       }
@@ -400,7 +439,7 @@ PMA_SQL::SqliteStmtRow<SArgs...>::exec_sqlite_stmt_with_rows(
       // TODO handle more than integers and strings
       int ret = sqlite3_bind_null(sqli3_stmt.value(), IDX);
       if (ret != SQLITE_OK) {
-        sqlite3_finalize(sqli3_stmt.value());
+        ctx.release_stmt(sqli3_stmt.value());
         return {PMA_SQL::ErrorT::FAILED_TO_PREPARE_EXEC_GENERIC,
                 "Bind NULL failed", std::nullopt};
       }
@@ -408,13 +447,10 @@ PMA_SQL::SqliteStmtRow<SArgs...>::exec_sqlite_stmt_with_rows(
                                                           args...);
     }
   } else {
-    sqli3_stmt = nullptr;
-    int ret = sqlite3_prepare_v2(ctx.get_sqlite_ctx(), stmt.c_str(),
-                                 static_cast<int>(stmt.size()),
-                                 &sqli3_stmt.value(), nullptr);
-    if (ret != SQLITE_OK) {
+    sqli3_stmt = ctx.acquire_stmt(stmt);
+    if (sqli3_stmt.value() == nullptr) {
       return {PMA_SQL::ErrorT::FAILED_TO_PREPARE_EXEC_GENERIC,
-              "sqlite3_prepare_v2 failed", std::nullopt};
+              "acquire_stmt failed", std::nullopt};
     }
     return exec_sqlite_stmt_with_rows<1, Arg, Args...>(ctx, stmt, sqli3_stmt,
                                                        arg, args...);
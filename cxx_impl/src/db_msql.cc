@@ -33,6 +33,7 @@
 #include <thread>
 
 // Local includes.
+#include "challenge_pool.h"
 #include "constants.h"
 #include "db.h"
 #include "db_msql_capi.h"
@@ -443,6 +444,44 @@ PMA_MSQL::Value::U::U(double d) {
   this->d = std::make_shared<double>(d);
 }
 
+PMA_MSQL::ValueView::ValueView()
+    : type(Value::INV_NULL), str(), owned(), sint(0), uint(0), d(0.0) {}
+PMA_MSQL::ValueView::ValueView(std::string_view str)
+    : type(Value::STRING), str(str), owned(), sint(0), uint(0), d(0.0) {}
+PMA_MSQL::ValueView::ValueView(std::string owned)
+    : type(Value::STRING),
+      str(),
+      owned(std::move(owned)),
+      sint(0),
+      uint(0),
+      d(0.0) {}
+PMA_MSQL::ValueView::ValueView(int64_t sint)
+    : type(Value::SIGNED_INT), str(), owned(), sint(sint), uint(0), d(0.0) {}
+PMA_MSQL::ValueView::ValueView(uint64_t uint)
+    : type(Value::UNSIGNED_INT), str(), owned(), sint(0), uint(uint), d(0.0) {}
+PMA_MSQL::ValueView::ValueView(double d)
+    : type(Value::DOUBLE), str(), owned(), sint(0), uint(0), d(d) {}
+
+std::string_view PMA_MSQL::ValueView::get_str() const {
+  return owned.empty() ? str : std::string_view(owned);
+}
+
+PMA_MSQL::Value PMA_MSQL::ValueView::to_value() const {
+  switch (type) {
+    case Value::STRING:
+      return Value(std::string(get_str()));
+    case Value::SIGNED_INT:
+      return Value(sint);
+    case Value::UNSIGNED_INT:
+      return Value(uint);
+    case Value::DOUBLE:
+      return Value(d);
+    case Value::INV_NULL:
+    default:
+      return Value();
+  }
+}
+
 PMA_MSQL::Connection::Connection() : flags(), fd(-1), execute_retry_count(0) {
   flags.set(0);
 }
@@ -614,11 +653,33 @@ bool PMA_MSQL::Connection::ping_check() {
   }
 }
 
-PMA_MSQL::Connection::StmtRet PMA_MSQL::Connection::execute_stmt(
-    const std::string &stmt, std::vector<Value> bind_params) {
+// Re-points STRING row views that borrow "old_base" at the same offsets
+// relative to "new_base"; used when the reusable read buffer backing the
+// views must be grown into new storage.
+static void internal_rebase_row_views(
+    std::vector<std::vector<PMA_MSQL::ValueView> > &rows,
+    const uint8_t *old_base, const uint8_t *new_base) {
+  for (std::vector<PMA_MSQL::ValueView> &row : rows) {
+    for (PMA_MSQL::ValueView &view : row) {
+      if (view.type == PMA_MSQL::Value::STRING && view.owned.empty() &&
+          !view.str.empty()) {
+        const size_t offset = static_cast<size_t>(
+            reinterpret_cast<const uint8_t *>(view.str.data()) - old_base);
+        view.str = std::string_view(
+            reinterpret_cast<const char *>(new_base) + offset,
+            view.str.size());
+      }
+    }
+  }
+}
+
+bool PMA_MSQL::Connection::execute_stmt_views(
+    const std::string &stmt, std::vector<Value> bind_params,
+    std::vector<std::vector<ValueView> > &rows_out) {
+  rows_out.clear();
   if (!is_valid()) {
     execute_retry_count = 0;
-    return std::nullopt;
+    return false;
   }
 
 #ifndef NDEBUG
@@ -655,7 +716,7 @@ PMA_MSQL::Connection::StmtRet PMA_MSQL::Connection::execute_stmt(
         } else {
           std::fprintf(stderr, "ERROR: execute_stmt: Failed to send stmt!\n");
           execute_retry_count = 0;
-          return std::nullopt;
+          return false;
         }
       } else if (static_cast<size_t>(write_ret) < remaining) {
         remaining -= static_cast<size_t>(write_ret);
@@ -689,7 +750,7 @@ PMA_MSQL::Connection::StmtRet PMA_MSQL::Connection::execute_stmt(
         std::fprintf(stderr,
                      "ERROR: execute_stmt: Recv EOF after sending stmt!\n");
         execute_retry_count = 0;
-        return std::nullopt;
+        return false;
       } else {
 #ifndef NDEBUG
         std::fprintf(stderr, "\n");
@@ -711,7 +772,7 @@ PMA_MSQL::Connection::StmtRet PMA_MSQL::Connection::execute_stmt(
     if (idx >= static_cast<size_t>(read_ret) || idx >= 4096) {
       std::fprintf(stderr, "ERROR: execute_stmt: Recv idx out of bounds!\n");
       execute_retry_count = 0;
-      return std::nullopt;
+      return false;
     }
 
     uint8_t seq_id = buf[idx++];
@@ -726,19 +787,19 @@ PMA_MSQL::Connection::StmtRet PMA_MSQL::Connection::execute_stmt(
                    "ERROR: execute_stmt: Err pkt in response to stmt!\n");
       print_error_pkt(buf + idx, pkt_size);
       execute_retry_count = 0;
-      return std::nullopt;
+      return false;
     } else if (buf[idx] != 0) {
       std::fprintf(stderr, "ERROR: execute_stmt: Not OK pkt (%#hhx)!\n",
                    buf[idx]);
       execute_retry_count = 0;
-      return std::nullopt;
+      return false;
     }
 
     auto res_opt = parse_prepare_resp_pkt(buf + idx, pkt_size);
     if (!res_opt.has_value()) {
       PMA_EPrintln("ERROR: Failed to parse prepare response pkt!");
       execute_retry_count = 0;
-      return std::nullopt;
+      return false;
     }
     int ret;
     std::tie(ret, stmt_id) = std::move(res_opt.value());
@@ -746,7 +807,7 @@ PMA_MSQL::Connection::StmtRet PMA_MSQL::Connection::execute_stmt(
       PMA_EPrintln("ERROR: Failed to parse prepare response pkt!");
       close_stmt(stmt_id);
       execute_retry_count = 0;
-      return std::nullopt;
+      return false;
     }
   }
 
@@ -894,7 +955,7 @@ PMA_MSQL::Connection::StmtRet PMA_MSQL::Connection::execute_stmt(
               PMA_EPrintln("ERROR: Failed to bind string parameter!");
               close_stmt(stmt_id);
               execute_retry_count = 0;
-              return std::nullopt;
+              return false;
             }
 
             buf = new uint8_t[str_opt.value()->size()];
@@ -977,7 +1038,7 @@ PMA_MSQL::Connection::StmtRet PMA_MSQL::Connection::execute_stmt(
           std::fprintf(stderr, "Failed to send execute stmt pkt (errno %d)!\n",
                        errno);
           execute_retry_count = 0;
-          return std::nullopt;
+          return false;
         }
       } else if (static_cast<size_t>(write_ret) < remaining) {
         remaining -= static_cast<size_t>(write_ret);
@@ -1001,20 +1062,39 @@ PMA_MSQL::Connection::StmtRet PMA_MSQL::Connection::execute_stmt(
   std::vector<uint8_t> field_types;
   std::vector<uint16_t> field_details;
   size_t row_idx = 0;
-  PMA_HELPER::BinaryPart continue_part;
   bool attempt_fetch_more = false;
-  std::vector<std::vector<Value> > ret_vecs;
+  // Frame response packets in place in the reusable read buffer instead of
+  // allocating and combining parts per read. Parsed row views borrow these
+  // bytes, so consumed bytes are never dropped or shifted mid statement;
+  // "idx" tracks the parse cursor and new reads append past the tail.
+  read_buf.clear();
+  size_t idx = 0;
   while (!reached_ok_eof_pkt) {
-    uint8_t buf[4096];
     size_t size = 0;
+    const size_t prev_size = read_buf.size();
+    if (read_buf.capacity() < prev_size + 4096) {
+      // Growing in place would move the storage and dangle the views of
+      // rows already parsed from it; grow through a new buffer and
+      // re-point the views before swapping it in.
+      size_t new_cap = read_buf.capacity() * 2;
+      if (new_cap < prev_size + 4096) {
+        new_cap = prev_size + 4096;
+      }
+      std::vector<uint8_t> grown;
+      grown.reserve(new_cap);
+      grown.insert(grown.end(), read_buf.begin(), read_buf.end());
+      internal_rebase_row_views(rows_out, read_buf.data(), grown.data());
+      read_buf = std::move(grown);
+    }
+    read_buf.resize(prev_size + 4096);
     while (true) {
-      ssize_t read_ret = read(fd, buf, 4096);
+      ssize_t read_ret = read(fd, read_buf.data() + prev_size, 4096);
       if (read_ret == -1) {
         if (errno == EAGAIN || errno == EWOULDBLOCK) {
           if (attempt_fetch_more) {
             PMA_EPrintln("ERROR: No more bytes, but did not reach EOF!");
             execute_retry_count = 0;
-            return std::nullopt;
+            return false;
           }
           std::this_thread::sleep_for(std::chrono::milliseconds(10));
 #ifndef NDEBUG
@@ -1026,10 +1106,11 @@ PMA_MSQL::Connection::StmtRet PMA_MSQL::Connection::execute_stmt(
                        "ERROR: Failed to recv after exec pkt (errno %d)!\n",
                        errno);
           execute_retry_count = 0;
-          return std::nullopt;
+          return false;
         }
       } else {
         size = static_cast<size_t>(read_ret);
+        read_buf.resize(prev_size + size);
 #ifndef NDEBUG
         std::fprintf(stderr, "\n");
 #endif
@@ -1041,58 +1122,36 @@ PMA_MSQL::Connection::StmtRet PMA_MSQL::Connection::execute_stmt(
       std::fprintf(stderr,
                    "ERROR: Recv 0 bytes after sending exec stmt pkt!\n");
       execute_retry_count = 0;
-      return std::nullopt;
+      return false;
     }
 
 #ifndef NDEBUG
     PMA_EPrintln("NOTICE: response to execute pkt size is: {}", size);
 #endif
 
-    PMA_HELPER::BinaryPart recv_part;
-    {
-      PMA_HELPER::BinaryParts recv_parts;
-      if (continue_part.size != 0) {
-        uint8_t *continue_data = new uint8_t[continue_part.size];
-        std::memcpy(continue_data, continue_part.data, continue_part.size);
-        recv_parts.append(continue_part.size, continue_data);
-        continue_part = PMA_HELPER::BinaryPart();
-      }
-      uint8_t *buf_data = new uint8_t[size];
-      std::memcpy(buf_data, buf, size);
-      recv_parts.append(size, buf_data);
-      recv_part = recv_parts.combine();
-    }
-
     attempt_fetch_more = true;
-    size_t idx = 0;
 
   EXECUTE_STMT_PARSE_EXECUTE_RESP_PKT:
     uint32_t pkt_size;
     uint8_t *pkt_size_bytes = reinterpret_cast<uint8_t *>(&pkt_size);
-    if (recv_part.size - idx < 4) {
-      size_t remaining = recv_part.size - idx;
-      if (remaining != 0) {
-        uint8_t *remaining_data = new uint8_t[remaining];
-        std::memcpy(remaining_data, recv_part.data + idx, remaining);
-        continue_part = PMA_HELPER::BinaryPart(remaining, remaining_data);
-      }
+    if (read_buf.size() - idx < 4) {
 #ifndef NDEBUG
       PMA_EPrintln("NOTICE: Fetching more bytes (not enough for pkt size)...");
 #endif
       continue;
     }
-    pkt_size_bytes[0] = recv_part.data[idx++];
-    pkt_size_bytes[1] = recv_part.data[idx++];
-    pkt_size_bytes[2] = recv_part.data[idx++];
+    pkt_size_bytes[0] = read_buf.data()[idx++];
+    pkt_size_bytes[1] = read_buf.data()[idx++];
+    pkt_size_bytes[2] = read_buf.data()[idx++];
     pkt_size_bytes[3] = 0;
 
-    if (idx >= recv_part.size) {
+    if (idx >= read_buf.size()) {
       std::fprintf(stderr, "ERROR: Recv after exec parsing out of bounds!\n");
       execute_retry_count = 0;
-      return std::nullopt;
+      return false;
     }
 
-    uint8_t seq_id = recv_part.data[idx++];
+    uint8_t seq_id = read_buf.data()[idx++];
     if (seq_id != seq) {
       std::fprintf(stderr,
                    "WARNING: execute_stmt: Recv seq %#hhx, should be %#hhx!\n",
@@ -1100,34 +1159,24 @@ PMA_MSQL::Connection::StmtRet PMA_MSQL::Connection::execute_stmt(
     }
     ++seq;
 
-    if (recv_part.size - idx < static_cast<size_t>(pkt_size)) {
+    if (read_buf.size() - idx < static_cast<size_t>(pkt_size)) {
       idx -= 4;
       --seq;
-
-      size_t remaining = recv_part.size - idx;
-      if (remaining != 0) {
-#ifndef NDEBUG
-        PMA_EPrintln("Remaining bytes {}, fetching more...", remaining);
-#endif
-        uint8_t *remaining_data = new uint8_t[remaining];
-        std::memcpy(remaining_data, recv_part.data + idx, remaining);
-        continue_part = PMA_HELPER::BinaryPart(remaining, remaining_data);
-      }
 #ifndef NDEBUG
       PMA_EPrintln("NOTICE: Fetching more bytes (not enough for pkt)...");
 #endif
       continue;
     }
 
-    if (idx >= recv_part.size) {
+    if (idx >= read_buf.size()) {
       std::fprintf(stderr, "ERROR: Recv after exec parsing out of bounds!\n");
       execute_retry_count = 0;
-      return std::nullopt;
+      return false;
     }
 
-    if (recv_part.data[idx] == 0xFF) {
+    if (read_buf.data()[idx] == 0xFF) {
       const int32_t err_code =
-          err_pkt_error_code(recv_part.data + idx, pkt_size);
+          err_pkt_error_code(read_buf.data() + idx, pkt_size);
       if (err_code == 1213 || err_code == 1205) {
         ++execute_retry_count;
         if (execute_retry_count > CONNECTION_RETRY_COUNT_MAX) {
@@ -1136,28 +1185,28 @@ PMA_MSQL::Connection::StmtRet PMA_MSQL::Connection::execute_stmt(
                        "ERROR: Blocked on LOCK for %" PRIuFAST8
                        " tries, failed to execute stmt!\n",
                        CONNECTION_RETRY_COUNT_MAX);
-          return std::nullopt;
+          return false;
         } else {
           std::this_thread::sleep_for(CONNECTION_RETRY_DELAY);
-          return execute_stmt(stmt, std::move(bind_params));
+          return execute_stmt_views(stmt, std::move(bind_params), rows_out);
         }
       } else {
         std::fprintf(stderr, "ERROR: Recv Err pkt after exec pkt sent!\n");
-        print_error_pkt(recv_part.data + idx, pkt_size);
+        print_error_pkt(read_buf.data() + idx, pkt_size);
         execute_retry_count = 0;
-        return std::nullopt;
+        return false;
       }
-    } else if (recv_part.data[idx] == 0xFE ||
-               (recv_part.data[idx] == 0 &&
+    } else if (read_buf.data()[idx] == 0xFE ||
+               (read_buf.data()[idx] == 0 &&
                 next_pkt_enum == NextPkt::COLUMN_COUNT)) {
       const auto [ret, bytes_read] =
-          handle_ok_pkt(recv_part.data + idx, pkt_size);
+          handle_ok_pkt(read_buf.data() + idx, pkt_size);
       idx += bytes_read;
 
       reached_ok_eof_pkt = true;
       if (ret != 0) {
         execute_retry_count = 0;
-        return std::nullopt;
+        return false;
       }
       continue;
     }
@@ -1165,12 +1214,12 @@ PMA_MSQL::Connection::StmtRet PMA_MSQL::Connection::execute_stmt(
     switch (next_pkt_enum) {
       case NextPkt::COLUMN_COUNT: {
         auto col_count_opt =
-            parse_column_count_pkt(recv_part.data + idx, pkt_size);
+            parse_column_count_pkt(read_buf.data() + idx, pkt_size);
         if (!col_count_opt.has_value()) {
           PMA_EPrintln("ERROR: Failed to parse column-count pkt!");
           close_stmt(stmt_id);
           execute_retry_count = 0;
-          return std::nullopt;
+          return false;
         }
         col_count = col_count_opt.value();
         idx += pkt_size;
@@ -1178,21 +1227,21 @@ PMA_MSQL::Connection::StmtRet PMA_MSQL::Connection::execute_stmt(
         PMA_EPrintln("NOTICE: stmt result col count: {}", col_count);
 #endif
         next_pkt_enum = NextPkt::COLUMN_DEF;
-        if (idx < recv_part.size) {
+        if (idx < read_buf.size()) {
           goto EXECUTE_STMT_PARSE_EXECUTE_RESP_PKT;
         } else {
           continue;
         }
       }
       case NextPkt::COLUMN_DEF: {
-        int ret = parse_col_type_pkt(recv_part.data + idx, pkt_size,
+        int ret = parse_col_type_pkt(read_buf.data() + idx, pkt_size,
                                      field_types, field_details);
         if (ret != 0) {
           PMA_EPrintln("ERROR: Failed to parse column def {}!",
                        field_types.size());
           close_stmt(stmt_id);
           execute_retry_count = 0;
-          return std::nullopt;
+          return false;
         }
         idx += pkt_size;
         if (field_types.size() > col_count) {
@@ -1201,11 +1250,11 @@ PMA_MSQL::Connection::StmtRet PMA_MSQL::Connection::execute_stmt(
               field_types.size(), col_count);
           close_stmt(stmt_id);
           execute_retry_count = 0;
-          return std::nullopt;
+          return false;
         } else if (field_types.size() == col_count) {
           next_pkt_enum = NextPkt::ROW;
         }
-        if (idx < recv_part.size) {
+        if (idx < read_buf.size()) {
           goto EXECUTE_STMT_PARSE_EXECUTE_RESP_PKT;
         } else {
           continue;
@@ -1215,18 +1264,19 @@ PMA_MSQL::Connection::StmtRet PMA_MSQL::Connection::execute_stmt(
 #ifndef NDEBUG
         PMA_EPrintln("NOTICE: Parsing ROW {}", row_idx);
 #endif
-        ret_vecs.emplace_back();
-        int ret = parse_row_pkt(recv_part.data + idx, pkt_size, field_types,
-                                field_details, &ret_vecs.back());
+        rows_out.emplace_back();
+        int ret = parse_row_pkt_view(read_buf.data() + idx, pkt_size,
+                                     field_types, field_details,
+                                     &rows_out.back());
         if (ret != 0) {
           PMA_EPrintln("ERROR: Failed to parse row pkt!");
           close_stmt(stmt_id);
           execute_retry_count = 0;
-          return std::nullopt;
+          return false;
         }
         ++row_idx;
         idx += pkt_size;
-        if (idx < recv_part.size) {
+        if (idx < read_buf.size()) {
           goto EXECUTE_STMT_PARSE_EXECUTE_RESP_PKT;
         } else {
           continue;
@@ -1236,11 +1286,30 @@ PMA_MSQL::Connection::StmtRet PMA_MSQL::Connection::execute_stmt(
         PMA_EPrintln("ERROR: Invalid next_pkt_enum value (internal error!)");
         close_stmt(stmt_id);
         execute_retry_count = 0;
-        return std::nullopt;
+        return false;
     }
   }
   close_stmt(stmt_id);
   execute_retry_count = 0;
+  return true;
+}
+
+PMA_MSQL::Connection::StmtRet PMA_MSQL::Connection::execute_stmt(
+    const std::string &stmt, std::vector<Value> bind_params) {
+  std::vector<std::vector<ValueView> > rows;
+  if (!execute_stmt_views(stmt, std::move(bind_params), rows)) {
+    return std::nullopt;
+  }
+
+  std::vector<std::vector<Value> > ret_vecs;
+  ret_vecs.reserve(rows.size());
+  for (const std::vector<ValueView> &row : rows) {
+    std::vector<Value> &out_row = ret_vecs.emplace_back();
+    out_row.reserve(row.size());
+    for (const ValueView &view : row) {
+      out_row.emplace_back(view.to_value());
+    }
+  }
   return ret_vecs;
 }
 
@@ -2352,10 +2421,10 @@ int PMA_MSQL::parse_col_type_pkt(uint8_t *buf, size_t size,
   return 0;
 }
 
-int PMA_MSQL::parse_row_pkt(uint8_t *buf, size_t size,
-                            const std::vector<uint8_t> &field_types,
-                            const std::vector<uint16_t> &field_details,
-                            std::vector<Value> *out) {
+int PMA_MSQL::parse_row_pkt_view(uint8_t *buf, size_t size,
+                                 const std::vector<uint8_t> &field_types,
+                                 const std::vector<uint16_t> &field_details,
+                                 std::vector<ValueView> *out) {
   size_t idx = 0;
 
   if (buf[idx] != 0) {
@@ -2682,7 +2751,7 @@ int PMA_MSQL::parse_row_pkt(uint8_t *buf, size_t size,
           // DATE
           const uint8_t byte_count = buf[idx++];
           if (byte_count == 0) {
-            out->emplace_back("0000-00-00");
+            out->emplace_back(std::string_view("0000-00-00"));
           } else if (byte_count == 4) {
             if (idx >= size) {
               std::fprintf(stderr, "ERROR: Parse DATE out of bounds!\n");
@@ -2727,7 +2796,7 @@ int PMA_MSQL::parse_row_pkt(uint8_t *buf, size_t size,
           // TIME
           const uint8_t length = buf[idx++];
           if (length == 0) {
-            out->emplace_back("00:00:00");
+            out->emplace_back(std::string_view("00:00:00"));
             break;
           }
 
@@ -2785,7 +2854,7 @@ int PMA_MSQL::parse_row_pkt(uint8_t *buf, size_t size,
           // DATETIME
           const uint8_t byte_count = buf[idx++];
           if (byte_count == 0) {
-            out->emplace_back("0000-00-00T00:00:00");
+            out->emplace_back(std::string_view("0000-00-00T00:00:00"));
           } else if (byte_count >= 4) {
             if (idx >= size) {
               std::fprintf(stderr, "ERROR: Parse DATETIME out of bounds!\n");
@@ -2878,13 +2947,13 @@ int PMA_MSQL::parse_row_pkt(uint8_t *buf, size_t size,
           // BLOB
           const auto [value, b_read] = parse_len_enc_int(buf + idx);
           idx += b_read;
-          std::string str(reinterpret_cast<char *>(buf + idx), value);
+          std::string_view str(reinterpret_cast<char *>(buf + idx), value);
           idx += value;
 #ifndef NDEBUG
           PMA_EPrintln("  Value Blob: {}", str);
 #endif
           if (out) {
-            out->emplace_back(std::move(str));
+            out->emplace_back(str);
           }
           break;
         }
@@ -2895,13 +2964,13 @@ int PMA_MSQL::parse_row_pkt(uint8_t *buf, size_t size,
           // STRING
           const auto [value, b_read] = parse_len_enc_int(buf + idx);
           idx += b_read;
-          std::string str(reinterpret_cast<char *>(buf + idx), value);
+          std::string_view str(reinterpret_cast<char *>(buf + idx), value);
           idx += value;
 #ifndef NDEBUG
           PMA_EPrintln("  Value String: {}", str);
 #endif
           if (out) {
-            out->emplace_back(std::move(str));
+            out->emplace_back(str);
           }
           break;
         }
@@ -2915,6 +2984,24 @@ int PMA_MSQL::parse_row_pkt(uint8_t *buf, size_t size,
   return 0;
 }
 
+int PMA_MSQL::parse_row_pkt(uint8_t *buf, size_t size,
+                            const std::vector<uint8_t> &field_types,
+                            const std::vector<uint16_t> &field_details,
+                            std::vector<Value> *out) {
+  std::vector<ValueView> views;
+  int ret =
+      parse_row_pkt_view(buf, size, field_types, field_details,
+                         out != nullptr ? &views : nullptr);
+  if (ret != 0 || out == nullptr) {
+    return ret;
+  }
+  out->reserve(out->size() + views.size());
+  for (const ValueView &view : views) {
+    out->emplace_back(view.to_value());
+  }
+  return 0;
+}
+
 void PMA_MSQL::init_db(PMA_MSQL::Connection &c) {
   if (!c.is_valid()) {
     return;
@@ -3014,23 +3101,17 @@ std::optional<bool> PMA_MSQL::has_challenge_factor_id(Connection &c,
     return std::nullopt;
   }
 
-  auto vec_opt = c.execute_stmt(DB_SEL_CHAL_FACT_BY_ID, {hash});
-  if (vec_opt.has_value()) {
-    if (vec_opt.value().size() == 1) {
-      return true;
-    } else {
-      return false;
-    }
-  } else {
+  std::vector<std::vector<ValueView> > rows;
+  if (!c.execute_stmt_views(DB_SEL_CHAL_FACT_BY_ID, {hash}, rows)) {
     return std::nullopt;
   }
+  return rows.size() == 1;
 }
 
 std::tuple<PMA_MSQL::Error, std::string, std::string>
 PMA_MSQL::set_challenge_factor(Connection &c, std::string ip, uint16_t port,
                                uint64_t f_quads, uint64_t chall_factors_timeout,
-                               std::vector<uint8_t> (*hasher_fn)(void *data,
-                                                                 size_t size)) {
+                               PMA_HELPER::HasherFn hasher_fn) {
   if (!c.is_valid()) {
     return {Error::INVALID_MSQL_CONNECTION, {}, {}};
   }
@@ -3039,7 +3120,7 @@ PMA_MSQL::set_challenge_factor(Connection &c, std::string ip, uint16_t port,
   std::string challenge_str;
   // get hash
   {
-    Work_Factors factors = work_generate_target_factors2(f_quads);
+    Work_Factors factors = challenge_pool_get(f_quads);
     GenericCleanup<Work_Factors> factors_cleanup(
         factors, [](Work_Factors *ptr) { work_cleanup_factors2(ptr); });
 
@@ -3051,10 +3132,12 @@ PMA_MSQL::set_challenge_factor(Connection &c, std::string ip, uint16_t port,
     std::string answer_str = answer;
     std::free(answer);
 
-    std::vector<uint8_t> hash_data(
-        hasher_fn(answer_str.data(), answer_str.size()));
+    const PMA_HELPER::HashResult hash_data =
+        hasher_fn(answer_str.data(), answer_str.size());
 
-    factors_hash = PMA_HELPER::vec_to_hexadecimal(hash_data);
+    factors_hash =
+        PMA_HELPER::raw_to_hexadecimal<PMA_HELPER::HASH_RESULT_SIZE>(
+            hash_data);
   }
 
   std::string id_hashed;
@@ -3100,22 +3183,20 @@ std::tuple<PMA_MSQL::Error, uint16_t> PMA_MSQL::get_id_to_port_port(
     return {Error::FAILED_TO_LOCK_TABLE, 0};
   }
 
-  auto vec_opt = c.execute_stmt(DB_GET_PORT_ID_TO_PORT, {id});
-  if (!vec_opt.has_value()) {
+  std::vector<std::vector<ValueView> > rows;
+  if (!c.execute_stmt_views(DB_GET_PORT_ID_TO_PORT, {id}, rows)) {
     c.execute_stmt("UNLOCK TABLES", {});
     return {Error::BAD_QUERY_RESULT, 0};
-  } else if (vec_opt->empty()) {
+  } else if (rows.empty()) {
     c.execute_stmt("UNLOCK TABLES", {});
     return {Error::EMPTY_QUERY_RESULT, 0};
-  } else if (vec_opt->at(0).at(0).get_type() != Value::UNSIGNED_INT) {
+  } else if (rows.at(0).at(0).type != Value::UNSIGNED_INT) {
     c.execute_stmt("UNLOCK TABLES", {});
     return {Error::INVALID_QUERY_RET_TYPE, 0};
   }
 
-  uint16_t port =
-      static_cast<uint16_t>(*vec_opt->at(0).at(0).get_unsigned_int().value());
-  vec_opt = c.execute_stmt(DB_DEL_ID_TO_PORT_ENTRY, {id});
-  if (!vec_opt.has_value()) {
+  uint16_t port = static_cast<uint16_t>(rows.at(0).at(0).uint);
+  if (!c.execute_stmt_views(DB_DEL_ID_TO_PORT_ENTRY, {id}, rows)) {
     c.execute_stmt("UNLOCK TABLES", {});
     return {Error::FAILED_DB_EXEC, 0};
   }
@@ -3127,7 +3208,7 @@ std::tuple<PMA_MSQL::Error, uint16_t> PMA_MSQL::get_id_to_port_port(
 std::tuple<PMA_MSQL::Error, uint16_t> PMA_MSQL::validate_client(
     Connection &c, uint64_t chall_factors_timeout, std::string id,
     std::string factors, std::string client_ip,
-    std::vector<uint8_t> (*hasher_fn)(void *data, size_t size)) {
+    PMA_HELPER::HasherFn hasher_fn) {
   if (!c.is_valid()) {
     return {Error::INVALID_MSQL_CONNECTION, 0};
   }
@@ -3135,8 +3216,11 @@ std::tuple<PMA_MSQL::Error, uint16_t> PMA_MSQL::validate_client(
   std::string factors_hash;
   // get hash
   {
-    std::vector<uint8_t> hash_data(hasher_fn(factors.data(), factors.size()));
-    factors_hash = PMA_HELPER::vec_to_hexadecimal(hash_data);
+    const PMA_HELPER::HashResult hash_data =
+        hasher_fn(factors.data(), factors.size());
+    factors_hash =
+        PMA_HELPER::raw_to_hexadecimal<PMA_HELPER::HASH_RESULT_SIZE>(
+            hash_data);
   }
 
   if (!c.execute_stmt("LOCK TABLE CXX_CHALLENGE_FACTORS WRITE", {})
@@ -3151,31 +3235,30 @@ std::tuple<PMA_MSQL::Error, uint16_t> PMA_MSQL::validate_client(
   }
 
   // validate.
-  auto vec_opt = c.execute_stmt(DB_IP_PORT_FROM_CHAL_FACT, {id, factors_hash});
-  if (!vec_opt.has_value()) {
+  std::vector<std::vector<ValueView> > rows;
+  if (!c.execute_stmt_views(DB_IP_PORT_FROM_CHAL_FACT, {id, factors_hash},
+                            rows)) {
     c.execute_stmt("UNLOCK TABLES", {});
     return {Error::BAD_QUERY_RESULT, 0};
-  } else if (vec_opt->empty()) {
+  } else if (rows.empty()) {
     c.execute_stmt("UNLOCK TABLES", {});
     return {Error::EMPTY_QUERY_RESULT, 0};
-  } else if (vec_opt->at(0).at(0).get_type() != Value::STRING) {
+  } else if (rows.at(0).at(0).type != Value::STRING) {
     c.execute_stmt("UNLOCK TABLES", {});
     return {Error::INVALID_QUERY_RET_TYPE, 0};
-  } else if (vec_opt->at(0).at(1).get_type() != Value::UNSIGNED_INT) {
+  } else if (rows.at(0).at(1).type != Value::UNSIGNED_INT) {
     c.execute_stmt("UNLOCK TABLES", {});
     return {Error::INVALID_QUERY_RET_TYPE, 0};
-  } else if (*vec_opt->at(0).at(0).get_str().value() != client_ip) {
+  } else if (rows.at(0).at(0).get_str() != client_ip) {
     c.execute_stmt("UNLOCK TABLES", {});
     return {Error::DB_IP_MISMATCH, 0};
   }
-  uint16_t port =
-      static_cast<uint16_t>(*vec_opt->at(0).at(1).get_unsigned_int().value());
+  uint16_t port = static_cast<uint16_t>(rows.at(0).at(1).uint);
   c.execute_stmt(DB_DEL_FROM_CHAL_FACT, {id});
   c.execute_stmt("UNLOCK TABLES", {});
 
-  vec_opt = c.execute_stmt(DB_ADD_ALLOWED_IPS_ENTRY,
-                           {client_ip, Value::new_uint(port)});
-  if (!vec_opt.has_value()) {
+  if (!c.execute_stmt_views(DB_ADD_ALLOWED_IPS_ENTRY,
+                            {client_ip, Value::new_uint(port)}, rows)) {
     PMA_EPrintln("ERROR: Failed to add entry to Allowed IPs table for ip {}!",
                  client_ip);
     return {Error::FAILED_DB_ADD_ALLOWED, 0};
@@ -3219,7 +3302,7 @@ PMA_MSQL::Error PMA_MSQL::client_is_allowed(Connection &c, std::string ip,
 
 std::tuple<PMA_MSQL::Error, std::string> PMA_MSQL::init_id_to_port(
     Connection &c, uint16_t port, uint64_t id_to_port_timeout,
-    std::vector<uint8_t> (*hasher_fn)(void *data, size_t size)) {
+    PMA_HELPER::HasherFn hasher_fn) {
   if (!c.is_valid()) {
     return {Error::INVALID_MSQL_CONNECTION, {}};
   }
@@ -3380,6 +3463,51 @@ std::optional<PMA_MSQL::Conf> PMA_MSQL::parse_conf_file(
   return std::nullopt;
 }
 
+PMA_MSQL::ConnectionPool::ConnectionPool()
+    : conf{},
+      idle_mutex(std::make_shared<std::mutex>()),
+      idle_conns(std::make_shared<std::deque<Connection> >()) {}
+
+PMA_MSQL::ConnectionPool::ConnectionPool(Conf conf)
+    : conf(std::move(conf)),
+      idle_mutex(std::make_shared<std::mutex>()),
+      idle_conns(std::make_shared<std::deque<Connection> >()) {}
+
+std::optional<PMA_MSQL::Connection> PMA_MSQL::ConnectionPool::checkout() {
+  while (true) {
+    std::optional<Connection> conn_opt;
+    {
+      std::lock_guard<std::mutex> lock(*idle_mutex);
+      if (!idle_conns->empty()) {
+        conn_opt = std::move(idle_conns->back());
+        idle_conns->pop_back();
+      }
+    }
+    if (!conn_opt.has_value()) {
+      break;
+    }
+    // ping_check() outside of the lock since it does a round-trip.
+    if (conn_opt->ping_check()) {
+      return conn_opt;
+    }
+    // Connection went stale while idle; drop it and try the next one.
+  }
+
+  return Connection::connect_msql(conf.addr, conf.port, conf.user, conf.pass,
+                                  conf.db);
+}
+
+void PMA_MSQL::ConnectionPool::checkin(PMA_MSQL::Connection &&conn) {
+  if (!conn.is_valid()) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(*idle_mutex);
+  if (idle_conns->size() < MSQL_POOL_MAX_IDLE_SIZE) {
+    idle_conns->push_back(std::move(conn));
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // db_msql_capi impl
 ////////////////////////////////////////////////////////////////////////////////
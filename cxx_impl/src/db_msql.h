@@ -22,9 +22,12 @@
 #include <bitset>
 #include <chrono>
 #include <cstdint>
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <tuple>
 #include <vector>
 
@@ -128,6 +131,35 @@ class Value {
   TypeE type_enum;
 };
 
+/// A row value decoded in place from a response buffer. STRING values borrow
+/// the bytes they were parsed from via "str", except for values that are
+/// formatted during parsing (DATE/TIME/DATETIME) which own their text in
+/// "owned". Borrowed bytes stay valid only until the next statement is
+/// executed on the Connection whose read buffer backs them.
+struct ValueView {
+  ValueView();
+  /// Borrows the given bytes as a STRING value.
+  ValueView(std::string_view str);
+  /// Takes ownership of already-formatted STRING text.
+  ValueView(std::string owned);
+  ValueView(int64_t sint);
+  ValueView(uint64_t uint);
+  ValueView(double d);
+
+  Value::TypeE type;
+  std::string_view str;
+  std::string owned;
+  int64_t sint;
+  uint64_t uint;
+  double d;
+
+  /// The STRING bytes, whether borrowed or owned.
+  std::string_view get_str() const;
+
+  /// An owning Value equivalent to this view.
+  Value to_value() const;
+};
+
 class Connection {
  public:
   /// For threaded support, there must be support for multiple instances of
@@ -160,12 +192,25 @@ class Connection {
   using StmtRet = std::optional<std::vector<std::vector<Value> > >;
   StmtRet execute_stmt(const std::string &stmt, std::vector<Value> bind_params);
 
+  // Like execute_stmt, but decodes rows into "rows_out" as views borrowing
+  // this Connection's reusable read buffer instead of copying into owned
+  // Values. The views stay valid until the next statement executed on this
+  // Connection. Returns false on failure.
+  bool execute_stmt_views(const std::string &stmt,
+                          std::vector<Value> bind_params,
+                          std::vector<std::vector<ValueView> > &rows_out);
+
  private:
   // 0 - invalid connection if set.
   std::bitset<32> flags;
   int fd;
   uint32_t connection_id;
   uint_fast8_t execute_retry_count;
+  // Reusable buffer statement responses are framed into in place. It holds
+  // a statement's entire response while it is parsed -- row views borrow
+  // its bytes, so nothing is dropped or shifted mid statement -- and is
+  // reused across statements.
+  std::vector<uint8_t> read_buf;
 
   Connection(int fd, uint32_t connection_id);
   void close_stmt(uint32_t stmt_id);
@@ -221,6 +266,13 @@ int parse_row_pkt(uint8_t *buf, size_t size,
                   const std::vector<uint16_t> &field_details,
                   std::vector<Value> *out);
 
+// Returns 0 on success. Like parse_row_pkt, but decodes values as views
+// borrowing "buf" where possible instead of copying into owned Values.
+int parse_row_pkt_view(uint8_t *buf, size_t size,
+                       const std::vector<uint8_t> &field_types,
+                       const std::vector<uint16_t> &field_details,
+                       std::vector<ValueView> *out);
+
 void init_db(Connection &c);
 
 std::optional<uint64_t> get_next_seq_id(Connection &c);
@@ -230,8 +282,7 @@ std::optional<bool> has_challenge_factor_id(Connection &c, std::string hash);
 // First str is challenge, second is hashed-id.
 std::tuple<Error, std::string, std::string> set_challenge_factor(
     Connection &c, std::string ip, uint16_t port, uint64_t f_quads,
-    uint64_t chall_factors_timeout,
-    std::vector<uint8_t> (*hasher_fn)(void *data, size_t size));
+    uint64_t chall_factors_timeout, PMA_HELPER::HasherFn hasher_fn);
 
 /// First value is SUCCESS on not error. Second value is port.
 std::tuple<Error, uint16_t> get_id_to_port_port(Connection &c, std::string id);
@@ -239,14 +290,14 @@ std::tuple<Error, uint16_t> get_id_to_port_port(Connection &c, std::string id);
 std::tuple<Error, uint16_t> validate_client(
     Connection &c, uint64_t chall_factors_timeout, std::string id,
     std::string factors, std::string client_ip,
-    std::vector<uint8_t> (*hasher_fn)(void *data, size_t size));
+    PMA_HELPER::HasherFn hasher_fn);
 
 Error client_is_allowed(Connection &c, std::string ip, uint16_t port,
                         uint64_t allowed_ips_timeout);
 
 std::tuple<Error, std::string> init_id_to_port(
     Connection &c, uint16_t port, uint64_t id_to_port_timeout,
-    std::vector<uint8_t> (*hasher_fn)(void *data, size_t size));
+    PMA_HELPER::HasherFn hasher_fn);
 
 struct Conf {
   std::string addr;
@@ -258,6 +309,36 @@ struct Conf {
 
 std::optional<Conf> parse_conf_file(std::string msql_conf_path);
 
+/// Pool of pre-authenticated Connections shared across threads so that
+/// requests don't pay the TCP connect plus auth handshake each time.
+class ConnectionPool {
+ public:
+  ConnectionPool();
+  ConnectionPool(Conf conf);
+
+  // Allow copy (copies share the same pool).
+  ConnectionPool(const ConnectionPool &) = default;
+  ConnectionPool &operator=(const ConnectionPool &) = default;
+
+  // Allow move
+  ConnectionPool(ConnectionPool &&) = default;
+  ConnectionPool &operator=(ConnectionPool &&) = default;
+
+  // Borrows an idle Connection (dropping any that fail a ping health check),
+  // or connects a new one if none are idle. No value if a connection could
+  // not be established.
+  std::optional<Connection> checkout();
+
+  // Returns a borrowed Connection for reuse. Invalid connections and
+  // connections in excess of MSQL_POOL_MAX_IDLE_SIZE are dropped.
+  void checkin(Connection &&conn);
+
+ private:
+  Conf conf;
+  std::shared_ptr<std::mutex> idle_mutex;
+  std::shared_ptr<std::deque<Connection> > idle_conns;
+};
+
 }  // Namespace PMA_MSQL
 
 #endif
@@ -0,0 +1,90 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "difficulty.h"
+
+// Local includes
+#include "constants.h"
+
+DifficultyController::DifficultyController() : ewma_milliseconds(0) {}
+
+void DifficultyController::record_solve(std::chrono::milliseconds solve_time) {
+  uint64_t sample = solve_time.count() < 0
+                        ? 0
+                        : static_cast<uint64_t>(solve_time.count());
+  if (sample == 0) {
+    // 0 marks "no samples yet"; round a sub-millisecond solve up.
+    sample = 1;
+  }
+
+  const uint64_t prev = ewma_milliseconds.load(std::memory_order_relaxed);
+  if (prev == 0) {
+    ewma_milliseconds.store(sample, std::memory_order_relaxed);
+    return;
+  }
+
+  // new = prev + (sample - prev) / 2^shift, in unsigned-safe form.
+  const uint64_t next = prev + (sample >> DIFFICULTY_EWMA_SHIFT) -
+                        (prev >> DIFFICULTY_EWMA_SHIFT);
+  ewma_milliseconds.store(next == 0 ? 1 : next, std::memory_order_relaxed);
+}
+
+uint64_t DifficultyController::pick_quads(uint64_t base, uint64_t min_quads,
+                                          uint64_t max_quads,
+                                          uint64_t active_connections) const {
+  double quads = static_cast<double>(base);
+
+  // Scale toward the target solve time; no samples means no scaling.
+  const uint64_t ewma = ewma_milliseconds.load(std::memory_order_relaxed);
+  if (ewma != 0) {
+    double scale = static_cast<double>(DIFFICULTY_TARGET_SOLVE_MILLISECONDS) /
+                   static_cast<double>(ewma);
+    if (scale < DIFFICULTY_MIN_SCALE) {
+      scale = DIFFICULTY_MIN_SCALE;
+    } else if (scale > DIFFICULTY_MAX_SCALE) {
+      scale = DIFFICULTY_MAX_SCALE;
+    }
+    quads *= scale;
+  }
+
+  // Connection pressure pushes the result toward the top of the band.
+  double load = static_cast<double>(active_connections) /
+                static_cast<double>(DIFFICULTY_FULL_LOAD_CONNECTIONS);
+  if (load > 1.0) {
+    load = 1.0;
+  }
+  const double max_d = static_cast<double>(max_quads);
+  if (quads < max_d) {
+    quads += (max_d - quads) * load;
+  }
+
+  const double min_d = static_cast<double>(min_quads);
+  if (quads < min_d) {
+    quads = min_d;
+  } else if (quads > max_d) {
+    quads = max_d;
+  }
+  return static_cast<uint64_t>(quads);
+}
+
+uint64_t DifficultyController::solve_ewma_milliseconds() const {
+  return ewma_milliseconds.load(std::memory_order_relaxed);
+}
+
+DifficultyController &difficulty_controller_get() {
+  static DifficultyController internal_global_difficulty_controller{};
+  return internal_global_difficulty_controller;
+}
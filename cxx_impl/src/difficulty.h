@@ -0,0 +1,59 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef SEODISPARATE_COM_POOR_MANS_ANUBIS_DIFFICULTY_H_
+#define SEODISPARATE_COM_POOR_MANS_ANUBIS_DIFFICULTY_H_
+
+// Standard library includes
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/// Picks the quad count for issued challenges when adaptive difficulty is
+/// enabled (--factors-band). An exponentially weighted moving average of
+/// measured solve times (challenge issue to verified answer) scales the
+/// configured base toward the target solve time, and active-connection
+/// pressure pushes the result toward the top of the band. All state is
+/// atomic; recording and picking are safe from any thread.
+class DifficultyController {
+ public:
+  DifficultyController();
+
+  // disallow copy
+  DifficultyController(const DifficultyController &) = delete;
+  DifficultyController &operator=(const DifficultyController &) = delete;
+
+  /// Records one measured solve time. A lost race between concurrent
+  /// recorders drops a sample, which is fine for a moving average.
+  void record_solve(std::chrono::milliseconds solve_time);
+
+  /// Quad count for the next issued challenge, clamped to
+  /// [min_quads, max_quads]. base is the configured --factors value.
+  uint64_t pick_quads(uint64_t base, uint64_t min_quads, uint64_t max_quads,
+                      uint64_t active_connections) const;
+
+  /// EWMA of recorded solve times in milliseconds; 0 until the first sample.
+  uint64_t solve_ewma_milliseconds() const;
+
+ private:
+  std::atomic_uint64_t ewma_milliseconds;
+};
+
+/// Returns the process-wide controller used by the challenge issue and
+/// verify paths.
+DifficultyController &difficulty_controller_get();
+
+#endif
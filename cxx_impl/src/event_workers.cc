@@ -0,0 +1,273 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "event_workers.h"
+
+// Standard library includes
+#include <array>
+#include <cstring>
+#include <list>
+#include <optional>
+#include <utility>
+
+// Unix includes
+#include <errno.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+// Local includes
+#include "constants.h"
+#include "poor_mans_print.h"
+
+void EventWorkers::worker_function(std::shared_ptr<std::atomic_bool> stop_var,
+                                   int epoll_fd,
+                                   std::shared_ptr<std::mutex> conns_mutex,
+                                   std::shared_ptr<ConnMap> conns) {
+  std::array<struct epoll_event, EPOLL_MAX_EVENTS> events;
+
+  while (!stop_var->load(std::memory_order_acquire)) {
+    int event_count = epoll_wait(epoll_fd, events.data(), EPOLL_MAX_EVENTS,
+                                 EPOLL_WAIT_TIMEOUT_MILLISECONDS);
+    if (event_count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      PMA_EPrintln("ERROR: EventWorkers epoll_wait failed (errno {})!", errno);
+      return;
+    }
+
+    for (int idx = 0; idx < event_count; ++idx) {
+      int fd = events.at(static_cast<size_t>(idx)).data.fd;
+
+      // EPOLLONESHOT guarantees only one worker receives this fd, but the
+      // step_fn and user_data are copied out so the map is not referenced
+      // while unlocked.
+      std::optional<StepFn> step_fn;
+      void *user_data = nullptr;
+      {
+        std::unique_lock<std::mutex> lock(*conns_mutex);
+        if (auto iter = conns->find(fd); iter != conns->end()) {
+          step_fn = iter->second.step_fn;
+          user_data = iter->second.user_data;
+          iter->second.busy = true;
+        }
+      }
+      if (!step_fn.has_value()) {
+        continue;
+      }
+
+      StepResult result = StepResult::CLOSE;
+      try {
+        result = step_fn.value()(user_data);
+      } catch (const std::exception &e) {
+        PMA_EPrintln("WARNING: Connection step threw exception: {}", e.what());
+      }
+
+      if (result == StepResult::CLOSE) {
+        std::optional<std::function<void(void *)> > cleanup_fn;
+        {
+          std::unique_lock<std::mutex> lock(*conns_mutex);
+          if (auto iter = conns->find(fd); iter != conns->end()) {
+            cleanup_fn = std::move(iter->second.cleanup_fn);
+            conns->erase(iter);
+          }
+        }
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        if (cleanup_fn.has_value()) {
+          try {
+            cleanup_fn.value()(user_data);
+          } catch (const std::exception &e) {
+            PMA_EPrintln("WARNING: Connection cleanup threw exception: {}",
+                         e.what());
+          }
+        }
+      } else {
+        {
+          std::unique_lock<std::mutex> lock(*conns_mutex);
+          if (auto iter = conns->find(fd); iter != conns->end()) {
+            iter->second.last_active = std::chrono::steady_clock::now();
+            iter->second.busy = false;
+          }
+        }
+        struct epoll_event event;
+        std::memset(&event, 0, sizeof(struct epoll_event));
+        event.events = EPOLLIN | EPOLLONESHOT;
+        if (result == StepResult::KEEP_WRITABLE) {
+          event.events |= EPOLLOUT;
+        }
+        event.data.fd = fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event) != 0) {
+          PMA_EPrintln(
+              "WARNING: EventWorkers failed to re-arm connection fd {} (errno "
+              "{})!",
+              fd, errno);
+        }
+      }
+    }
+
+    // Sweep connections that have idled past the connection timeout.
+    {
+      std::list<std::tuple<int, std::function<void(void *)>, void *> >
+          timed_out;
+      auto time_now = std::chrono::steady_clock::now();
+      {
+        std::unique_lock<std::mutex> lock(*conns_mutex);
+        for (auto iter = conns->begin(); iter != conns->end();) {
+          if (!iter->second.busy &&
+              time_now - iter->second.last_active >
+                  std::chrono::milliseconds(THREAD_TIMEOUT_MILLISECONDS)) {
+            timed_out.emplace_back(iter->first,
+                                   std::move(iter->second.cleanup_fn),
+                                   iter->second.user_data);
+            iter = conns->erase(iter);
+          } else {
+            ++iter;
+          }
+        }
+      }
+      for (auto &entry : timed_out) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, std::get<0>(entry), nullptr);
+        try {
+          std::get<1>(entry)(std::get<2>(entry));
+        } catch (const std::exception &e) {
+          PMA_EPrintln("WARNING: Connection cleanup threw exception: {}",
+                       e.what());
+        }
+      }
+    }
+  }
+}
+
+EventWorkers::EventWorkers(uint32_t worker_count)
+    : stop_var(std::make_shared<std::atomic_bool>(false)),
+      conns_mutex(std::make_shared<std::mutex>()),
+      conns(std::make_shared<ConnMap>()),
+      epoll_fd(epoll_create1(0)) {
+  if (epoll_fd < 0) {
+    PMA_EPrintln("ERROR: EventWorkers failed to create epoll (errno {})!",
+                 errno);
+    return;
+  }
+  if (worker_count == 0) {
+    worker_count = 1;
+  }
+  for (uint32_t idx = 0; idx < worker_count; ++idx) {
+    worker_handles.emplace_back(worker_function, stop_var, epoll_fd,
+                                conns_mutex, conns);
+  }
+}
+
+EventWorkers::~EventWorkers() {
+  if (!stop_var || !conns) {
+    return;
+  }
+  stop_var->store(true, std::memory_order_release);
+
+  for (auto iter = worker_handles.begin(); iter != worker_handles.end();
+       ++iter) {
+    iter->join();
+  }
+
+  for (auto iter = conns->begin(); iter != conns->end(); ++iter) {
+    // Call cleanup_fn on userdata.
+    try {
+      iter->second.cleanup_fn(iter->second.user_data);
+    } catch (const std::exception &e) {
+      PMA_EPrintln("WARNING: cleanup during ~EventWorkers() threw exception: {}",
+                   e.what());
+    }
+  }
+
+  if (epoll_fd >= 0) {
+    close(epoll_fd);
+  }
+}
+
+EventWorkers::EventWorkers(EventWorkers &&other)
+    : worker_handles(std::move(other.worker_handles)),
+      stop_var(std::move(other.stop_var)),
+      conns_mutex(std::move(other.conns_mutex)),
+      conns(std::move(other.conns)),
+      epoll_fd(other.epoll_fd) {
+  other.epoll_fd = -1;
+}
+
+EventWorkers &EventWorkers::operator=(EventWorkers &&other) {
+  if (stop_var && conns) {
+    stop_var->store(true, std::memory_order_release);
+    for (auto iter = worker_handles.begin(); iter != worker_handles.end();
+         ++iter) {
+      iter->join();
+    }
+    for (auto iter = conns->begin(); iter != conns->end(); ++iter) {
+      try {
+        iter->second.cleanup_fn(iter->second.user_data);
+      } catch (const std::exception &e) {
+        PMA_EPrintln(
+            "WARNING: cleanup during EventWorkers::operator= threw exception: "
+            "{}",
+            e.what());
+      }
+    }
+    if (epoll_fd >= 0) {
+      close(epoll_fd);
+    }
+  }
+
+  worker_handles = std::move(other.worker_handles);
+  stop_var = std::move(other.stop_var);
+  conns_mutex = std::move(other.conns_mutex);
+  conns = std::move(other.conns);
+  epoll_fd = other.epoll_fd;
+
+  other.epoll_fd = -1;
+
+  return *this;
+}
+
+bool EventWorkers::add_connection(int fd, StepFn step_fn, void *user_data,
+                                  std::function<void(void *)> cleanup_fn) {
+  if (epoll_fd < 0) {
+    cleanup_fn(user_data);
+    return false;
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(*conns_mutex);
+    conns->insert_or_assign(
+        fd, ConnEntry{std::move(step_fn), cleanup_fn, user_data,
+                      std::chrono::steady_clock::now(), false});
+  }
+
+  struct epoll_event event;
+  std::memset(&event, 0, sizeof(struct epoll_event));
+  event.events = EPOLLIN | EPOLLONESHOT;
+  event.data.fd = fd;
+  if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+    PMA_EPrintln(
+        "WARNING: EventWorkers failed to register connection fd {} (errno "
+        "{})!",
+        fd, errno);
+    {
+      std::unique_lock<std::mutex> lock(*conns_mutex);
+      conns->erase(fd);
+    }
+    cleanup_fn(user_data);
+    return false;
+  }
+
+  return true;
+}
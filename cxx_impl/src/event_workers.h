@@ -0,0 +1,90 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef SEODISPARATE_COM_POOR_MANS_ANUBIS_EVENT_WORKERS_H_
+#define SEODISPARATE_COM_POOR_MANS_ANUBIS_EVENT_WORKERS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Multiplexes many connections over one epoll instance serviced by a small
+// fixed set of worker threads. Each registered connection is a nonblocking
+// state machine: its step_fn is invoked on a worker whenever the fd is ready,
+// and the connection stays registered (costing only memory) until the step_fn
+// requests CLOSE or the connection idles out. This bounds concurrency by
+// memory instead of thread count, unlike ThreadPool/ThreadLimit which park a
+// whole thread on each connection.
+class EventWorkers {
+ public:
+  enum class StepResult {
+    // Keep the connection registered, wake when readable.
+    KEEP,
+    // Keep the connection registered, wake when readable or writable
+    // (a partial write is pending).
+    KEEP_WRITABLE,
+    // Unregister the connection and call its cleanup_fn.
+    CLOSE
+  };
+
+  using StepFn = std::function<StepResult(void *)>;
+
+  EventWorkers(uint32_t worker_count);
+  ~EventWorkers();
+
+  // disallow copy
+  EventWorkers(const EventWorkers &) = delete;
+  EventWorkers &operator=(const EventWorkers &) = delete;
+
+  // allow move
+  EventWorkers(EventWorkers &&);
+  EventWorkers &operator=(EventWorkers &&);
+
+  // "fd" must be nonblocking. Returns false (and calls cleanup_fn
+  // immediately) if the fd could not be registered.
+  bool add_connection(int fd, StepFn step_fn, void *user_data,
+                      std::function<void(void *)> cleanup_fn);
+
+ private:
+  struct ConnEntry {
+    StepFn step_fn;
+    std::function<void(void *)> cleanup_fn;
+    void *user_data;
+    std::chrono::time_point<std::chrono::steady_clock> last_active;
+    // Set while a worker is running step_fn so the idle sweep skips it.
+    bool busy;
+  };
+  using ConnMap = std::unordered_map<int, ConnEntry>;
+
+  static void worker_function(std::shared_ptr<std::atomic_bool> stop_var,
+                              int epoll_fd,
+                              std::shared_ptr<std::mutex> conns_mutex,
+                              std::shared_ptr<ConnMap> conns);
+
+  std::vector<std::thread> worker_handles;
+  std::shared_ptr<std::atomic_bool> stop_var;
+  std::shared_ptr<std::mutex> conns_mutex;
+  std::shared_ptr<ConnMap> conns;
+  int epoll_fd;
+};
+
+#endif
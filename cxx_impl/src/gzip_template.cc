@@ -0,0 +1,459 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "gzip_template.h"
+
+// Standard library includes
+#include <algorithm>
+#include <array>
+
+namespace {
+
+constexpr uint32_t CRC32_POLYNOMIAL = 0xEDB88320;
+
+// RFC 1952 member header: magic, deflate, no flags, no mtime, unix OS.
+constexpr std::array<uint8_t, 10> GZIP_HEADER = {
+    0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03};
+// Empty stored block with BFINAL set, then CRC-32 and ISIZE.
+constexpr size_t GZIP_TRAILER_SIZE = 5 + 4 + 4;
+
+// RFC 1951 length codes 257-285: base lengths and extra bit counts.
+constexpr std::array<uint16_t, 29> LENGTH_BASE = {
+    3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+    31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr std::array<uint8_t, 29> LENGTH_EXTRA = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+    2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+
+// RFC 1951 distance codes 0-29: base distances and extra bit counts.
+constexpr std::array<uint16_t, 30> DIST_BASE = {
+    1,    2,    3,    4,    5,    7,     9,     13,    17,    25,
+    33,   49,   65,   97,   129,  193,   257,   385,   513,   769,
+    1025, 1537, 2049, 3073, 4097, 6145,  8193,  12289, 16385, 24577};
+constexpr std::array<uint8_t, 30> DIST_EXTRA = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4,  4,  5,  5,  6,
+    6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+constexpr size_t DEFLATE_MIN_MATCH = 3;
+constexpr size_t DEFLATE_MAX_MATCH = 258;
+constexpr size_t DEFLATE_MAX_DIST = 32768;
+constexpr size_t DEFLATE_HASH_SIZE = 1 << 15;
+constexpr size_t DEFLATE_MAX_CHAIN = 128;
+
+const std::array<uint32_t, 256> &internal_crc32_table() {
+  static const std::array<uint32_t, 256> table = []() {
+    std::array<uint32_t, 256> t{};
+    for (uint32_t idx = 0; idx < 256; ++idx) {
+      uint32_t crc = idx;
+      for (int bit = 0; bit < 8; ++bit) {
+        crc = (crc & 1) != 0 ? (CRC32_POLYNOMIAL ^ (crc >> 1)) : (crc >> 1);
+      }
+      t[idx] = crc;
+    }
+    return t;
+  }();
+  return table;
+}
+
+uint32_t internal_gf2_matrix_times(const uint32_t *mat, uint32_t vec) {
+  uint32_t sum = 0;
+  while (vec != 0) {
+    if ((vec & 1) != 0) {
+      sum ^= *mat;
+    }
+    vec >>= 1;
+    ++mat;
+  }
+  return sum;
+}
+
+void internal_gf2_matrix_square(uint32_t *square, const uint32_t *mat) {
+  for (size_t idx = 0; idx < 32; ++idx) {
+    square[idx] = internal_gf2_matrix_times(mat, mat[idx]);
+  }
+}
+
+/// crc(A || B) given crc(A), crc(B), and len(B): crc(A) is advanced over
+/// len(B) zero bytes via GF(2) matrix exponentiation and xor'd with crc(B).
+/// Lets the trailer CRC reuse segment CRCs precomputed at construction.
+uint32_t internal_crc32_combine(uint32_t crc1, uint32_t crc2, size_t len2) {
+  if (len2 == 0) {
+    return crc1 ^ crc2;
+  }
+
+  uint32_t even[32];
+  uint32_t odd[32];
+
+  // Operator matrix for one zero bit.
+  odd[0] = CRC32_POLYNOMIAL;
+  uint32_t row = 1;
+  for (size_t idx = 1; idx < 32; ++idx) {
+    odd[idx] = row;
+    row <<= 1;
+  }
+  // One zero byte.
+  internal_gf2_matrix_square(even, odd);
+  internal_gf2_matrix_square(odd, even);
+
+  do {
+    internal_gf2_matrix_square(even, odd);
+    if ((len2 & 1) != 0) {
+      crc1 = internal_gf2_matrix_times(even, crc1);
+    }
+    len2 >>= 1;
+    if (len2 == 0) {
+      break;
+    }
+    internal_gf2_matrix_square(odd, even);
+    if ((len2 & 1) != 0) {
+      crc1 = internal_gf2_matrix_times(odd, crc1);
+    }
+    len2 >>= 1;
+  } while (len2 != 0);
+
+  return crc1 ^ crc2;
+}
+
+/// Emits deflate's LSB-first bitstream into a std::string.
+struct BitWriter {
+  std::string *out;
+  uint64_t bit_buf = 0;
+  unsigned int bit_count = 0;
+
+  void put_bits(uint32_t bits, unsigned int count) {
+    bit_buf |= static_cast<uint64_t>(bits) << bit_count;
+    bit_count += count;
+    while (bit_count >= 8) {
+      out->push_back(static_cast<char>(bit_buf & 0xFF));
+      bit_buf >>= 8;
+      bit_count -= 8;
+    }
+  }
+
+  // Huffman codes are emitted most-significant bit first.
+  void put_huffman(uint32_t code, unsigned int count) {
+    uint32_t reversed = 0;
+    for (unsigned int idx = 0; idx < count; ++idx) {
+      reversed = (reversed << 1) | ((code >> idx) & 1);
+    }
+    put_bits(reversed, count);
+  }
+
+  void align_to_byte() {
+    if (bit_count != 0) {
+      put_bits(0, 8 - bit_count);
+    }
+  }
+};
+
+/// Fixed-Huffman code for literal/length symbols 0-287 (RFC 1951 3.2.6).
+void internal_put_fixed_symbol(BitWriter &writer, unsigned int symbol) {
+  if (symbol < 144) {
+    writer.put_huffman(0x30 + symbol, 8);
+  } else if (symbol < 256) {
+    writer.put_huffman(0x190 + (symbol - 144), 9);
+  } else if (symbol < 280) {
+    writer.put_huffman(symbol - 256, 7);
+  } else {
+    writer.put_huffman(0xC0 + (symbol - 280), 8);
+  }
+}
+
+void internal_put_match(BitWriter &writer, size_t len, size_t dist) {
+  size_t len_code = LENGTH_BASE.size() - 1;
+  while (LENGTH_BASE[len_code] > len) {
+    --len_code;
+  }
+  internal_put_fixed_symbol(writer, static_cast<unsigned int>(257 + len_code));
+  writer.put_bits(static_cast<uint32_t>(len - LENGTH_BASE[len_code]),
+                  LENGTH_EXTRA[len_code]);
+
+  size_t dist_code = DIST_BASE.size() - 1;
+  while (DIST_BASE[dist_code] > dist) {
+    --dist_code;
+  }
+  writer.put_huffman(static_cast<uint32_t>(dist_code), 5);
+  writer.put_bits(static_cast<uint32_t>(dist - DIST_BASE[dist_code]),
+                  DIST_EXTRA[dist_code]);
+}
+
+size_t internal_hash3(const uint8_t *bytes) {
+  return ((static_cast<size_t>(bytes[0]) << 10) ^
+          (static_cast<size_t>(bytes[1]) << 5) ^
+          static_cast<size_t>(bytes[2])) &
+         (DEFLATE_HASH_SIZE - 1);
+}
+
+/// Compresses "plain" as one fixed-Huffman deflate block (greedy LZ77 with
+/// hash chains) followed by an empty stored block, so the output starts and
+/// ends byte-aligned and never references bytes before "plain". Matches
+/// within the piece are still found across the whole segment since
+/// decompressors keep a 32KiB window over the concatenated stream.
+void internal_deflate_segment(std::string_view plain, std::string &out) {
+  BitWriter writer{&out};
+  const uint8_t *data = reinterpret_cast<const uint8_t *>(plain.data());
+  const size_t plain_size = plain.size();
+
+  // Fixed-Huffman block, BFINAL clear.
+  writer.put_bits(0, 1);
+  writer.put_bits(1, 2);
+
+  std::vector<int32_t> head(DEFLATE_HASH_SIZE, -1);
+  std::vector<int32_t> prev(plain_size, -1);
+
+  size_t idx = 0;
+  while (idx < plain_size) {
+    size_t best_len = 0;
+    size_t best_dist = 0;
+    if (idx + DEFLATE_MIN_MATCH <= plain_size) {
+      const size_t max_len = std::min(DEFLATE_MAX_MATCH, plain_size - idx);
+      int32_t cand = head[internal_hash3(data + idx)];
+      size_t chain = 0;
+      while (cand >= 0 && chain < DEFLATE_MAX_CHAIN) {
+        const size_t dist = idx - static_cast<size_t>(cand);
+        if (dist > DEFLATE_MAX_DIST) {
+          break;
+        }
+        size_t len = 0;
+        while (len < max_len &&
+               data[static_cast<size_t>(cand) + len] == data[idx + len]) {
+          ++len;
+        }
+        if (len > best_len) {
+          best_len = len;
+          best_dist = dist;
+          if (len >= max_len) {
+            break;
+          }
+        }
+        cand = prev[static_cast<size_t>(cand)];
+        ++chain;
+      }
+    }
+
+    if (best_len >= DEFLATE_MIN_MATCH) {
+      internal_put_match(writer, best_len, best_dist);
+      const size_t end = idx + best_len;
+      while (idx < end) {
+        if (idx + DEFLATE_MIN_MATCH <= plain_size) {
+          const size_t hash = internal_hash3(data + idx);
+          prev[idx] = head[hash];
+          head[hash] = static_cast<int32_t>(idx);
+        }
+        ++idx;
+      }
+    } else {
+      internal_put_fixed_symbol(writer, data[idx]);
+      if (idx + DEFLATE_MIN_MATCH <= plain_size) {
+        const size_t hash = internal_hash3(data + idx);
+        prev[idx] = head[hash];
+        head[hash] = static_cast<int32_t>(idx);
+      }
+      ++idx;
+    }
+  }
+
+  // End of block, then an empty stored block to realign to a byte boundary.
+  internal_put_fixed_symbol(writer, 256);
+  writer.put_bits(0, 3);
+  writer.align_to_byte();
+  writer.put_bits(0x0000, 16);
+  writer.put_bits(0xFFFF, 16);
+}
+
+size_t internal_stored_blocks_size(size_t value_size) {
+  if (value_size == 0) {
+    return 0;
+  }
+  const size_t block_count = (value_size + 0xFFFE) / 0xFFFF;
+  return value_size + block_count * 5;
+}
+
+/// Appends "value" as stored (uncompressed) deflate blocks; a memcpy per
+/// response instead of compression work.
+void internal_append_stored_blocks(std::string_view value, std::string &out) {
+  size_t pos = 0;
+  while (pos < value.size()) {
+    const size_t chunk = std::min<size_t>(value.size() - pos, 0xFFFF);
+    out.push_back(0);  // BFINAL clear, BTYPE stored, padded to the byte.
+    out.push_back(static_cast<char>(chunk & 0xFF));
+    out.push_back(static_cast<char>((chunk >> 8) & 0xFF));
+    out.push_back(static_cast<char>(~chunk & 0xFF));
+    out.push_back(static_cast<char>((~chunk >> 8) & 0xFF));
+    out.append(value.substr(pos, chunk));
+    pos += chunk;
+  }
+}
+
+void internal_append_u32_le(uint32_t value, std::string &out) {
+  out.push_back(static_cast<char>(value & 0xFF));
+  out.push_back(static_cast<char>((value >> 8) & 0xFF));
+  out.push_back(static_cast<char>((value >> 16) & 0xFF));
+  out.push_back(static_cast<char>((value >> 24) & 0xFF));
+}
+
+}  // namespace
+
+uint32_t PMA_GZIP::crc32(uint32_t crc, const uint8_t *data, size_t size) {
+  const std::array<uint32_t, 256> &table = internal_crc32_table();
+  crc = ~crc;
+  for (size_t idx = 0; idx < size; ++idx) {
+    crc = table[(crc ^ data[idx]) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+GzipResponseTemplate::GzipResponseTemplate()
+    : compressed(), segment_crcs(), segment_sizes(), slot_indices() {
+  compressed.push_back(std::string{});
+  segment_crcs.push_back(0);
+  segment_sizes.push_back(0);
+}
+
+GzipResponseTemplate::GzipResponseTemplate(
+    std::string_view tmpl, const std::vector<std::string> &placeholders)
+    : compressed(), segment_crcs(), segment_sizes(), slot_indices() {
+  const auto add_segment = [this](std::string_view segment) {
+    std::string &out = compressed.emplace_back();
+    if (!segment.empty()) {
+      internal_deflate_segment(segment, out);
+    }
+    segment_crcs.push_back(PMA_GZIP::crc32(
+        0, reinterpret_cast<const uint8_t *>(segment.data()), segment.size()));
+    segment_sizes.push_back(segment.size());
+  };
+
+  size_t pos = 0;
+  while (true) {
+    // Earliest occurrence of any placeholder at or after pos.
+    size_t best_pos = std::string_view::npos;
+    size_t best_idx = 0;
+    for (size_t idx = 0; idx < placeholders.size(); ++idx) {
+      const size_t found = tmpl.find(placeholders.at(idx), pos);
+      if (found < best_pos) {
+        best_pos = found;
+        best_idx = idx;
+      }
+    }
+    if (best_pos == std::string_view::npos) {
+      break;
+    }
+    add_segment(tmpl.substr(pos, best_pos - pos));
+    slot_indices.push_back(best_idx);
+    pos = best_pos + placeholders.at(best_idx).size();
+  }
+  add_segment(tmpl.substr(pos));
+}
+
+size_t GzipResponseTemplate::size(
+    const std::vector<std::string_view> &values) const {
+  size_t total = GZIP_HEADER.size() + GZIP_TRAILER_SIZE;
+  for (const std::string &segment : compressed) {
+    total += segment.size();
+  }
+  for (const size_t idx : slot_indices) {
+    total += internal_stored_blocks_size(values.at(idx).size());
+  }
+  return total;
+}
+
+std::vector<std::tuple<size_t, size_t> >
+GzipResponseTemplate::build_dynamic_pieces(
+    const std::vector<std::string_view> &values, std::string &scratch) const {
+  std::vector<std::tuple<size_t, size_t> > pieces;
+
+  size_t start = scratch.size();
+  scratch.append(reinterpret_cast<const char *>(GZIP_HEADER.data()),
+                 GZIP_HEADER.size());
+  pieces.emplace_back(start, scratch.size() - start);
+
+  uint32_t crc = segment_crcs.at(0);
+  size_t plain_size = segment_sizes.at(0);
+  for (size_t idx = 0; idx < slot_indices.size(); ++idx) {
+    const std::string_view value = values.at(slot_indices.at(idx));
+    start = scratch.size();
+    internal_append_stored_blocks(value, scratch);
+    pieces.emplace_back(start, scratch.size() - start);
+    crc = PMA_GZIP::crc32(crc, reinterpret_cast<const uint8_t *>(value.data()),
+                          value.size());
+    plain_size += value.size();
+    crc = internal_crc32_combine(crc, segment_crcs.at(idx + 1),
+                                 segment_sizes.at(idx + 1));
+    plain_size += segment_sizes.at(idx + 1);
+  }
+
+  start = scratch.size();
+  // Empty stored block with BFINAL set terminates the deflate stream.
+  scratch.push_back(0x01);
+  scratch.push_back(0x00);
+  scratch.push_back(0x00);
+  scratch.push_back(static_cast<char>(0xFF));
+  scratch.push_back(static_cast<char>(0xFF));
+  internal_append_u32_le(crc, scratch);
+  internal_append_u32_le(static_cast<uint32_t>(plain_size), scratch);
+  pieces.emplace_back(start, scratch.size() - start);
+
+  return pieces;
+}
+
+void GzipResponseTemplate::fill_iovecs(
+    const std::vector<std::string_view> &values,
+    std::vector<struct iovec> &iovecs, std::string &scratch) const {
+  // Build all of scratch first; it may reallocate while growing.
+  const std::vector<std::tuple<size_t, size_t> > pieces =
+      build_dynamic_pieces(values, scratch);
+  const auto push = [&iovecs](const char *data, size_t size) {
+    if (size != 0) {
+      // writev(2) takes non-const iov_base; the memory is never written to.
+      iovecs.push_back(iovec{const_cast<char *>(data), size});
+    }
+  };
+  const auto push_piece = [&push,
+                           &scratch](const std::tuple<size_t, size_t> &piece) {
+    push(scratch.data() + std::get<0>(piece), std::get<1>(piece));
+  };
+
+  push_piece(pieces.at(0));
+  for (size_t idx = 0; idx < slot_indices.size(); ++idx) {
+    push(compressed.at(idx).data(), compressed.at(idx).size());
+    push_piece(pieces.at(idx + 1));
+  }
+  push(compressed.back().data(), compressed.back().size());
+  push_piece(pieces.back());
+}
+
+std::string GzipResponseTemplate::to_string(
+    const std::vector<std::string_view> &values) const {
+  std::string scratch;
+  const std::vector<std::tuple<size_t, size_t> > pieces =
+      build_dynamic_pieces(values, scratch);
+
+  std::string out;
+  out.reserve(size(values));
+  const auto append_piece =
+      [&out, &scratch](const std::tuple<size_t, size_t> &piece) {
+        out.append(scratch, std::get<0>(piece), std::get<1>(piece));
+      };
+
+  append_piece(pieces.at(0));
+  for (size_t idx = 0; idx < slot_indices.size(); ++idx) {
+    out.append(compressed.at(idx));
+    append_piece(pieces.at(idx + 1));
+  }
+  out.append(compressed.back());
+  append_piece(pieces.back());
+  return out;
+}
@@ -0,0 +1,92 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef SEODISPARATE_COM_POOR_MANS_ANUBIS_GZIP_TEMPLATE_H_
+#define SEODISPARATE_COM_POOR_MANS_ANUBIS_GZIP_TEMPLATE_H_
+
+// Standard library includes
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+// Unix includes
+#include <sys/uio.h>
+
+namespace PMA_GZIP {
+
+/// CRC-32 (the gzip/zlib polynomial) over the given bytes, continuing from
+/// "crc"; pass 0 to start a new checksum.
+uint32_t crc32(uint32_t crc, const uint8_t *data, size_t size);
+
+}  // namespace PMA_GZIP
+
+/// Gzip variant of ResponseTemplate: the static segments between
+/// "{PLACEHOLDER}" markers are deflate-compressed once at construction, and
+/// per-request values are spliced into the stream as stored (uncompressed)
+/// deflate blocks, so serving a compressed response performs no compression
+/// work. The trailer CRC is built from per-segment CRCs precomputed at
+/// construction combined with CRCs over only the small dynamic values.
+class GzipResponseTemplate {
+ public:
+  GzipResponseTemplate();
+  /// placeholders lists markers (e.g. "{UUID}") in the order their values
+  /// will be supplied to the member fns below.
+  GzipResponseTemplate(std::string_view tmpl,
+                       const std::vector<std::string> &placeholders);
+
+  // allow copy
+  GzipResponseTemplate(const GzipResponseTemplate &) = default;
+  GzipResponseTemplate &operator=(const GzipResponseTemplate &) = default;
+
+  // allow move
+  GzipResponseTemplate(GzipResponseTemplate &&) = default;
+  GzipResponseTemplate &operator=(GzipResponseTemplate &&) = default;
+
+  /// Compressed (on-the-wire) size in bytes (for Content-Length).
+  size_t size(const std::vector<std::string_view> &values) const;
+
+  /// Appends iovecs over the gzip stream. "scratch" backs the per-request
+  /// pieces (gzip header, stored-block framing, and trailer) and must stay
+  /// alive until the writev(2) call completes, like the values themselves.
+  void fill_iovecs(const std::vector<std::string_view> &values,
+                   std::vector<struct iovec> &iovecs,
+                   std::string &scratch) const;
+
+  /// Materializes the gzip stream; used when a partial write forces
+  /// buffering the remainder.
+  std::string to_string(const std::vector<std::string_view> &values) const;
+
+ private:
+  /// Appends the per-request bytes to scratch and returns (offset, size)
+  /// slices of it: the gzip header, then one stored-block run per value
+  /// slot, then the trailer.
+  std::vector<std::tuple<size_t, size_t> > build_dynamic_pieces(
+      const std::vector<std::string_view> &values, std::string &scratch) const;
+
+  // Mirrors ResponseTemplate's layout: compressed.size() ==
+  // slot_indices.size() + 1 and value slot_indices[i] is emitted between
+  // compressed[i] and compressed[i + 1]. Every piece of the deflate stream
+  // starts and ends byte-aligned so the pieces concatenate directly.
+  std::vector<std::string> compressed;
+  std::vector<uint32_t> segment_crcs;
+  std::vector<size_t> segment_sizes;
+  std::vector<size_t> slot_indices;
+};
+
+#endif
@@ -21,6 +21,7 @@
 #include <cstdio>
 #include <cstring>
 #include <fstream>
+#include <memory>
 #include <random>
 
 // Posix includes
@@ -29,6 +30,9 @@
 // Third party includes
 #include <openssl/evp.h>
 
+// Local includes
+#include "base64.h"
+
 std::string PMA_HELPER::vec_to_hexadecimal(const std::vector<uint8_t> &data) {
   std::string hex;
 
@@ -230,17 +234,20 @@ PMA_HELPER::BinaryPart PMA_HELPER::BinaryParts::combine() const {
 std::array<uint8_t, 20> PMA_HELPER::sha1_digest(uint8_t *data, size_t size) {
   std::array<uint8_t, 20> ret;
 
-  EVP_MD_CTX *ctx = EVP_MD_CTX_create();
-  GenericCleanup<EVP_MD_CTX *> ctx_cleanup(ctx, [](EVP_MD_CTX **ctx) {
-    if (ctx && *ctx) {
-      EVP_MD_CTX_destroy(*ctx);
-      *ctx = nullptr;
-    }
-  });
+  // OpenSSL's EVP layer already dispatches to hardware SHA-1 (SHA-NI on
+  // x86_64, the crypto extensions on aarch64) at runtime when available;
+  // reusing one ctx per thread avoids the per-call heap allocation
+  // EVP_MD_CTX_create would otherwise do. DigestInit resets the ctx.
+  thread_local std::unique_ptr<EVP_MD_CTX, void (*)(EVP_MD_CTX *)> ctx(
+      EVP_MD_CTX_create(), [](EVP_MD_CTX *ctx) {
+        if (ctx) {
+          EVP_MD_CTX_destroy(ctx);
+        }
+      });
 
-  EVP_DigestInit_ex(ctx, EVP_sha1(), nullptr);
-  EVP_DigestUpdate(ctx, data, size);
-  EVP_DigestFinal_ex(ctx, ret.data(), nullptr);
+  EVP_DigestInit_ex(ctx.get(), EVP_sha1(), nullptr);
+  EVP_DigestUpdate(ctx.get(), data, size);
+  EVP_DigestFinal_ex(ctx.get(), ret.data(), nullptr);
 
   return ret;
 }
@@ -424,17 +431,136 @@ uint64_t PMA_HELPER::rng_next_id(uint64_t value) {
   return std::uniform_int_distribution<uint64_t>()(default_re);
 }
 
-std::string PMA_HELPER::next_hash(
-    uint64_t value,
-    std::vector<uint8_t> (*hasher_fn)(void *data, size_t size)) {
-  uint64_t next_id = rng_next_id(value);
-  uint64_t random_val = rand_uint64_t();
+void PMA_HELPER::varint_append(uint64_t value, std::vector<uint8_t> &out) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<uint8_t>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+std::tuple<uint64_t, size_t> PMA_HELPER::varint_decode(const uint8_t *data,
+                                                       size_t size) {
+  uint64_t value = 0;
+  size_t idx = 0;
+  unsigned int shift = 0;
+
+  while (idx < size && shift < 64) {
+    const uint8_t byte = data[idx++];
+    value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      return {value, idx};
+    }
+    shift += 7;
+  }
+
+  return {0, 0};
+}
+
+std::string PMA_HELPER::bytes_to_b64(const std::vector<uint8_t> &bytes) {
+  std::string out;
+  out.reserve((bytes.size() * 4 + 2) / 3);
+
+  size_t idx = 0;
+  for (; idx + 3 <= bytes.size(); idx += 3) {
+    out.push_back(static_cast<char>(
+        base64_value_to_base64(static_cast<unsigned char>(bytes[idx] >> 2))));
+    out.push_back(static_cast<char>(base64_value_to_base64(
+        static_cast<unsigned char>(((bytes[idx] & 3) << 4) |
+                                   (bytes[idx + 1] >> 4)))));
+    out.push_back(static_cast<char>(base64_value_to_base64(
+        static_cast<unsigned char>(((bytes[idx + 1] & 0xF) << 2) |
+                                   (bytes[idx + 2] >> 6)))));
+    out.push_back(static_cast<char>(base64_value_to_base64(
+        static_cast<unsigned char>(bytes[idx + 2] & 0x3F))));
+  }
+
+  if (idx + 1 == bytes.size()) {
+    out.push_back(static_cast<char>(
+        base64_value_to_base64(static_cast<unsigned char>(bytes[idx] >> 2))));
+    out.push_back(static_cast<char>(base64_value_to_base64(
+        static_cast<unsigned char>((bytes[idx] & 3) << 4))));
+  } else if (idx + 2 == bytes.size()) {
+    out.push_back(static_cast<char>(
+        base64_value_to_base64(static_cast<unsigned char>(bytes[idx] >> 2))));
+    out.push_back(static_cast<char>(base64_value_to_base64(
+        static_cast<unsigned char>(((bytes[idx] & 3) << 4) |
+                                   (bytes[idx + 1] >> 4)))));
+    out.push_back(static_cast<char>(base64_value_to_base64(
+        static_cast<unsigned char>((bytes[idx + 1] & 0xF) << 2))));
+  }
+
+  return out;
+}
+
+std::optional<std::vector<uint8_t>> PMA_HELPER::b64_to_bytes(
+    std::string_view b64) {
+  if (b64.size() % 4 == 1) {
+    return std::nullopt;
+  }
+
+  std::vector<uint8_t> out;
+  out.reserve(b64.size() * 3 / 4);
+
+  std::array<unsigned char, 4> vals;
+  size_t idx = 0;
+  while (idx < b64.size()) {
+    const size_t group = b64.size() - idx < 4 ? b64.size() - idx : 4;
+    for (size_t gidx = 0; gidx < group; ++gidx) {
+      vals.at(gidx) = base64_base64_to_value(
+          static_cast<unsigned char>(b64[idx + gidx]));
+      if (vals.at(gidx) == 0xFF) {
+        return std::nullopt;
+      }
+    }
+
+    // group is always at least 2 here since length 4n + 1 was rejected.
+    out.push_back(
+        static_cast<uint8_t>((vals.at(0) << 2) | (vals.at(1) >> 4)));
+    if (group >= 3) {
+      out.push_back(
+          static_cast<uint8_t>((vals.at(1) << 4) | (vals.at(2) >> 2)));
+    }
+    if (group == 4) {
+      out.push_back(static_cast<uint8_t>((vals.at(2) << 6) | vals.at(3)));
+    }
+
+    idx += group;
+  }
+
+  return out;
+}
+
+std::optional<std::string> PMA_HELPER::compact_answer_to_factors_str(
+    std::string_view b64) {
+  const auto bytes_opt = b64_to_bytes(b64);
+  if (!bytes_opt.has_value() || bytes_opt.value().empty()) {
+    return std::nullopt;
+  }
 
-  std::array<uint8_t, 16> data;
-  std::memcpy(data.data(), &next_id, 8);
-  std::memcpy(data.data() + 8, &random_val, 8);
+  const std::vector<uint8_t> &bytes = bytes_opt.value();
+  std::string ret;
+  size_t idx = 0;
+  while (idx < bytes.size()) {
+    const auto [factor, factor_consumed] =
+        varint_decode(bytes.data() + idx, bytes.size() - idx);
+    if (factor_consumed == 0) {
+      return std::nullopt;
+    }
+    idx += factor_consumed;
 
-  std::vector<uint8_t> hash(hasher_fn(data.data(), data.size()));
+    const auto [count, count_consumed] =
+        varint_decode(bytes.data() + idx, bytes.size() - idx);
+    if (count_consumed == 0) {
+      return std::nullopt;
+    }
+    idx += count_consumed;
 
-  return PMA_HELPER::vec_to_hexadecimal(hash);
+    if (!ret.empty()) {
+      ret.push_back(' ');
+    }
+    ret.append(std::format("{}x{}", factor, count));
+  }
+
+  return ret;
 }
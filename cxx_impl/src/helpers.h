@@ -21,12 +21,16 @@
 #include <array>
 #include <bitset>
 #include <cstdint>
+#include <cstring>
 #include <format>
 #include <functional>
 #include <list>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <tuple>
 #include <unordered_map>
+#include <vector>
 
 template <typename T>
 class GenericCleanup {
@@ -132,7 +136,7 @@ std::string trim_whitespace(const std::string &s);
 // Returns empty if no extension exists.
 std::string get_file_ext(const std::string &s);
 
-// Currently unused. Re-enable tests in src/test.cc if to be used.
+// Used by the asset cache to type responses by file extension.
 class MimeTypes {
  public:
   MimeTypes();
@@ -152,9 +156,43 @@ uint64_t rand_uint64_t();
 
 uint64_t rng_next_id(uint64_t value);
 
-std::string next_hash(uint64_t value,
-                      std::vector<uint8_t> (*hasher_fn)(void *data,
-                                                        size_t size));
+// Digest size of the one-shot hashers used with next_hash (matches
+// BLAKE3_OUT_LEN).
+constexpr unsigned long long HASH_RESULT_SIZE = 32;
+
+using HashResult = std::array<uint8_t, HASH_RESULT_SIZE>;
+
+// One-shot hasher returning its digest in a fixed-size array; no
+// per-call allocation.
+using HasherFn = HashResult (*)(void *data, size_t size);
+
+// "Hasher" is anything callable as HasherFn (fn pointer, lambda, etc.);
+// passing the hasher directly lets the call inline instead of going
+// through a pointer.
+template <typename Hasher>
+std::string next_hash(uint64_t value, Hasher &&hasher_fn);
+
+// Compact binary answer codec: little-endian base-128 varints wrapped in
+// the challenge base64 alphabet (3 bytes per 4 chars, no padding).
+
+// Appends value to out as a little-endian base-128 varint.
+void varint_append(uint64_t value, std::vector<uint8_t> &out);
+
+// Decodes one varint from the front of [data, data + size). Returns the
+// value and the number of bytes consumed; consumed is 0 if the input is
+// truncated or wider than a uint64_t.
+std::tuple<uint64_t, size_t> varint_decode(const uint8_t *data, size_t size);
+
+std::string bytes_to_b64(const std::vector<uint8_t> &bytes);
+
+// Returns std::nullopt if b64 contains a char outside the alphabet or has
+// an impossible length (4n + 1).
+std::optional<std::vector<uint8_t>> b64_to_bytes(std::string_view b64);
+
+// Decodes a compact binary answer (varint factor/exponent pairs) into the
+// canonical "NxM NxM ..." factors string. Returns std::nullopt on
+// malformed input.
+std::optional<std::string> compact_answer_to_factors_str(std::string_view b64);
 }  // namespace PMA_HELPER
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -223,6 +261,20 @@ std::string PMA_HELPER::raw_to_hexadecimal(
   return hexadecimal;
 }
 
+template <typename Hasher>
+std::string PMA_HELPER::next_hash(uint64_t value, Hasher &&hasher_fn) {
+  uint64_t next_id = rng_next_id(value);
+  uint64_t random_val = rand_uint64_t();
+
+  std::array<uint8_t, 16> data;
+  std::memcpy(data.data(), &next_id, 8);
+  std::memcpy(data.data() + 8, &random_val, 8);
+
+  const HashResult hash = hasher_fn(data.data(), data.size());
+
+  return raw_to_hexadecimal<HASH_RESULT_SIZE>(hash);
+}
+
 template <typename T, unsigned long long SIZE>
 std::string PMA_HELPER::array_to_str(const std::array<T, SIZE> &arr) {
   std::string ret("[");
@@ -853,13 +853,24 @@ std::string PMA_HTTP::ipv4_addr_to_str(uint32_t ipv4) noexcept {
 }
 
 std::tuple<PMA_HTTP::ErrorT, std::string, int> PMA_HTTP::get_ipv6_socket_server(
-    std::string addr, uint16_t port) {
+    std::string addr, uint16_t port, bool reuse_port) {
   int socket_fd = socket(AF_INET6, SOCK_STREAM | SOCK_NONBLOCK, 6);
   if (socket_fd == -1) {
     return {ErrorT::FAILED_TO_GET_IPV6_SOCKET,
             std::format("Failed to create socket, errno {}", errno), -1};
   }
 
+  if (reuse_port) {
+    int enabled = 1;
+    int ret = setsockopt(socket_fd, SOL_SOCKET, SO_REUSEPORT, &enabled,
+                         sizeof(enabled));
+    if (ret != 0) {
+      close(socket_fd);
+      return {ErrorT::FAILED_TO_GET_IPV6_SOCKET,
+              std::format("Failed to set SO_REUSEPORT, errno {}", errno), -1};
+    }
+  }
+
   // bind to "addr", with port
   {
     std::array<uint8_t, 16> ipv6_addr;
@@ -910,13 +921,24 @@ std::tuple<PMA_HTTP::ErrorT, std::string, int> PMA_HTTP::get_ipv6_socket_server(
 }
 
 std::tuple<PMA_HTTP::ErrorT, std::string, int> PMA_HTTP::get_ipv4_socket_server(
-    std::string addr, uint16_t port) {
+    std::string addr, uint16_t port, bool reuse_port) {
   int socket_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 6);
   if (socket_fd == -1) {
     return {ErrorT::FAILED_TO_GET_IPV4_SOCKET,
             std::format("Failed to create socket, errno {}", errno), -1};
   }
 
+  if (reuse_port) {
+    int enabled = 1;
+    int ret = setsockopt(socket_fd, SOL_SOCKET, SO_REUSEPORT, &enabled,
+                         sizeof(enabled));
+    if (ret != 0) {
+      close(socket_fd);
+      return {ErrorT::FAILED_TO_GET_IPV4_SOCKET,
+              std::format("Failed to set SO_REUSEPORT, errno {}", errno), -1};
+    }
+  }
+
   // bind to "addr", with port
   {
     struct sockaddr_in sain;
@@ -1136,97 +1158,70 @@ PMA_HTTP::Request PMA_HTTP::Request::from_error(ErrorT err, std::string msg) {
 }
 
 PMA_HTTP::Request PMA_HTTP::handle_request_parse(std::string req) {
-  std::string method;
-  for (size_t idx = 0; idx < req.size() && req[idx] != ' ' &&
-                       req[idx] != '\n' && req[idx] != '\t' && req[idx] != '\r';
-       ++idx) {
-    method.push_back(req[idx]);
-  }
+  return handle_request_parse_view(req).to_request();
+}
 
-  bool start = true;
-  bool getting_url = false;
-  bool fetching_key = false;
-  std::string url, full_url, key, val;
-  std::unordered_map<std::string, std::string> query_params;
-  for (size_t idx = 4; idx < req.size(); ++idx) {
-    if (req.at(idx) == '\n' || req.at(idx) == '\r') {
-      break;
-    } else if (req.at(idx) == ' ' && start) {
-      continue;
-    } else if (start && req.at(idx) == '/') {
-      start = false;
-      getting_url = true;
-      url.push_back('/');
-      full_url.push_back('/');
-    } else if (getting_url) {
-      if (req.at(idx) != ' ' && req.at(idx) != '\n' && req.at(idx) != '\r') {
-        full_url.push_back(req.at(idx));
-      }
+PMA_HTTP::RequestView PMA_HTTP::RequestView::from_error(ErrorT err,
+                                                        std::string_view msg) {
+  return {{}, {}, msg, {}, {}, {}, err};
+}
 
-      if (req.at(idx) != '?' && req.at(idx) != ' ') {
-        url.push_back(req.at(idx));
-      } else if (req.at(idx) == ' ') {
-        break;
-      } else {
-        getting_url = false;
-        fetching_key = true;
-      }
-    } else if (fetching_key) {
-      if (req.at(idx) != ' ' && req.at(idx) != '\n' && req.at(idx) != '\r') {
-        full_url.push_back(req.at(idx));
-      }
+static bool internal_view_iequals_lower(std::string_view key,
+                                        std::string_view lower_key) {
+  if (key.size() != lower_key.size()) {
+    return false;
+  }
+  for (size_t idx = 0; idx < key.size(); ++idx) {
+    char key_char = key[idx];
+    if (key_char >= 'A' && key_char <= 'Z') {
+      key_char = static_cast<char>(key_char + ('a' - 'A'));
+    }
+    if (key_char != lower_key[idx]) {
+      return false;
+    }
+  }
+  return true;
+}
 
-      if (req.at(idx) != '=' && req.at(idx) != ' ') {
-        key.push_back(req.at(idx));
-      } else if (req.at(idx) == ' ') {
-        break;
-      } else {
-        fetching_key = false;
-      }
-    } else {
-      if (req.at(idx) != ' ' && req.at(idx) != '\n' && req.at(idx) != '\r') {
-        full_url.push_back(req.at(idx));
-      }
+static std::string_view internal_trim_view(std::string_view s) {
+  while (!s.empty() && (s.front() == ' ' || s.front() == '\t' ||
+                        s.front() == '\r' || s.front() == '\n')) {
+    s.remove_prefix(1);
+  }
+  while (!s.empty() && (s.back() == ' ' || s.back() == '\t' ||
+                        s.back() == '\r' || s.back() == '\n')) {
+    s.remove_suffix(1);
+  }
+  return s;
+}
 
-      if (req.at(idx) != '&' && req.at(idx) != ';' && req.at(idx) != ' ') {
-        val.push_back(req.at(idx));
-      } else if (req.at(idx) == ' ') {
-        if (!key.empty() && !val.empty()) {
-          query_params.emplace(key, val);
-          key.clear();
-          val.clear();
-        }
-        break;
-      } else {
-        if (!key.empty() && !val.empty()) {
-          query_params.emplace(key, val);
-          key.clear();
-          val.clear();
-          fetching_key = true;
-        }
-      }
+std::optional<std::string_view> PMA_HTTP::RequestView::find_header(
+    std::string_view lower_key) const {
+  for (const auto &pair : headers) {
+    if (internal_view_iequals_lower(pair.first, lower_key)) {
+      return pair.second;
     }
   }
-  if (!start && getting_url) {
-    // Intentionally left blank, no return here, continue.
-  } else if (!start && !getting_url && !fetching_key) {
-    if (!key.empty() && !val.empty()) {
-      query_params.emplace(key, val);
-    }
-    // No return here, continue.
-  } else if (!start && !getting_url && fetching_key) {
-    PMA_Println("WARNING: Partial url query param key: {}", key);
-    query_params.emplace(key, std::string{});
-    // No return here, continue.
-  } else {
-    return Request::from_error(ErrorT::INVALID_STATE,
-                               "Invalid state parsing req");
+  return std::nullopt;
+}
+
+PMA_HTTP::Request PMA_HTTP::RequestView::to_request() const {
+  if (error_enum != ErrorT::SUCCESS) {
+    return Request::from_error(error_enum, std::string(url_or_err_msg));
   }
 
+  Request req{};
+  req.error_enum = ErrorT::SUCCESS;
+  req.method = std::string(method);
+  req.full_url = std::string(full_url);
+  req.url_or_err_msg = std::string(url_or_err_msg);
+  req.body = std::string(body);
+
   // Check url
-  if (!url.ends_with('/')) {
+  if (!req.url_or_err_msg.ends_with('/')) {
     bool needs_slash = true;
-    for (auto url_iter = url.rbegin(); url_iter != url.rend(); ++url_iter) {
+    for (auto url_iter = req.url_or_err_msg.rbegin();
+         url_iter != req.url_or_err_msg.rend(); ++url_iter) {
       if (*url_iter == '.' || *url_iter == '?') {
         needs_slash = false;
         break;
@@ -1235,129 +1230,182 @@ PMA_HTTP::Request PMA_HTTP::handle_request_parse(std::string req) {
       }
     }
     if (needs_slash) {
-      url.push_back('/');
+      req.url_or_err_msg.push_back('/');
     }
   }
 
-  std::unordered_multimap<std::string, std::string> headers;
+  for (const auto &pair : queries) {
+    req.queries.emplace(std::string(pair.first), std::string(pair.second));
+  }
+  for (const auto &pair : headers) {
+    req.headers.emplace(PMA_HELPER::ascii_str_to_lower(std::string(pair.first)),
+                        std::string(pair.second));
+  }
 
-  decltype(req)::size_type idx = req.find("\r\n");
-  if (idx == std::string::npos) {
-    return Request::from_error(ErrorT::INVALID_STATE, "No CRNL in request");
-  } else {
-    idx += 2;
+  return req;
+}
+
+PMA_HTTP::RequestView PMA_HTTP::handle_request_parse_view(
+    std::string_view req) {
+  RequestView view{};
+  view.error_enum = ErrorT::SUCCESS;
+
+  const size_t line_end = req.find("\r\n");
+  if (line_end == std::string_view::npos) {
+    return RequestView::from_error(ErrorT::INVALID_STATE, "No CRNL in request");
   }
-  const decltype(req)::size_type end_idx = req.find("\r\n\r\n");
-  if (idx == std::string::npos) {
-    return Request::from_error(ErrorT::INVALID_STATE,
-                               "No double CRNL in request");
+  const std::string_view req_line = req.substr(0, line_end);
+
+  const size_t method_end = req_line.find_first_of(" \t");
+  if (method_end == std::string_view::npos) {
+    return RequestView::from_error(ErrorT::INVALID_STATE,
+                                   "Invalid state parsing req");
   }
+  view.method = req_line.substr(0, method_end);
 
-  key.clear();
-  val.clear();
-  fetching_key = true;
-  for (; idx < req.size() && idx < end_idx; ++idx) {
-    if (fetching_key) {
-      if (req.at(idx) == ':') {
-        fetching_key = false;
-      } else if (req.at(idx) == '\r' || req.at(idx) == '\n') {
-        return Request::from_error(ErrorT::INVALID_STATE,
-                                   "Reach CRNL while parsing header key");
-      } else if (req.at(idx) == ' ') {
-        // Intentionally left blank
-      } else {
-        key.push_back(req.at(idx));
-      }
-    } else {
-      if (req.at(idx) == '\r' || req.at(idx) == '\n') {
-        if (val.empty()) {
-          return Request::from_error(ErrorT::INVALID_STATE,
-                                     "No value for key in header");
-        } else {
-          headers.emplace(PMA_HELPER::ascii_str_to_lower(key),
-                          PMA_HELPER::trim_whitespace(val));
-          key.clear();
-          val.clear();
-          fetching_key = true;
-          if (idx + 1 < end_idx && idx + 1 < req.size() &&
-              req.at(idx) == '\r' && req.at(idx + 1) == '\n') {
-            ++idx;
-          }
+  const size_t url_start = req_line.find('/', method_end);
+  if (url_start == std::string_view::npos) {
+    return RequestView::from_error(ErrorT::INVALID_STATE,
+                                   "Invalid state parsing req");
+  }
+  size_t url_end = req_line.find(' ', url_start);
+  if (url_end == std::string_view::npos) {
+    url_end = req_line.size();
+  }
+  view.full_url = req_line.substr(url_start, url_end - url_start);
+
+  const size_t query_start = view.full_url.find('?');
+  if (query_start == std::string_view::npos) {
+    view.url_or_err_msg = view.full_url;
+  } else {
+    view.url_or_err_msg = view.full_url.substr(0, query_start);
+    std::string_view query_str = view.full_url.substr(query_start + 1);
+    while (!query_str.empty()) {
+      const size_t seg_end = query_str.find_first_of("&;");
+      const std::string_view segment = query_str.substr(0, seg_end);
+      if (const size_t eq_idx = segment.find('=');
+          eq_idx == std::string_view::npos) {
+        if (!segment.empty()) {
+          PMA_Println("WARNING: Partial url query param key: {}", segment);
+          view.queries.emplace_back(segment, std::string_view{});
         }
-      } else {
-        val.push_back(req.at(idx));
+      } else if (eq_idx != 0 && eq_idx + 1 < segment.size()) {
+        view.queries.emplace_back(segment.substr(0, eq_idx),
+                                  segment.substr(eq_idx + 1));
       }
+      if (seg_end == std::string_view::npos) {
+        break;
+      }
+      query_str.remove_prefix(seg_end + 1);
     }
   }
-  if (!fetching_key && !key.empty() && !val.empty()) {
-    headers.emplace(PMA_HELPER::ascii_str_to_lower(key),
-                    PMA_HELPER::trim_whitespace(val));
+
+  const size_t end_idx = req.find("\r\n\r\n");
+  std::string_view headers_region =
+      end_idx == std::string_view::npos
+          ? req.substr(line_end + 2)
+          : req.substr(line_end + 2, end_idx - (line_end + 2));
+  while (!headers_region.empty()) {
+    const size_t header_line_end = headers_region.find("\r\n");
+    const std::string_view header_line =
+        headers_region.substr(0, header_line_end);
+    if (!header_line.empty()) {
+      const size_t colon_idx = header_line.find(':');
+      if (colon_idx == std::string_view::npos) {
+        return RequestView::from_error(ErrorT::INVALID_STATE,
+                                       "Reach CRNL while parsing header key");
+      }
+      const std::string_view value =
+          internal_trim_view(header_line.substr(colon_idx + 1));
+      if (value.empty()) {
+        return RequestView::from_error(ErrorT::INVALID_STATE,
+                                       "No value for key in header");
+      }
+      view.headers.emplace_back(
+          internal_trim_view(header_line.substr(0, colon_idx)), value);
+    }
+    if (header_line_end == std::string_view::npos) {
+      break;
+    }
+    headers_region.remove_prefix(header_line_end + 2);
   }
 
-  std::string body;
-  try {
-    body = req.substr(end_idx + 4);
-  } catch (const std::out_of_range &e) {
-    // Intentionally left blank.
+  if (end_idx != std::string_view::npos && end_idx + 4 <= req.size()) {
+    view.body = req.substr(end_idx + 4);
   }
 
-  return {query_params, headers, url, full_url, body, method, ErrorT::SUCCESS};
+  return view;
 }
 
 std::tuple<PMA_HTTP::ErrorT, std::unordered_map<std::string, std::string> >
 PMA_HTTP::parse_simple_json(std::string json) {
+  std::unordered_map<std::string, std::string> unordmap;
+  const ErrorT err = parse_simple_json_streaming(
+      json, json.size(),
+      [&unordmap](std::string_view key, std::string_view value) {
+        unordmap.emplace(std::string(key), std::string(value));
+      });
+  if (err != ErrorT::SUCCESS) {
+    return {err, {}};
+  }
+
+  return {ErrorT::SUCCESS, unordmap};
+}
+
+PMA_HTTP::ErrorT PMA_HTTP::parse_simple_json_streaming(
+    std::string_view json, size_t max_size,
+    const std::function<void(std::string_view key, std::string_view value)>
+        &callback) {
   bool pre_get_key = true;
   bool get_key = false;
   bool get_middle = false;
   bool pre_get_value = false;
   bool get_value = false;
-  std::string key, val;
-  std::unordered_map<std::string, std::string> unordmap;
+  size_t slice_start = 0;
+  std::string_view key;
   for (size_t idx = 0; idx < json.size(); ++idx) {
+    if (idx >= max_size) {
+      return ErrorT::FAILED_TO_PARSE_JSON;
+    }
     if (pre_get_key) {
-      if (json.at(idx) == '"') {
+      if (json[idx] == '"') {
         pre_get_key = false;
         get_key = true;
+        slice_start = idx + 1;
       }
     } else if (get_key) {
-      if (json.at(idx) == '"') {
-        if (key.empty()) {
-          return {ErrorT::INVALID_STATE, {}};
-        } else {
-          get_key = false;
-          get_middle = true;
+      if (json[idx] == '"') {
+        if (idx == slice_start) {
+          return ErrorT::INVALID_STATE;
         }
-      } else {
-        key.push_back(json.at(idx));
+        key = json.substr(slice_start, idx - slice_start);
+        get_key = false;
+        get_middle = true;
       }
     } else if (get_middle) {
-      if (json.at(idx) == ':') {
+      if (json[idx] == ':') {
         get_middle = false;
         pre_get_value = true;
       }
     } else if (pre_get_value) {
-      if (json.at(idx) == '"') {
+      if (json[idx] == '"') {
         pre_get_value = false;
         get_value = true;
+        slice_start = idx + 1;
       }
     } else if (get_value) {
-      if (json.at(idx) == '"') {
-        if (val.empty()) {
-          return {ErrorT::INVALID_STATE, {}};
-        } else {
-          unordmap.emplace(key, val);
-          key.clear();
-          val.clear();
-          get_value = false;
-          pre_get_key = true;
+      if (json[idx] == '"') {
+        if (idx == slice_start) {
+          return ErrorT::INVALID_STATE;
         }
-      } else {
-        val.push_back(json.at(idx));
+        callback(key, json.substr(slice_start, idx - slice_start));
+        get_value = false;
+        pre_get_key = true;
       }
     } else {
-      return {ErrorT::INVALID_STATE, {}};
+      return ErrorT::INVALID_STATE;
     }
   }
 
-  return {ErrorT::SUCCESS, unordmap};
+  return ErrorT::SUCCESS;
 }
@@ -18,10 +18,16 @@
 #define SEODISPARATE_COM_POOR_MANS_ANUBIS_HTTP_H_
 
 // Standard library includes
+#include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <tuple>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace PMA_HTTP {
 
@@ -51,10 +57,12 @@ uint32_t str_to_ipv4_addr(const std::string &addr) noexcept(false);
 /// The given parameter should be in big-endian.
 std::string ipv4_addr_to_str(uint32_t ipv4) noexcept;
 
-std::tuple<ErrorT, std::string, int> get_ipv6_socket_server(std::string addr,
-                                                            uint16_t port);
-std::tuple<ErrorT, std::string, int> get_ipv4_socket_server(std::string addr,
-                                                            uint16_t port);
+/// When reuse_port is set, SO_REUSEPORT is enabled before bind so multiple
+/// listeners can share the addr/port and the kernel load-balances accepts.
+std::tuple<ErrorT, std::string, int> get_ipv6_socket_server(
+    std::string addr, uint16_t port, bool reuse_port = false);
+std::tuple<ErrorT, std::string, int> get_ipv4_socket_server(
+    std::string addr, uint16_t port, bool reuse_port = false);
 
 std::tuple<ErrorT, std::string, int> connect_ipv6_socket_client(
     std::string server_addr, std::string client_addr, uint16_t port);
@@ -73,15 +81,54 @@ struct Request {
   static Request from_error(ErrorT, std::string);
 };
 
+/// Non-owning variant of Request: every field is a string_view slice over
+/// the caller's receive buffer and headers/queries are flat vectors, so
+/// parsing performs no per-header/per-query heap allocations. The buffer
+/// must outlive the view. Header keys are stored as received; use
+/// find_header() for case-insensitive lookup. The url slice is exactly as
+/// received; to_request() applies the same trailing-slash normalization
+/// and header-key lowercasing as handle_request_parse().
+struct RequestView {
+  std::vector<std::pair<std::string_view, std::string_view> > queries;
+  std::vector<std::pair<std::string_view, std::string_view> > headers;
+  std::string_view url_or_err_msg;
+  std::string_view full_url;
+  std::string_view body;
+  std::string_view method;
+  ErrorT error_enum;
+
+  static RequestView from_error(ErrorT, std::string_view);
+
+  /// Case-insensitive header lookup of the first matching header.
+  /// "lower_key" must already be lowercase.
+  std::optional<std::string_view> find_header(std::string_view lower_key) const;
+
+  /// Copies the view into an owned Request.
+  Request to_request() const;
+};
+
 /// Parses request to get url, query params, and headers.
 /// On error, string is err message. On SUCCESS, string is request url
 /// First map is key/value pairs of query parameters
 /// Second map is key/value headers
 Request handle_request_parse(std::string req);
 
+/// Zero-copy variant of handle_request_parse: the returned view holds
+/// slices over "req" and performs no copies of keys/values.
+RequestView handle_request_parse_view(std::string_view req);
+
 std::tuple<ErrorT, std::unordered_map<std::string, std::string> >
     parse_simple_json(std::string);
 
+/// Streaming variant of parse_simple_json: invokes the callback once per
+/// key/value pair with string_view slices over "json" (no copies), and
+/// aborts with FAILED_TO_PARSE_JSON once more than max_size bytes have been
+/// consumed. Escape sequences are not handled, same as parse_simple_json.
+ErrorT parse_simple_json_streaming(
+    std::string_view json, size_t max_size,
+    const std::function<void(std::string_view key, std::string_view value)>
+        &callback);
+
 }  // namespace PMA_HTTP
 
 #endif
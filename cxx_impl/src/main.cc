@@ -19,17 +19,22 @@
 #include <chrono>
 #include <cstring>
 #include <iostream>
+#include <mutex>
 #include <optional>
+#include <string_view>
 #include <thread>
 #include <tuple>
 #include <unordered_map>
+#include <vector>
 
 // Unix includes
 #include <errno.h>
 #include <fcntl.h>
 #include <netinet/in.h>
 #include <signal.h>
+#include <sys/epoll.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 // Third party includes
@@ -38,14 +43,25 @@
 
 // Local includes.
 #include "args.h"
+#include "asset_cache.h"
+#include "backend_pool.h"
+#include "challenge_pool.h"
+#include "conn_arena.h"
 #include "constants.h"
 #include "db.h"
 #include "db_msql.h"
+#include "difficulty.h"
+#include "event_workers.h"
+#include "gzip_template.h"
 #include "helpers.h"
 #include "http.h"
+#include "metrics.h"
+#include "peer_sync.h"
 #include "poor_mans_print.h"
+#include "response_template.h"
 #include "thread_limit.h"
 #include "thread_pool.h"
+#include "ttl_cache.h"
 
 volatile int interrupt_received = 0;
 
@@ -65,51 +81,146 @@ struct AddrPortInfo {
   std::string client_addr;
   std::string immediate_client_addr;
   // 0 - is ipv4
+  // 1 - close connection once remaining_buffer is flushed
   std::bitset<16> flags;
   uint16_t remote_port;
   uint16_t local_port;
   uint16_t ticks;
+  // Requests served on this connection, for the keep-alive request cap.
+  uint16_t served_requests;
 };
 
 struct ThreadData {
   AddrPortInfo addr_port_info;
+  // Msql connection borrowed from the pool for this client connection.
+  std::optional<PMA_MSQL::Connection> msql_conn_opt;
+  // Long-lived ctx shared by all connection handlers.
+  PMA_SQL::SQLITECtx *sqlite_ctx;
   const PMA_ARGS::Args *args;
-  const std::optional<PMA_MSQL::Conf> *msql_conf_opt;
-  std::mutex *cached_allowed_mutex;
-  std::unordered_map<std::string,
-                     std::chrono::time_point<std::chrono::steady_clock> >
-      *cached_allowed;
+  PMA_MSQL::ConnectionPool *msql_pool;
+  TTLCache *cached_allowed;
+  // Scratch for the request read buffer and parse; reset every service pass
+  // and recycled with the ThreadData across connections.
+  ConnArena arena;
+  // "addr:port" key of the origin dest_conn_fd is connected to, so the fd
+  // can be handed back to the backend pool (or dropped when the origin
+  // changes between requests).
+  std::string dest_conn_key;
+  // Capture state for a forwarded asset response being considered for the
+  // asset cache.
+  // 0 - capturing
+  // 1 - abandoned (too large or uncacheable encoding)
+  // 2 - origin replied 200
+  // 3 - body received completely
+  std::bitset<8> asset_capture_flags;
+  std::string asset_capture_body;
+  std::string asset_capture_content_type;
   int conn_fd;
   int dest_conn_fd;
 };
 
+// Pool of ThreadData objects (and the arenas they own) so per-connection
+// setup is a free-list pop instead of a heap allocation.
+std::mutex thread_data_pool_mutex{};
+std::vector<ThreadData *> thread_data_pool{};
+
+ThreadData *thread_data_acquire() {
+  {
+    std::lock_guard<std::mutex> lock(thread_data_pool_mutex);
+    if (!thread_data_pool.empty()) {
+      ThreadData *data = thread_data_pool.back();
+      thread_data_pool.pop_back();
+      return data;
+    }
+  }
+  return new ThreadData;
+}
+
+void thread_data_release(ThreadData *data) {
+  data->addr_port_info = AddrPortInfo{};
+  data->msql_conn_opt = std::nullopt;
+  data->arena.reset();
+  data->dest_conn_key.clear();
+  data->asset_capture_flags.reset();
+  data->asset_capture_body.clear();
+  data->asset_capture_content_type.clear();
+  data->conn_fd = -1;
+  data->dest_conn_fd = -1;
+  {
+    std::lock_guard<std::mutex> lock(thread_data_pool_mutex);
+    if (thread_data_pool.size() < THREAD_DATA_POOL_MAX_IDLE_SIZE) {
+      thread_data_pool.push_back(data);
+      return;
+    }
+  }
+  delete data;
+}
+
+// Compiled once on first use; segments are views into the static template
+// strings from constants.cc.
+const ResponseTemplate &js_factors_worker_template() {
+  static const ResponseTemplate tmpl(
+      JS_FACTORS_WORKER, {"{API_URL}", "{LARGE_NUMBER}", "{UUID}"});
+  return tmpl;
+}
+
+const ResponseTemplate &html_body_factors_template() {
+  static const ResponseTemplate tmpl(HTML_BODY_FACTORS, {"{JS_FACTORS_URL}"});
+  return tmpl;
+}
+
+// Precompressed variants served to clients that accept gzip: the static
+// segments are deflated once here and per-request values ride along as
+// stored blocks, so no request pays for compression.
+const GzipResponseTemplate &js_factors_worker_gzip_template() {
+  static const GzipResponseTemplate tmpl(
+      JS_FACTORS_WORKER, {"{API_URL}", "{LARGE_NUMBER}", "{UUID}"});
+  return tmpl;
+}
+
+const GzipResponseTemplate &html_body_factors_gzip_template() {
+  static const GzipResponseTemplate tmpl(HTML_BODY_FACTORS,
+                                         {"{JS_FACTORS_URL}"});
+  return tmpl;
+}
+
 AddrPortInfo conv_addr_port(const PMA_ARGS::AddrPort &addr_port, bool is_ipv4) {
   AddrPortInfo info = {std::nullopt,           std::get<0>(addr_port),
                        std::string{},          std::string{},
                        std::bitset<16>{},      0,
-                       std::get<1>(addr_port), 0};
+                       std::get<1>(addr_port), 0,
+                       0};
 
   info.flags.set(0, is_ipv4);
 
   return info;
 }
 
-std::vector<uint8_t> internal_blake3_hash_fn(void *data, size_t size) {
-  std::vector<uint8_t> hash;
+PMA_HELPER::HashResult internal_blake3_hash_fn(void *data, size_t size) {
+  static_assert(PMA_HELPER::HASH_RESULT_SIZE == BLAKE3_OUT_LEN);
+  PMA_HELPER::HashResult hash;
 
   blake3_hasher hasher;
-  std::memset(&hasher, 0, sizeof(blake3_hasher));
   blake3_hasher_init(&hasher);
 
   blake3_hasher_update(&hasher, data, size);
 
-  hash.resize(BLAKE3_OUT_LEN);
-
   blake3_hasher_finalize(&hasher, hash.data(), BLAKE3_OUT_LEN);
 
   return hash;
 }
 
+// Quad count for the next issued challenge: the configured --factors value,
+// or the adaptive controller's pick when --factors-band is set.
+uint64_t issue_challenge_quads(const PMA_ARGS::Args *args) {
+  if (!args->flags.test(10)) {
+    return args->factors;
+  }
+  return difficulty_controller_get().pick_quads(
+      args->factors, args->factors_min, args->factors_max,
+      metrics_get().active_connections_count());
+}
+
 size_t pma_curl_data_callback(char *buf, size_t size, size_t nmemb, void *ud) {
   ThreadData *data = reinterpret_cast<ThreadData *>(ud);
 
@@ -205,6 +316,15 @@ CURL_DATA_CALLBACK_WRITE_FUNCTION_DATA_END:
     goto CURL_DATA_CALLBACK_WRITE_FUNCTION_DATA_END;
   }
 
+  if (data->asset_capture_flags.test(0) && !data->asset_capture_flags.test(1)) {
+    if (data->asset_capture_body.size() + bytes > ASSET_CACHE_MAX_ENTRY_BYTES) {
+      data->asset_capture_flags.set(1);
+      data->asset_capture_body.clear();
+    } else {
+      data->asset_capture_body.append(buf, bytes);
+    }
+  }
+
   return size * nmemb;
 }
 
@@ -246,6 +366,18 @@ size_t pma_curl_header_callback(char *buf, size_t size, size_t nitems,
   std::string buf_str(buf, size * nitems);
   buf_str =
       PMA_HELPER::ascii_str_to_lower(PMA_HELPER::trim_whitespace(buf_str));
+  if (data->asset_capture_flags.test(0)) {
+    if (buf_str.starts_with("http/")) {
+      data->asset_capture_flags.set(2, buf_str.find(" 200") !=
+                                           std::string::npos);
+    } else if (buf_str.starts_with("content-type")) {
+      if (auto colon_idx = buf_str.find(':');
+          colon_idx != std::string::npos) {
+        data->asset_capture_content_type =
+            PMA_HELPER::trim_whitespace(buf_str.substr(colon_idx + 1));
+      }
+    }
+  }
   if (buf_str.starts_with("content-length") ||
       buf_str.starts_with("connection") ||
       buf_str.starts_with("accept-ranges") ||
@@ -292,14 +424,49 @@ size_t pma_curl_body_send_callback(char *buf, size_t size, size_t nitems,
   return min;
 }
 
+// Pool of long-lived curl easy handles so that backend keep-alive
+// connections and libcurl's DNS cache survive across requests.
+std::mutex curl_pool_mutex{};
+std::vector<CURL *> curl_pool{};
+
+CURL *curl_pool_acquire() {
+  {
+    std::lock_guard<std::mutex> lock(curl_pool_mutex);
+    if (!curl_pool.empty()) {
+      CURL *handle = curl_pool.back();
+      curl_pool.pop_back();
+      return handle;
+    }
+  }
+  return curl_easy_init();
+}
+
+void curl_pool_release(CURL *handle) {
+  if (!handle) {
+    return;
+  }
+  // Clears per-request options but keeps live connections, the DNS cache,
+  // and the session cache.
+  curl_easy_reset(handle);
+  {
+    std::lock_guard<std::mutex> lock(curl_pool_mutex);
+    if (curl_pool.size() < CURL_POOL_MAX_IDLE_SIZE) {
+      curl_pool.push_back(handle);
+      return;
+    }
+  }
+  curl_easy_cleanup(handle);
+}
+
 void do_curl_forwarding(ThreadData *data, const PMA_HTTP::Request &req,
                         std::bitset<32> &forward_flags) {
   forward_flags.set(2);
+  MetricsTimer metrics_timer(Metrics::Stage::FORWARD);
 
   CURLcode pma_curl_ret;
-  CURL *curl_handle = curl_easy_init();
+  CURL *curl_handle = curl_pool_acquire();
   GenericCleanup<CURL *> pma_curl_cleanup(
-      curl_handle, [](CURL **handle) { curl_easy_cleanup(*handle); });
+      curl_handle, [](CURL **handle) { curl_pool_release(*handle); });
 
 #ifndef NDEBUG
   pma_curl_ret = curl_easy_setopt(curl_handle, CURLOPT_VERBOSE, 1);
@@ -698,11 +865,57 @@ END_OF_LIBCURL_SEND_CHUNKED_ENC_END:
     offset += static_cast<size_t>(write_ret);
     goto END_OF_LIBCURL_SEND_CHUNKED_ENC_END;
   }
+
+  // A completed perform means the captured body (if any) is whole.
+  data->asset_capture_flags.set(3);
+}
+
+// Writes the full buffer to fd, waiting out EAGAIN like the forwarding write
+// loops. Returns nonzero on error (errno is preserved).
+int_fast8_t forwarding_write_all(int fd, const char *w_buf, size_t size) {
+  size_t offset = 0;
+  while (offset < size) {
+    ssize_t write_ret = write(fd, w_buf + offset, size - offset);
+    if (write_ret < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        // Non-blocking IO, client did not accept data
+        std::this_thread::sleep_for(SLEEP_MILLISECONDS_CHRONO);
+        continue;
+      }
+      return 1;
+    } else if (write_ret == 0) {
+      return 1;
+    }
+    offset += static_cast<size_t>(write_ret);
+  }
+  return 0;
+}
+
+// Drains "size" bytes from the pipe into fd via splice, waiting out EAGAIN.
+// Returns nonzero on error (errno is preserved).
+int_fast8_t forwarding_splice_all(int pipe_read_fd, int fd, size_t size) {
+  while (size > 0) {
+    ssize_t spliced = splice(pipe_read_fd, nullptr, fd, nullptr, size,
+                             SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (spliced < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        // Non-blocking IO, client did not accept data
+        std::this_thread::sleep_for(SLEEP_MILLISECONDS_CHRONO);
+        continue;
+      }
+      return 1;
+    } else if (spliced == 0) {
+      return 1;
+    }
+    size -= static_cast<size_t>(spliced);
+  }
+  return 0;
 }
 
 void do_ipv4_socket_forwarding(ThreadData *data, std::bitset<32> &forward_flags,
                                const PMA_HTTP::Request &req) {
   forward_flags.set(2);
+  MetricsTimer metrics_timer(Metrics::Stage::FORWARD);
 
   std::string addr;
   uint32_t port = 80;
@@ -802,9 +1015,19 @@ void do_ipv4_socket_forwarding(ThreadData *data, std::bitset<32> &forward_flags,
 
   PMA_HTTP::ErrorT err = PMA_HTTP::ErrorT::SUCCESS;
   std::string err_msg{};
+  const std::string backend_key = std::format("{}:{}", addr, port);
   int socket_fd = data->dest_conn_fd;
   int_fast8_t using_dest_conn_fd = 1;
 
+  if (socket_fd > 0 && data->dest_conn_key != backend_key) {
+    // The warm connection is to a different origin than this request's
+    // destination; hand it back to the pool and start over.
+    backend_pool_get().release(data->dest_conn_key, socket_fd,
+                               std::chrono::steady_clock::now());
+    data->dest_conn_fd = -1;
+    socket_fd = -1;
+  }
+
   GenericCleanup<int *> cleanup_socket(&socket_fd, [](int **fd) {
     if (fd && *fd && **fd > 0) {
       close(**fd);
@@ -889,6 +1112,16 @@ void do_ipv4_socket_forwarding(ThreadData *data, std::bitset<32> &forward_flags,
           if (socket_fd > 0) {
             close(socket_fd);
           }
+          // Prefer a pooled keep-alive connection to this origin. A pooled
+          // fd may still die between validation and the write, so keep the
+          // retry flag set until the pool is exhausted; each retry pops an
+          // entry, so this terminates.
+          socket_fd = backend_pool_get().acquire(
+              backend_key, std::chrono::steady_clock::now());
+          if (socket_fd > 0) {
+            using_dest_conn_fd = 1;
+            continue;
+          }
           std::tie(err, err_msg, socket_fd) =
               PMA_HTTP::connect_ipv4_socket_client(addr, "0.0.0.0",
                                                    static_cast<uint16_t>(port));
@@ -914,6 +1147,28 @@ void do_ipv4_socket_forwarding(ThreadData *data, std::bitset<32> &forward_flags,
     }
   }
 
+  // Pipe used for the splice()-based zero-copy body relay once headers are
+  // parsed. If the pipe can't be created or splice isn't applicable to the
+  // fds, the userspace buffer path below is used instead.
+  std::array<int, 2> splice_pipe{-1, -1};
+  int_fast8_t splice_usable = 0;
+  if (pipe2(splice_pipe.data(), O_NONBLOCK) == 0) {
+    splice_usable = 1;
+  }
+  if (data->asset_capture_flags.test(0)) {
+    // Captured bytes must pass through userspace, so the buffer path is
+    // used while populating the asset cache.
+    splice_usable = 0;
+  }
+  GenericCleanup<int *> cleanup_pipe(splice_pipe.data(), [](int **fds) {
+    if ((*fds)[0] >= 0) {
+      close((*fds)[0]);
+    }
+    if ((*fds)[1] >= 0) {
+      close((*fds)[1]);
+    }
+  });
+
   // Must be REQ_READ_BUF_SIZE + 2, because up to 2 bytes are appended later.
   std::array<char, REQ_READ_BUF_SIZE + 2> buf;
   int_fast8_t before_first_line = 1;
@@ -931,14 +1186,21 @@ void do_ipv4_socket_forwarding(ThreadData *data, std::bitset<32> &forward_flags,
   headers.insert(std::make_pair("transfer-encoding", "chunked"));
 
   const auto verify_header_fn = [&header_name, &header_value,
-                                 &recv_content_size, &forward_flags,
-                                 &headers]() {
+                                 &recv_content_size, &forward_flags, &headers,
+                                 data]() {
     std::string header_name_lower = PMA_HELPER::ascii_str_to_lower(header_name);
+    if (data->asset_capture_flags.test(0) &&
+        header_name_lower == "content-type") {
+      data->asset_capture_content_type =
+          PMA_HELPER::trim_whitespace(header_value);
+    }
     if (header_name_lower == "transfer-encoding" &&
         PMA_HELPER::ascii_str_to_lower(
             PMA_HELPER::trim_whitespace(header_value)) == "chunked") {
       // PMA_EPrintln("DEBUG: remote is using chunked encoding");
       forward_flags.set(0);
+      // Chunk framing would be captured verbatim; skip caching.
+      data->asset_capture_flags.set(1);
     } else if (header_name_lower != "content-length" &&
                header_name_lower != "connection" &&
                header_name_lower != "accept-ranges" &&
@@ -966,6 +1228,88 @@ void do_ipv4_socket_forwarding(ThreadData *data, std::bitset<32> &forward_flags,
     if (forward_flags.test(1) && !before_content) {
       goto DO_IPV4_FORWARDING_END_OF_STREAM;
     }
+    if (!before_content && splice_usable) {
+      // Body phase: relay backend bytes to the client through the pipe
+      // without copying them through userspace.
+      size_t splice_limit = REQ_READ_BUF_SIZE;
+      if (!forward_flags.test(0) && recv_content_size.has_value()) {
+        if (recv_content_size.value() == 0) {
+          goto DO_IPV4_FORWARDING_END_OF_STREAM;
+        } else if (recv_content_size.value() < splice_limit) {
+          splice_limit = recv_content_size.value();
+        }
+      }
+      ssize_t spliced = splice(socket_fd, nullptr, splice_pipe.at(1), nullptr,
+                               splice_limit, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+      if (spliced == -1) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          if (recv_content_size.has_value() && recv_content_size.value() == 0) {
+            goto DO_IPV4_FORWARDING_END_OF_STREAM;
+          }
+          std::this_thread::sleep_for(SLEEP_MILLISECONDS_CHRONO);
+          ++wait_ticks;
+          continue;
+        } else if (errno == EINVAL) {
+          // splice is not applicable to this fd pair; use the buffer path.
+          splice_usable = 0;
+          continue;
+        } else {
+          PMA_EPrintln("ERROR: Failed to splice response, errno {}", errno);
+          return;
+        }
+      } else if (spliced == 0) {
+        // EOF.
+        goto DO_IPV4_FORWARDING_END_OF_STREAM;
+      }
+      wait_ticks = 0;
+      size_t in_pipe = static_cast<size_t>(spliced);
+      if (forward_flags.test(0)) {
+        // Remote chunked encoding passes through to the client as-is.
+        if (forwarding_splice_all(splice_pipe.at(0), data->conn_fd, in_pipe)) {
+          if (errno != EPIPE) {
+            PMA_EPrintln(
+                "ERROR: Failed to splice response to client (errno {})!",
+                errno);
+          }
+          return;
+        }
+      } else {
+        // Frame the spliced bytes as one chunk.
+        std::array<char, 24> chunk_size_buf;
+        int snprintf_ret =
+            std::snprintf(chunk_size_buf.data(), 24, "%zx\r\n", in_pipe);
+        if (snprintf_ret <= 0) {
+          PMA_EPrintln("ERROR: Failed to prepare chunk size buf!");
+          return;
+        }
+        if (forwarding_write_all(data->conn_fd, chunk_size_buf.data(),
+                                 static_cast<size_t>(snprintf_ret))) {
+          PMA_EPrintln("ERROR: Failed to write chunk size to client (errno {})!",
+                       errno);
+          return;
+        }
+        if (forwarding_splice_all(splice_pipe.at(0), data->conn_fd, in_pipe)) {
+          if (errno != EPIPE) {
+            PMA_EPrintln(
+                "ERROR: Failed to splice content to client (errno {})!", errno);
+          }
+          return;
+        }
+        if (forwarding_write_all(data->conn_fd, "\r\n", 2)) {
+          PMA_EPrintln("ERROR: Failed to write chunk end to client (errno {})!",
+                       errno);
+          return;
+        }
+        if (recv_content_size.has_value()) {
+          if (recv_content_size.value() >= in_pipe) {
+            recv_content_size.value() -= in_pipe;
+          } else {
+            recv_content_size.value() = 0;
+          }
+        }
+      }
+      continue;
+    }
     // Must be REQ_READ_BUF_SIZE not buf.size(), because buf is actually larger.
     read_ret = read(socket_fd, buf.data(), REQ_READ_BUF_SIZE);
     if (read_ret == -1) {
@@ -1004,6 +1348,10 @@ void do_ipv4_socket_forwarding(ThreadData *data, std::bitset<32> &forward_flags,
             } else if (read_size > idx + 1 && buf.at(idx + 1) == '\n') {
               before_first_line = 0;
               skip_before_idx = idx + 2;
+              if (data->asset_capture_flags.test(0)) {
+                data->asset_capture_flags.set(
+                    2, status.find(" 200") != std::string::npos);
+              }
             } else {
               PMA_EPrintln("ERROR: Invalid forwarded status line");
               return;
@@ -1200,6 +1548,16 @@ void do_ipv4_socket_forwarding(ThreadData *data, std::bitset<32> &forward_flags,
           }
         } else {
           // receiving data without chunked encoding
+          if (data->asset_capture_flags.test(0) &&
+              !data->asset_capture_flags.test(1)) {
+            if (data->asset_capture_body.size() + read_size >
+                ASSET_CACHE_MAX_ENTRY_BYTES) {
+              data->asset_capture_flags.set(1);
+              data->asset_capture_body.clear();
+            } else {
+              data->asset_capture_body.append(buf.data(), read_size);
+            }
+          }
           std::array<char, 24> chunk_size_buf;
           int snprintf_ret =
               std::snprintf(chunk_size_buf.data(), 24, "%zx\r\n", read_size);
@@ -1289,153 +1647,391 @@ void do_ipv4_socket_forwarding(ThreadData *data, std::bitset<32> &forward_flags,
   //   PMA_EPrintln("TIMED OUT read from dest for url {}", req.full_url);
   // }
 
+  if (data->asset_capture_flags.test(0) &&
+      wait_ticks < data->args->req_timeout_ticks &&
+      (!recv_content_size.has_value() || recv_content_size.value() == 0)) {
+    data->asset_capture_flags.set(3);
+  }
+
   data->dest_conn_fd = socket_fd;
+  data->dest_conn_key = backend_key;
   socket_fd = -1;
 }
 
-void thread_handle_connection_fn(void *ud) {
-  ThreadData *data = reinterpret_cast<ThreadData *>(ud);
-  std::array<char, REQ_READ_BUF_SIZE> buf;
-
-  // Lazy load the connection to msql.
-  std::optional<PMA_MSQL::Connection> msql_conn_opt;
-
-  while (data->addr_port_info.ticks < THREAD_TIMEOUT_TICKS) {
-    std::this_thread::sleep_for(SLEEP_MILLISECONDS_CHRONO);
-    data->addr_port_info.ticks += 1;
-
-    auto time_now = std::chrono::steady_clock::now();
+// Loaded once from the system mime.types on first use; used to type cached
+// asset responses whose origin reply carried no content-type.
+const PMA_HELPER::MimeTypes &mime_types_get() {
+  static const PMA_HELPER::MimeTypes internal_mime_types{};
+  return internal_mime_types;
+}
 
-    if (data->addr_port_info.remaining_buffer.has_value()) {
-      ssize_t write_ret = write(
-          data->conn_fd, data->addr_port_info.remaining_buffer.value().data(),
-          data->addr_port_info.remaining_buffer.value().size());
-      if (write_ret == -1) {
-        if (errno == EAGAIN || errno == EWOULDBLOCK) {
-          // Nonblocking-IO indicating to write later, intentionally left
-          // blank.
-        } else {
-          PMA_EPrintln(
-              "ERROR: Failed to send partial response to client {} "
-              "(write_ret {}, errno {})!",
-              data->addr_port_info.client_addr, write_ret, errno);
-          break;
+// Forwards a request via libcurl or the socket relay. Extension-matched GET
+// requests are first checked against the in-memory asset cache and served
+// directly on a hit; on a miss the response is captured while it streams to
+// the client and inserted into the cache when it completes with a 200.
+void do_forwarding(ThreadData *data, const PMA_HTTP::Request &req,
+                   std::bitset<32> &forward_flags) {
+  std::string asset_key;
+  if (req.method == "GET" && !data->args->cached_asset_exts.empty()) {
+    const std::string ext = PMA_HELPER::ascii_str_to_lower(
+        PMA_HELPER::get_file_ext(req.full_url));
+    if (!ext.empty() && data->args->cached_asset_exts.contains(ext)) {
+      asset_key = std::format("{}:{}", data->addr_port_info.local_port,
+                              req.full_url);
+      auto cached_opt = asset_cache_get().lookup(
+          asset_key, std::chrono::steady_clock::now());
+      if (cached_opt.has_value()) {
+        forward_flags.set(2);
+        MetricsTimer metrics_timer(Metrics::Stage::FORWARD);
+        std::string content_type = cached_opt.value().content_type;
+        if (content_type.empty()) {
+          content_type = mime_types_get().get_mimetype_from_ext(ext);
         }
-      } else if (write_ret !=
-                 static_cast<ssize_t>(
-                     data->addr_port_info.remaining_buffer.value().size())) {
-        if (write_ret > 0) {
-          data->addr_port_info.remaining_buffer =
-              data->addr_port_info.remaining_buffer.value().substr(
-                  static_cast<size_t>(write_ret));
-        } else {
-          PMA_EPrintln(
-              "ERROR: Failed to send partial response to client {} "
-              "(write_ret {}, errno {})!",
-              data->addr_port_info.client_addr, write_ret, errno);
-          break;
+        if (content_type.empty()) {
+          content_type = "application/octet-stream";
         }
-      } else {
-        data->addr_port_info.remaining_buffer = std::nullopt;
-        data->addr_port_info.ticks = 0;
+        const std::string header = std::format(
+            "HTTP/1.1 200 OK\r\nContent-type: {}\r\nContent-Length: "
+            "{}\r\n\r\n",
+            content_type, cached_opt.value().body->size());
+        if (forwarding_write_all(data->conn_fd, header.data(),
+                                 header.size()) ||
+            forwarding_write_all(data->conn_fd,
+                                 cached_opt.value().body->data(),
+                                 cached_opt.value().body->size())) {
+          if (errno != EPIPE) {
+            PMA_EPrintln(
+                "ERROR: Failed to write cached asset to client (errno {})!",
+                errno);
+          }
+        }
+        return;
       }
-      continue;
+      data->asset_capture_flags.set(0);
     }
+  }
 
-    ssize_t read_ret = read(data->conn_fd, buf.data(), buf.size() - 1);
-    if (read_ret == -1) {
+  if (data->args->flags.test(5)) {
+    do_curl_forwarding(data, req, forward_flags);
+  } else {
+    do_ipv4_socket_forwarding(data, forward_flags, req);
+  }
+
+  if (data->asset_capture_flags.test(0)) {
+    if (!data->asset_capture_flags.test(1) &&
+        data->asset_capture_flags.test(2) &&
+        data->asset_capture_flags.test(3) &&
+        !data->asset_capture_body.empty()) {
+      asset_cache_get().insert(asset_key,
+                               std::move(data->asset_capture_content_type),
+                               std::move(data->asset_capture_body),
+                               std::chrono::steady_clock::now());
+    }
+    data->asset_capture_flags.reset();
+    data->asset_capture_body.clear();
+    data->asset_capture_content_type.clear();
+  }
+}
+
+// One nonblocking service pass over a connection: flushes any partially
+// written response, then reads and handles at most one request. Used by
+// "thread_handle_connection_fn" (looping with sleeps between passes) and as
+// the step fn for EventWorkers.
+EventWorkers::StepResult handle_connection_step(ThreadData *data) {
+  // Nothing arena-allocated survives a pass, so reclaim everything up front;
+  // after the first pass this reuses the same block.
+  data->arena.reset();
+  char *buf = reinterpret_cast<char *>(data->arena.alloc(REQ_READ_BUF_SIZE));
+
+  // Borrowed from the pool on first use, returned on cleanup.
+  std::optional<PMA_MSQL::Connection> &msql_conn_opt = data->msql_conn_opt;
+
+  auto time_now = std::chrono::steady_clock::now();
+
+  if (data->addr_port_info.remaining_buffer.has_value()) {
+    ssize_t write_ret = write(
+        data->conn_fd, data->addr_port_info.remaining_buffer.value().data(),
+        data->addr_port_info.remaining_buffer.value().size());
+    if (write_ret == -1) {
       if (errno == EAGAIN || errno == EWOULDBLOCK) {
-        // Nonblocking-IO indicating no bytes to read
-        continue;
+        // Nonblocking-IO indicating to write later.
+        return EventWorkers::StepResult::KEEP_WRITABLE;
       } else {
-        if (errno != ECONNRESET) {
-          PMA_Println("Failed to read from client {} (errno {})",
-                      data->addr_port_info.client_addr, errno);
-        }
-        break;
+        PMA_EPrintln(
+            "ERROR: Failed to send partial response to client {} "
+            "(write_ret {}, errno {})!",
+            data->addr_port_info.client_addr, write_ret, errno);
+        return EventWorkers::StepResult::CLOSE;
       }
-    }
-    if (read_ret > 0) {
+    } else if (write_ret !=
+               static_cast<ssize_t>(
+                   data->addr_port_info.remaining_buffer.value().size())) {
+      if (write_ret > 0) {
+        data->addr_port_info.remaining_buffer =
+            data->addr_port_info.remaining_buffer.value().substr(
+                static_cast<size_t>(write_ret));
+        return EventWorkers::StepResult::KEEP_WRITABLE;
+      } else {
+        PMA_EPrintln(
+            "ERROR: Failed to send partial response to client {} "
+            "(write_ret {}, errno {})!",
+            data->addr_port_info.client_addr, write_ret, errno);
+        return EventWorkers::StepResult::CLOSE;
+      }
+    } else {
+      data->addr_port_info.remaining_buffer = std::nullopt;
       data->addr_port_info.ticks = 0;
-      buf.at(static_cast<size_t>(read_ret)) = 0;
-      PMA_HTTP::Request req = PMA_HTTP::handle_request_parse(
-          std::string(buf.data(), static_cast<size_t>(read_ret)));
-      if (req.error_enum == PMA_HTTP::ErrorT::SUCCESS) {
+      if (data->addr_port_info.flags.test(1)) {
+        return EventWorkers::StepResult::CLOSE;
+      }
+    }
+    return EventWorkers::StepResult::KEEP;
+  }
+
+  ssize_t read_ret = read(data->conn_fd, buf, REQ_READ_BUF_SIZE - 1);
+  if (read_ret == -1) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      // Nonblocking-IO indicating no bytes to read
+      return EventWorkers::StepResult::KEEP;
+    } else {
+      if (errno != ECONNRESET) {
+        PMA_Println("Failed to read from client {} (errno {})",
+                    data->addr_port_info.client_addr, errno);
+      }
+      return EventWorkers::StepResult::CLOSE;
+    }
+  }
+  if (read_ret > 0) {
+    data->addr_port_info.ticks = 0;
+    buf[static_cast<size_t>(read_ret)] = 0;
+    // Views are sliced out of the arena-owned buffer; to_request() copies
+    // only the pieces the handler keeps.
+    PMA_HTTP::Request req = [buf, read_ret]() {
+      MetricsTimer timer(Metrics::Stage::PARSE);
+      return PMA_HTTP::handle_request_parse_view(
+                 std::string_view(buf, static_cast<size_t>(read_ret)))
+          .to_request();
+    }();
+    if (req.error_enum == PMA_HTTP::ErrorT::SUCCESS) {
 #ifndef NDEBUG
-        PMA_Println("URL: {}, FULL URL: {}, Params:", req.url_or_err_msg,
-                    req.full_url);
-        for (auto qiter = req.queries.begin(); qiter != req.queries.end();
-             ++qiter) {
-          PMA_Println("  {}={}", qiter->first, qiter->second);
-        }
-        PMA_Println("Headers:");
-        for (auto hiter = req.headers.begin(); hiter != req.headers.end();
-             ++hiter) {
-          PMA_Println("  {}: {}", hiter->first, hiter->second);
-        }
+      PMA_Println("URL: {}, FULL URL: {}, Params:", req.url_or_err_msg,
+                  req.full_url);
+      for (auto qiter = req.queries.begin(); qiter != req.queries.end();
+           ++qiter) {
+        PMA_Println("  {}={}", qiter->first, qiter->second);
+      }
+      PMA_Println("Headers:");
+      for (auto hiter = req.headers.begin(); hiter != req.headers.end();
+           ++hiter) {
+        PMA_Println("  {}: {}", hiter->first, hiter->second);
+      }
 #endif
-        if (data->args->flags.test(0)) {
-          if (auto fiter = req.headers.find("x-real-ip");
-              fiter != req.headers.end()) {
+      if (data->args->flags.test(0)) {
+        if (auto fiter = req.headers.find("x-real-ip");
+            fiter != req.headers.end()) {
 #ifndef NDEBUG
-            PMA_Println("x-real-ip header found, changing client addr: {}",
-                        fiter->second);
+          PMA_Println("x-real-ip header found, changing client addr: {}",
+                      fiter->second);
 #endif
-            data->addr_port_info.client_addr = fiter->second;
-          }
-        }
-
-        std::string status = "HTTP/1.0 200 OK";
-        std::string content_type = "Content-type: text/html; charset=utf-8";
-        std::string body;
-        PMA_SQL::SQLITECtx sqliteCtx;
-        PMA_SQL::ErrorT err = PMA_SQL::ErrorT::SUCCESS;
-        std::string msg;
-        if (!data->args->flags.test(4)) {
-          std::tie(sqliteCtx, err, msg) =
-              PMA_SQL::init_sqlite(data->args->sqlite_path);
+          data->addr_port_info.client_addr = fiter->second;
         }
+      }
 
-        // 0 - remote content-type: chunked
-        // 1 - 304 response
-        // 2 - using forwarding
-        std::bitset<32> forward_flags;
-
-        if (err != PMA_SQL::ErrorT::SUCCESS) {
-          PMA_EPrintln("ERROR: Failed to initialize sqlite: {}, {}",
-                       PMA_SQL::error_t_to_string(err), msg);
-          status = "HTTP/1.0 500 Internal Server Error";
+      // Keep-alive: the same connection serves further requests (the whole
+      // challenge flow rides one connection) unless the client asked to
+      // close or the per-connection request cap is reached. Idle timeout is
+      // the existing ticks/THREAD_TIMEOUT_TICKS machinery.
+      data->addr_port_info.served_requests += 1;
+      bool keep_alive =
+          data->addr_port_info.served_requests < KEEP_ALIVE_MAX_REQUESTS;
+      if (auto citer = req.headers.find("connection");
+          citer != req.headers.end() &&
+          PMA_HELPER::ascii_str_to_lower(
+              PMA_HELPER::trim_whitespace(citer->second)) == "close") {
+        keep_alive = false;
+      }
+      data->addr_port_info.flags.set(1, !keep_alive);
+
+      std::string status = "HTTP/1.1 200 OK";
+      std::string content_type = "Content-type: text/html; charset=utf-8";
+      std::string body;
+      // Set instead of body for templated pages; the response is then
+      // emitted with writev over the precompiled segments.
+      const ResponseTemplate *resp_template = nullptr;
+      const GzipResponseTemplate *resp_gzip_template = nullptr;
+      std::vector<std::string> resp_values;
+      // Serve the precompressed template variant when the client accepts
+      // gzip.
+      bool accept_gzip = false;
+      if (auto aiter = req.headers.find("accept-encoding");
+          aiter != req.headers.end()) {
+        accept_gzip = PMA_HELPER::ascii_str_to_lower(aiter->second)
+                          .find("gzip") != std::string::npos;
+      }
+      PMA_SQL::SQLITECtx &sqliteCtx = *data->sqlite_ctx;
+
+      // 0 - remote content-type: chunked
+      // 1 - 304 response
+      // 2 - using forwarding
+      std::bitset<32> forward_flags;
+
+      if (!data->args->flags.test(4) && sqliteCtx.get_ctx() == nullptr) {
+        PMA_EPrintln("ERROR: Sqlite ctx is not initialized!");
+        status = "HTTP/1.1 500 Internal Server Error";
+        body =
+            "<html><p>500 Internal Server Error</p><p>Failed to init "
+            "db</p></html>";
+      } else if (req.url_or_err_msg == data->args->api_url) {
+        // Streamed so the multi-kilobyte "factors" answer is sliced out of
+        // the body without intermediate map/string copies.
+        std::string_view json_type, json_id, json_factors;
+        const PMA_HTTP::ErrorT err = PMA_HTTP::parse_simple_json_streaming(
+            req.body, DEFAULT_JSON_MAX_SIZE,
+            [&json_type, &json_id, &json_factors](std::string_view key,
+                                                  std::string_view value) {
+              if (key == "type") {
+                json_type = value;
+              } else if (key == "id") {
+                json_id = value;
+              } else if (key == "factors") {
+                json_factors = value;
+              }
+            });
+        if (err != PMA_HTTP::ErrorT::SUCCESS) {
+          PMA_EPrintln("ERROR: Failed to parse json from client {}!",
+                       data->addr_port_info.client_addr);
+          status = "HTTP/1.1 500 Internal Server Error";
           body =
-              "<html><p>500 Internal Server Error</p><p>Failed to init "
-              "db</p></html>";
-        } else if (req.url_or_err_msg == data->args->api_url) {
-          const auto [err, json_keyvals] =
-              PMA_HTTP::parse_simple_json(req.body);
-          if (err != PMA_HTTP::ErrorT::SUCCESS) {
-            PMA_EPrintln("ERROR: Failed to parse json from client {}!",
-                         data->addr_port_info.client_addr);
-            status = "HTTP/1.0 500 Internal Server Error";
-            body =
-                "<html><p>500 Internal Server Error</p><p>Failed to parse "
-                "json</p></html>";
-          } else if (json_keyvals.find("type") == json_keyvals.end() ||
-                     json_keyvals.find("id") == json_keyvals.end() ||
-                     json_keyvals.find("factors") == json_keyvals.end()) {
-            PMA_EPrintln("ERROR: Client {} omitted necessary info!",
+              "<html><p>500 Internal Server Error</p><p>Failed to parse "
+              "json</p></html>";
+        } else if (json_type.empty() || json_id.empty() ||
+                   json_factors.empty()) {
+          PMA_EPrintln("ERROR: Client {} omitted necessary info!",
+                       data->addr_port_info.client_addr);
+          status = "HTTP/1.1 400 Bad Request";
+          body = "<html><p>400 Bad Request</p><p>Missing info</p></html>";
+        } else if (const bool compact_answer = json_type == "factors-bin";
+                   data->args->flags.test(4)) {
+          bool ping_ok = false;
+          if (!msql_conn_opt.has_value() || !msql_conn_opt->is_valid()) {
+            msql_conn_opt = data->msql_pool->checkout();
+            if (!msql_conn_opt.has_value()) {
+              PMA_EPrintln(
+                  "ERROR: Thread failed to connect with MSQL server!");
+              status = "HTTP/1.1 500 Internal Server Error";
+              body =
+                  "<html><p>500 Internal Server Error</p><p>Problem with "
+                  "DB</p></html>";
+            } else {
+              ping_ok = true;
+            }
+          } else {
+            ping_ok = true;
+          }
+          // The msql backend hashes the canonical factors text itself, so a
+          // compact answer is decoded back to that text before validation.
+          std::optional<std::string> factors_opt =
+              compact_answer
+                  ? PMA_HELPER::compact_answer_to_factors_str(json_factors)
+                  : std::optional<std::string>(std::string(json_factors));
+          if (ping_ok && !factors_opt.has_value()) {
+            PMA_EPrintln("ERROR: Client {} sent malformed compact answer!",
                          data->addr_port_info.client_addr);
-            status = "HTTP/1.0 400 Bad Request";
-            body = "<html><p>400 Bad Request</p><p>Missing info</p></html>";
-          } else if (data->args->flags.test(4)) {
+            status = "HTTP/1.1 400 Bad Request";
+            content_type = "Content-type: text/plain";
+            body = "Incorrect";
+          } else if (ping_ok) {
+            const auto [err, port] = [&]() {
+              MetricsTimer timer(Metrics::Stage::DB);
+              return PMA_MSQL::validate_client(
+                  msql_conn_opt.value(), data->args->challenge_timeout,
+                  std::string(json_id), std::move(factors_opt.value()),
+                  data->addr_port_info.client_addr, internal_blake3_hash_fn);
+            }();
+            if (err == PMA_MSQL::Error::SUCCESS) {
+              PMA_Println("Challenge success from {}:{} port {}",
+                          data->addr_port_info.client_addr,
+                          data->addr_port_info.remote_port,
+                          data->addr_port_info.local_port);
+              content_type = "Content-type: text/plain";
+              body = "Correct";
+              data->cached_allowed->insert(
+                  std::format("{}:{}", data->addr_port_info.client_addr,
+                              data->addr_port_info.local_port),
+                  time_now);
+              peer_sync_broadcast_allowed(data->addr_port_info.client_addr,
+                                          data->addr_port_info.local_port);
+            } else {
+              PMA_EPrintln(
+                  "Warning: Client {}:{} -> {} failed challenge due to {}",
+                  data->addr_port_info.client_addr,
+                  data->addr_port_info.remote_port,
+                  data->addr_port_info.local_port,
+                  PMA_MSQL::error_to_str(err));
+              if (PMA_MSQL::error_is_client_err(err)) {
+                status = "HTTP/1.1 400 Bad Request";
+                content_type = "Content-type: text/plain";
+                body = "Incorrect";
+              } else {
+                status = "HTTP/1.1 500 Internal Server Error";
+                body =
+                    "<html><p>500 Internal Server Error</p><p>Failed to "
+                    "validate req</p></html>";
+              }
+            }
+          }
+        } else {
+          const auto [err, msg, port] = [&]() {
+            MetricsTimer timer(Metrics::Stage::DB);
+            if (compact_answer) {
+              // Streaming verification: the answer bytes are hashed as the
+              // pairs are decoded, with no std::string copy of the body.
+              return PMA_SQL::verify_answer_compact(
+                  sqliteCtx, json_factors, data->addr_port_info.client_addr,
+                  std::string(json_id));
+            }
+            return PMA_SQL::verify_answer(sqliteCtx, std::string(json_factors),
+                                          data->addr_port_info.client_addr,
+                                          std::string(json_id));
+          }();
+          if (err != PMA_SQL::ErrorT::SUCCESS) {
+            PMA_EPrintln(
+                "Warning: Client {}:{} -> {} failed challenge due to {}, "
+                "{}",
+                data->addr_port_info.client_addr,
+                data->addr_port_info.remote_port,
+                data->addr_port_info.local_port,
+                PMA_SQL::error_t_to_string(err), msg);
+            status = "HTTP/1.1 400 Bad Request";
+            content_type = "Content-type: text/plain";
+            body = "Incorrect";
+          } else {
+            PMA_Println("Challenge success from {}:{} port {}",
+                        data->addr_port_info.client_addr,
+                        data->addr_port_info.remote_port,
+                        data->addr_port_info.local_port);
+            content_type = "Content-type: text/plain";
+            body = "Correct";
+            data->cached_allowed->insert(
+                std::format("{}:{}", data->addr_port_info.client_addr,
+                            data->addr_port_info.local_port),
+                time_now);
+            peer_sync_broadcast_allowed(data->addr_port_info.client_addr,
+                                        data->addr_port_info.local_port);
+          }
+        }
+
+      } else if (req.url_or_err_msg == data->args->js_factors_url) {
+        if (auto id_iter = req.queries.find("id");
+            id_iter != req.queries.end()) {
+          if (data->args->flags.test(4)) {
             bool ping_ok = false;
             if (!msql_conn_opt.has_value() || !msql_conn_opt->is_valid()) {
-              msql_conn_opt = PMA_MSQL::Connection::connect_msql(
-                  (*data->msql_conf_opt)->addr, (*data->msql_conf_opt)->port,
-                  (*data->msql_conf_opt)->user, (*data->msql_conf_opt)->pass,
-                  (*data->msql_conf_opt)->db);
-              if (!msql_conn_opt.has_value() || !msql_conn_opt->ping_check()) {
+              msql_conn_opt = data->msql_pool->checkout();
+              if (!msql_conn_opt.has_value()) {
                 PMA_EPrintln(
                     "ERROR: Thread failed to connect with MSQL server!");
-                status = "HTTP/1.0 500 Internal Server Error";
+                status = "HTTP/1.1 500 Internal Server Error";
                 body =
                     "<html><p>500 Internal Server Error</p><p>Problem with "
                     "DB</p></html>";
@@ -1446,417 +2042,363 @@ void thread_handle_connection_fn(void *ud) {
               ping_ok = true;
             }
             if (ping_ok) {
-              const auto [err, port] = PMA_MSQL::validate_client(
-                  msql_conn_opt.value(), data->args->challenge_timeout,
-                  json_keyvals.find("id")->second,
-                  json_keyvals.find("factors")->second,
-                  data->addr_port_info.client_addr, internal_blake3_hash_fn);
-              if (err == PMA_MSQL::Error::SUCCESS) {
-                PMA_Println("Challenge success from {}:{} port {}",
-                            data->addr_port_info.client_addr,
-                            data->addr_port_info.remote_port,
-                            data->addr_port_info.local_port);
-                content_type = "Content-type: text/plain";
-                body = "Correct";
-                std::unique_lock<std::mutex> cached_allowed_lock(
-                    *data->cached_allowed_mutex);
-                data->cached_allowed->insert(std::make_pair(
-                    std::format("{}:{}", data->addr_port_info.client_addr,
-                                data->addr_port_info.local_port),
-                    time_now));
+              const auto [itp_err, port] = PMA_MSQL::get_id_to_port_port(
+                  msql_conn_opt.value(), id_iter->second);
+              if (itp_err == PMA_MSQL::Error::SUCCESS) {
+                const auto [cf_err, chall, hashed_id] = [&]() {
+                  MetricsTimer timer(Metrics::Stage::CHALLENGE_GENERATE);
+                  return PMA_MSQL::set_challenge_factor(
+                      msql_conn_opt.value(), data->addr_port_info.client_addr,
+                      port, issue_challenge_quads(data->args),
+                      data->args->challenge_timeout,
+                      internal_blake3_hash_fn);
+                }();
+                if (cf_err == PMA_MSQL::Error::SUCCESS) {
+                  PMA_Println("Requested challenge from {}:{} -> {}",
+                              data->addr_port_info.client_addr,
+                              data->addr_port_info.remote_port,
+                              data->addr_port_info.local_port);
+                  resp_template = &js_factors_worker_template();
+                  resp_gzip_template = &js_factors_worker_gzip_template();
+                  resp_values = {data->args->api_url, chall, hashed_id};
+                  content_type = "Content-type: text/javascript";
+                } else {
+                  if (PMA_MSQL::error_is_client_err(cf_err)) {
+                    status = "HTTP/1.1 400 Bad Request";
+                    body =
+                        "<html><p>400 Bad Request</p><p>(Failed setup "
+                        "challenge)</p></html>";
+                  } else {
+                    status = "HTTP/1.1 500 Internal Server Error";
+                    body =
+                        "<html><p>500 Internal Server Error</p><p>Failed "
+                        "to set up challenge</p></html>";
+                  }
+                }
               } else {
-                PMA_EPrintln(
-                    "Warning: Client {}:{} -> {} failed challenge due to {}",
-                    data->addr_port_info.client_addr,
-                    data->addr_port_info.remote_port,
-                    data->addr_port_info.local_port,
-                    PMA_MSQL::error_to_str(err));
-                if (PMA_MSQL::error_is_client_err(err)) {
-                  status = "HTTP/1.0 400 Bad Request";
-                  content_type = "Content-type: text/plain";
-                  body = "Incorrect";
+                if (PMA_MSQL::error_is_client_err(itp_err)) {
+                  PMA_EPrintln(
+                      "WARNING: Bad request from client {}:{} -> {} due to "
+                      "{}",
+                      data->addr_port_info.client_addr,
+                      data->addr_port_info.remote_port,
+                      data->addr_port_info.local_port,
+                      PMA_MSQL::error_to_str(itp_err));
+                  status = "HTTP/1.1 400 Bad Request";
+                  body = "<html><p>400 Bad Request</p><p>(No id)</p></html>";
                 } else {
-                  status = "HTTP/1.0 500 Internal Server Error";
+                  PMA_EPrintln(
+                      "WARNING: handling client {}:{} -> {} due to {}",
+                      data->addr_port_info.client_addr,
+                      data->addr_port_info.remote_port,
+                      data->addr_port_info.local_port,
+                      PMA_MSQL::error_to_str(itp_err));
+                  status = "HTTP/1.1 500 Internal Server Error";
                   body =
                       "<html><p>500 Internal Server Error</p><p>Failed to "
-                      "validate req</p></html>";
+                      "set up challenge</p></html>";
                 }
               }
             }
           } else {
-            const auto [err, msg, port] = PMA_SQL::verify_answer(
-                sqliteCtx, json_keyvals.find("factors")->second,
-                data->addr_port_info.client_addr,
-                json_keyvals.find("id")->second);
+            const auto [err, msg_or_chal, answ, id] = [&]() {
+              MetricsTimer timer(Metrics::Stage::CHALLENGE_GENERATE);
+              return PMA_SQL::generate_challenge(
+                  sqliteCtx, issue_challenge_quads(data->args),
+                  data->addr_port_info.client_addr, id_iter->second,
+                  internal_blake3_hash_fn);
+            }();
             if (err != PMA_SQL::ErrorT::SUCCESS) {
               PMA_EPrintln(
-                  "Warning: Client {}:{} -> {} failed challenge due to {}, "
+                  "ERROR: Failed to prepare challenge for client {}: {}, "
                   "{}",
                   data->addr_port_info.client_addr,
-                  data->addr_port_info.remote_port,
-                  data->addr_port_info.local_port,
-                  PMA_SQL::error_t_to_string(err), msg);
-              status = "HTTP/1.0 400 Bad Request";
-              content_type = "Content-type: text/plain";
-              body = "Incorrect";
+                  PMA_SQL::error_t_to_string(err), msg_or_chal);
+              status = "HTTP/1.1 500 Internal Server Error";
+              body =
+                  "<html><p>500 Internal Server Error</p><p>Failed to "
+                  "prepare challenge</p></html>";
             } else {
-              PMA_Println("Challenge success from {}:{} port {}",
+              PMA_Println("Requested challenge from {}:{} -> {}",
                           data->addr_port_info.client_addr,
                           data->addr_port_info.remote_port,
                           data->addr_port_info.local_port);
-              content_type = "Content-type: text/plain";
-              body = "Correct";
-              std::unique_lock<std::mutex> cached_allowed_lock(
-                  *data->cached_allowed_mutex);
-              data->cached_allowed->insert(std::make_pair(
-                  std::format("{}:{}", data->addr_port_info.client_addr,
-                              data->addr_port_info.local_port),
-                  time_now));
-            }
-          }
-
-        } else if (req.url_or_err_msg == data->args->js_factors_url) {
-          if (auto id_iter = req.queries.find("id");
-              id_iter != req.queries.end()) {
-            if (data->args->flags.test(4)) {
-              bool ping_ok = false;
-              if (!msql_conn_opt.has_value() || !msql_conn_opt->is_valid()) {
-                msql_conn_opt = PMA_MSQL::Connection::connect_msql(
-                    (*data->msql_conf_opt)->addr, (*data->msql_conf_opt)->port,
-                    (*data->msql_conf_opt)->user, (*data->msql_conf_opt)->pass,
-                    (*data->msql_conf_opt)->db);
-                if (!msql_conn_opt.has_value() ||
-                    !msql_conn_opt->ping_check()) {
-                  PMA_EPrintln(
-                      "ERROR: Thread failed to connect with MSQL server!");
-                  status = "HTTP/1.0 500 Internal Server Error";
-                  body =
-                      "<html><p>500 Internal Server Error</p><p>Problem with "
-                      "DB</p></html>";
-                } else {
-                  ping_ok = true;
-                }
-              } else {
-                ping_ok = true;
-              }
-              if (ping_ok) {
-                const auto [itp_err, port] = PMA_MSQL::get_id_to_port_port(
-                    msql_conn_opt.value(), id_iter->second);
-                if (itp_err == PMA_MSQL::Error::SUCCESS) {
-                  const auto [cf_err, chall, hashed_id] =
-                      PMA_MSQL::set_challenge_factor(
-                          msql_conn_opt.value(),
-                          data->addr_port_info.client_addr, port,
-                          data->args->factors, data->args->challenge_timeout,
-                          internal_blake3_hash_fn);
-                  if (cf_err == PMA_MSQL::Error::SUCCESS) {
-                    PMA_Println("Requested challenge from {}:{} -> {}",
-                                data->addr_port_info.client_addr,
-                                data->addr_port_info.remote_port,
-                                data->addr_port_info.local_port);
-                    body = JS_FACTORS_WORKER;
-                    PMA_HELPER::str_replace_all(body, "{API_URL}",
-                                                data->args->api_url);
-                    PMA_HELPER::str_replace_all(body, "{LARGE_NUMBER}", chall);
-                    PMA_HELPER::str_replace_all(body, "{UUID}", hashed_id);
-                    content_type = "Content-type: text/javascript";
-                  } else {
-                    if (PMA_MSQL::error_is_client_err(cf_err)) {
-                      status = "HTTP/1.0 400 Bad Request";
-                      body =
-                          "<html><p>400 Bad Request</p><p>(Failed setup "
-                          "challenge)</p></html>";
-                    } else {
-                      status = "HTTP/1.0 500 Internal Server Error";
-                      body =
-                          "<html><p>500 Internal Server Error</p><p>Failed "
-                          "to set up challenge</p></html>";
-                    }
-                  }
-                } else {
-                  if (PMA_MSQL::error_is_client_err(itp_err)) {
-                    PMA_EPrintln(
-                        "WARNING: Bad request from client {}:{} -> {} due to "
-                        "{}",
-                        data->addr_port_info.client_addr,
-                        data->addr_port_info.remote_port,
-                        data->addr_port_info.local_port,
-                        PMA_MSQL::error_to_str(itp_err));
-                    status = "HTTP/1.0 400 Bad Request";
-                    body = "<html><p>400 Bad Request</p><p>(No id)</p></html>";
-                  } else {
-                    PMA_EPrintln(
-                        "WARNING: handling client {}:{} -> {} due to {}",
-                        data->addr_port_info.client_addr,
-                        data->addr_port_info.remote_port,
-                        data->addr_port_info.local_port,
-                        PMA_MSQL::error_to_str(itp_err));
-                    status = "HTTP/1.0 500 Internal Server Error";
-                    body =
-                        "<html><p>500 Internal Server Error</p><p>Failed to "
-                        "set up challenge</p></html>";
-                  }
-                }
-              }
-            } else {
-              PMA_SQL::cleanup_stale_challenges(sqliteCtx,
-                                                data->args->challenge_timeout);
-              const auto [err, msg_or_chal, answ, id] =
-                  PMA_SQL::generate_challenge(sqliteCtx, data->args->factors,
-                                              data->addr_port_info.client_addr,
-                                              id_iter->second,
-                                              internal_blake3_hash_fn);
-              if (err != PMA_SQL::ErrorT::SUCCESS) {
-                PMA_EPrintln(
-                    "ERROR: Failed to prepare challenge for client {}: {}, "
-                    "{}",
-                    data->addr_port_info.client_addr,
-                    PMA_SQL::error_t_to_string(err), msg_or_chal);
-                status = "HTTP/1.0 500 Internal Server Error";
-                body =
-                    "<html><p>500 Internal Server Error</p><p>Failed to "
-                    "prepare challenge</p></html>";
-              } else {
-                PMA_Println("Requested challenge from {}:{} -> {}",
-                            data->addr_port_info.client_addr,
-                            data->addr_port_info.remote_port,
-                            data->addr_port_info.local_port);
-                body = JS_FACTORS_WORKER;
-                PMA_HELPER::str_replace_all(body, "{API_URL}",
-                                            data->args->api_url);
-                PMA_HELPER::str_replace_all(body, "{LARGE_NUMBER}",
-                                            msg_or_chal);
-                PMA_HELPER::str_replace_all(body, "{UUID}", id);
-                content_type = "Content-type: text/javascript";
-              }
-            }
-          } else {
-            status = "HTTP/1.0 400 Bad Request";
-            body = "<html><p>400 Bad Request</p><p>(No id)</p></html>";
-          }
-        } else if (data->args->flags.test(4)) {
-          {
-            std::unique_lock<std::mutex> cached_allowed_lock(
-                *data->cached_allowed_mutex);
-            if (auto cached_iter = data->cached_allowed->find(
-                    std::format("{}:{}", data->addr_port_info.client_addr,
-                                data->addr_port_info.local_port));
-                cached_iter != data->cached_allowed->end()) {
-              if (time_now - cached_iter->second > CACHED_TIMEOUT_T) {
-                data->cached_allowed->erase(cached_iter);
-              } else {
-                cached_allowed_lock.unlock();
-                if (data->args->flags.test(5)) {
-                  do_curl_forwarding(data, req, forward_flags);
-                } else {
-                  do_ipv4_socket_forwarding(data, forward_flags, req);
-                }
-                goto PMA_RESPONSE_AFTER_SENDING;
-              }
+              resp_template = &js_factors_worker_template();
+              resp_gzip_template = &js_factors_worker_gzip_template();
+              resp_values = {data->args->api_url, msg_or_chal, id};
+              content_type = "Content-type: text/javascript";
             }
           }
+        } else {
+          status = "HTTP/1.1 400 Bad Request";
+          body = "<html><p>400 Bad Request</p><p>(No id)</p></html>";
+        }
+      } else if (!data->args->metrics_url.empty() &&
+                 req.url_or_err_msg == data->args->metrics_url) {
+        content_type = "Content-type: text/plain";
+        body = metrics_get().render();
+      } else if (data->args->flags.test(4)) {
+        if (data->cached_allowed->check(
+                std::format("{}:{}", data->addr_port_info.client_addr,
+                            data->addr_port_info.local_port),
+                time_now)) {
+          do_forwarding(data, req, forward_flags);
+          goto PMA_RESPONSE_AFTER_SENDING;
+        }
 
-          bool ping_ok = false;
-          if (!msql_conn_opt.has_value() || !msql_conn_opt->is_valid()) {
-            msql_conn_opt = PMA_MSQL::Connection::connect_msql(
-                (*data->msql_conf_opt)->addr, (*data->msql_conf_opt)->port,
-                (*data->msql_conf_opt)->user, (*data->msql_conf_opt)->pass,
-                (*data->msql_conf_opt)->db);
-            if (!msql_conn_opt.has_value() || !msql_conn_opt->ping_check()) {
-              PMA_EPrintln("ERROR: Thread failed to connect with MSQL server!");
-              status = "HTTP/1.0 500 Internal Server Error";
-              body =
-                  "<html><p>500 Internal Server Error</p><p>Problem with "
-                  "DB</p></html>";
-            } else {
-              ping_ok = true;
-            }
+        bool ping_ok = false;
+        if (!msql_conn_opt.has_value() || !msql_conn_opt->is_valid()) {
+          msql_conn_opt = data->msql_pool->checkout();
+          if (!msql_conn_opt.has_value()) {
+            PMA_EPrintln("ERROR: Thread failed to connect with MSQL server!");
+            status = "HTTP/1.1 500 Internal Server Error";
+            body =
+                "<html><p>500 Internal Server Error</p><p>Problem with "
+                "DB</p></html>";
           } else {
             ping_ok = true;
           }
+        } else {
+          ping_ok = true;
+        }
 
-          if (ping_ok) {
-            PMA_MSQL::Error is_allowed_e = PMA_MSQL::client_is_allowed(
-                msql_conn_opt.value(), data->addr_port_info.client_addr,
-                data->addr_port_info.local_port, data->args->allowed_timeout);
-            if (is_allowed_e == PMA_MSQL::Error::SUCCESS) {
-              std::unique_lock<std::mutex> cached_allowed_lock(
-                  *data->cached_allowed_mutex);
-              data->cached_allowed->insert(std::make_pair(
-                  std::format("{}:{}", data->addr_port_info.client_addr,
-                              data->addr_port_info.local_port),
-                  time_now));
-              cached_allowed_lock.unlock();
-              if (data->args->flags.test(5)) {
-                do_curl_forwarding(data, req, forward_flags);
-              } else {
-                do_ipv4_socket_forwarding(data, forward_flags, req);
-              }
-              goto PMA_RESPONSE_AFTER_SENDING;
-            } else if (is_allowed_e == PMA_MSQL::Error::EMPTY_QUERY_RESULT) {
-              const auto [err, id] = PMA_MSQL::init_id_to_port(
-                  msql_conn_opt.value(), data->addr_port_info.local_port,
-                  data->args->challenge_timeout, internal_blake3_hash_fn);
-              if (err == PMA_MSQL::Error::SUCCESS) {
-                body = HTML_BODY_FACTORS;
-                PMA_HELPER::str_replace_all(
-                    body, "{JS_FACTORS_URL}",
-                    std::format("{}?id={}", data->args->js_factors_url, id));
-              } else {
-                PMA_EPrintln(
-                    "ERROR: Failed to init id-to-port for client {}! {}",
-                    data->addr_port_info.client_addr,
-                    PMA_MSQL::error_to_str(err));
-                if (PMA_MSQL::error_is_client_err(err)) {
-                  status = "HTTP/1.0 400 Bad Request";
-                  body = "<html><p>400 Bad Request</p></html>";
-                } else {
-                  status = "HTTP/1.0 500 Internal Server Error";
-                  body =
-                      "<html><p>500 Internal Server Error</p><p>Failed "
-                      "prepare for client</p></html>";
-                }
-              }
+        if (ping_ok) {
+          PMA_MSQL::Error is_allowed_e = PMA_MSQL::client_is_allowed(
+              msql_conn_opt.value(), data->addr_port_info.client_addr,
+              data->addr_port_info.local_port, data->args->allowed_timeout);
+          if (is_allowed_e == PMA_MSQL::Error::SUCCESS) {
+            data->cached_allowed->insert(
+                std::format("{}:{}", data->addr_port_info.client_addr,
+                            data->addr_port_info.local_port),
+                time_now);
+            do_forwarding(data, req, forward_flags);
+            goto PMA_RESPONSE_AFTER_SENDING;
+          } else if (is_allowed_e == PMA_MSQL::Error::EMPTY_QUERY_RESULT) {
+            const auto [err, id] = PMA_MSQL::init_id_to_port(
+                msql_conn_opt.value(), data->addr_port_info.local_port,
+                data->args->challenge_timeout, internal_blake3_hash_fn);
+            if (err == PMA_MSQL::Error::SUCCESS) {
+              resp_template = &html_body_factors_template();
+              resp_gzip_template = &html_body_factors_gzip_template();
+              resp_values = {
+                  std::format("{}?id={}", data->args->js_factors_url, id)};
             } else {
-              PMA_EPrintln("ERROR: Failed to check if client {} is allowed: {}",
-                           data->addr_port_info.client_addr,
-                           PMA_MSQL::error_to_str(is_allowed_e));
-              if (PMA_MSQL::error_is_client_err(is_allowed_e)) {
-                status = "HTTP/1.0 400 Bad Request";
+              PMA_EPrintln(
+                  "ERROR: Failed to init id-to-port for client {}! {}",
+                  data->addr_port_info.client_addr,
+                  PMA_MSQL::error_to_str(err));
+              if (PMA_MSQL::error_is_client_err(err)) {
+                status = "HTTP/1.1 400 Bad Request";
                 body = "<html><p>400 Bad Request</p></html>";
               } else {
-                status = "HTTP/1.0 500 Internal Server Error";
+                status = "HTTP/1.1 500 Internal Server Error";
                 body =
-                    "<html><p>500 Internal Server Error</p><p>Failed to "
-                    "check client</p></html>";
+                    "<html><p>500 Internal Server Error</p><p>Failed "
+                    "prepare for client</p></html>";
               }
             }
-          }
-        } else {
-          {
-            std::unique_lock<std::mutex> cached_allowed_lock(
-                *data->cached_allowed_mutex);
-            if (auto cached_iter = data->cached_allowed->find(
-                    std::format("{}:{}", data->addr_port_info.client_addr,
-                                data->addr_port_info.local_port));
-                cached_iter != data->cached_allowed->end()) {
-              if (time_now - cached_iter->second > CACHED_TIMEOUT_T) {
-                data->cached_allowed->erase(cached_iter);
-              } else {
-                cached_allowed_lock.unlock();
-                if (data->args->flags.test(5)) {
-                  do_curl_forwarding(data, req, forward_flags);
-                } else {
-                  do_ipv4_socket_forwarding(data, forward_flags, req);
-                }
-                goto PMA_RESPONSE_AFTER_SENDING;
-              }
-            }
-          }
-
-          PMA_SQL::cleanup_stale_entries(sqliteCtx,
-                                         data->args->allowed_timeout);
-
-          const auto [err, msg, is_allowed] = PMA_SQL::is_allowed_ip_port(
-              sqliteCtx, data->addr_port_info.client_addr,
-              data->addr_port_info.local_port);
-          if (err != PMA_SQL::ErrorT::SUCCESS || !is_allowed) {
-            PMA_SQL::cleanup_stale_id_to_ports(sqliteCtx,
-                                               data->args->challenge_timeout);
-            const auto [err, msg, id] = PMA_SQL::init_id_to_port(
-                sqliteCtx, data->addr_port_info.local_port,
-                internal_blake3_hash_fn);
-            body = HTML_BODY_FACTORS;
-            PMA_HELPER::str_replace_all(
-                body, "{JS_FACTORS_URL}",
-                std::format("{}?id={}", data->args->js_factors_url, id));
           } else {
-            std::unique_lock<std::mutex> cached_allowed_lock(
-                *data->cached_allowed_mutex);
-            data->cached_allowed->insert(std::make_pair(
-                std::format("{}:{}", data->addr_port_info.client_addr,
-                            data->addr_port_info.local_port),
-                time_now));
-            cached_allowed_lock.unlock();
-            if (data->args->flags.test(5)) {
-              do_curl_forwarding(data, req, forward_flags);
+            PMA_EPrintln("ERROR: Failed to check if client {} is allowed: {}",
+                         data->addr_port_info.client_addr,
+                         PMA_MSQL::error_to_str(is_allowed_e));
+            if (PMA_MSQL::error_is_client_err(is_allowed_e)) {
+              status = "HTTP/1.1 400 Bad Request";
+              body = "<html><p>400 Bad Request</p></html>";
             } else {
-              do_ipv4_socket_forwarding(data, forward_flags, req);
+              status = "HTTP/1.1 500 Internal Server Error";
+              body =
+                  "<html><p>500 Internal Server Error</p><p>Failed to "
+                  "check client</p></html>";
             }
-            goto PMA_RESPONSE_AFTER_SENDING;
           }
         }
+      } else {
+        if (data->cached_allowed->check(
+                std::format("{}:{}", data->addr_port_info.client_addr,
+                            data->addr_port_info.local_port),
+                time_now)) {
+          do_forwarding(data, req, forward_flags);
+          goto PMA_RESPONSE_AFTER_SENDING;
+        }
 
-      PMA_RESPONSE_AFTER_SENDING:
-        if (!forward_flags.test(2)) {
-          std::string full;
-          if (forward_flags.test(0) && !data->args->flags.test(5)) {
-            std::string ending;
-            if (!body.ends_with("0\r\n\r\n")) {
-              ending = "0\r\n\r\n";
-            }
-            full = std::format("{}\r\n{}\r\n\r\n{}{}", status, content_type,
-                               body, ending);
+        const auto [err, msg, is_allowed] = PMA_SQL::is_allowed_ip_port(
+            sqliteCtx, data->addr_port_info.client_addr,
+            data->addr_port_info.local_port);
+        if (err != PMA_SQL::ErrorT::SUCCESS || !is_allowed) {
+          const auto [err, msg, id] = PMA_SQL::init_id_to_port(
+              sqliteCtx, data->addr_port_info.local_port,
+              internal_blake3_hash_fn);
+          resp_template = &html_body_factors_template();
+          resp_gzip_template = &html_body_factors_gzip_template();
+          resp_values = {
+              std::format("{}?id={}", data->args->js_factors_url, id)};
+        } else {
+          data->cached_allowed->insert(
+              std::format("{}:{}", data->addr_port_info.client_addr,
+                          data->addr_port_info.local_port),
+              time_now);
+          do_forwarding(data, req, forward_flags);
+          goto PMA_RESPONSE_AFTER_SENDING;
+        }
+      }
+
+    PMA_RESPONSE_AFTER_SENDING:
+      if (!forward_flags.test(2) && resp_template != nullptr) {
+        // One writev over the precompiled segments and the per-request
+        // values; the page is never copied on the happy path.
+        const std::vector<std::string_view> values(resp_values.begin(),
+                                                   resp_values.end());
+        const bool use_gzip = accept_gzip && resp_gzip_template != nullptr;
+        const size_t body_size = use_gzip ? resp_gzip_template->size(values)
+                                          : resp_template->size(values);
+        const std::string header = std::format(
+            "{}\r\n{}\r\n{}Content-Length: {}\r\nConnection: {}\r\n\r\n",
+            status, content_type,
+            use_gzip ? "Content-Encoding: gzip\r\n" : "", body_size,
+            keep_alive ? "keep-alive" : "close");
+        std::string gzip_scratch;
+        std::vector<struct iovec> iovecs;
+        iovecs.push_back(
+            iovec{const_cast<char *>(header.data()), header.size()});
+        if (use_gzip) {
+          resp_gzip_template->fill_iovecs(values, iovecs, gzip_scratch);
+        } else {
+          resp_template->fill_iovecs(values, iovecs);
+        }
+        const size_t total = header.size() + body_size;
+        ssize_t write_ret = writev(data->conn_fd, iovecs.data(),
+                                   static_cast<int>(iovecs.size()));
+        if (write_ret != static_cast<ssize_t>(total)) {
+          if (write_ret > 0) {
+            // Partial write: materialize the remainder for later flushing.
+            data->addr_port_info.remaining_buffer =
+                (header + (use_gzip ? resp_gzip_template->to_string(values)
+                                    : resp_template->to_string(values)))
+                    .substr(static_cast<size_t>(write_ret));
+            return EventWorkers::StepResult::KEEP_WRITABLE;
           } else {
-            full = std::format("{}\r\n{}\r\nContent-Length: {}\r\n\r\n{}",
-                               status, content_type, body.size(), body);
+            PMA_EPrintln(
+                "ERROR: Failed to send response to client {} (write_ret {})!",
+                data->addr_port_info.client_addr, write_ret);
+            return EventWorkers::StepResult::CLOSE;
           }
-          ssize_t write_ret = write(data->conn_fd, full.data(), full.size());
-          if (write_ret != static_cast<ssize_t>(full.size())) {
-            if (write_ret > 0) {
-              data->addr_port_info.remaining_buffer =
-                  full.substr(static_cast<size_t>(write_ret));
-            } else {
-              PMA_EPrintln(
-                  "ERROR: Failed to send response to client {} (write_ret {})!",
-                  data->addr_port_info.client_addr, write_ret);
-              break;
-            }
-          } else if (write_ret == -1) {
-            PMA_EPrintln("ERROR: Failed to write to client {}, errno {}!",
-                         data->addr_port_info.client_addr, errno);
-            break;
+        }
+      } else if (!forward_flags.test(2)) {
+        std::string full;
+        if (forward_flags.test(0) && !data->args->flags.test(5)) {
+          std::string ending;
+          if (!body.ends_with("0\r\n\r\n")) {
+            ending = "0\r\n\r\n";
+          }
+          full = std::format("{}\r\n{}\r\nConnection: {}\r\n\r\n{}{}", status,
+                             content_type, keep_alive ? "keep-alive" : "close",
+                             body, ending);
+        } else {
+          full = std::format(
+              "{}\r\n{}\r\nContent-Length: {}\r\nConnection: {}\r\n\r\n{}",
+              status, content_type, body.size(),
+              keep_alive ? "keep-alive" : "close", body);
+        }
+        ssize_t write_ret = write(data->conn_fd, full.data(), full.size());
+        if (write_ret != static_cast<ssize_t>(full.size())) {
+          if (write_ret > 0) {
+            data->addr_port_info.remaining_buffer =
+                full.substr(static_cast<size_t>(write_ret));
+            return EventWorkers::StepResult::KEEP_WRITABLE;
           } else {
-            // Success
-            // PMA_EPrintln("NOTICE: Connection closed due to success! {}: {}",
-            //             data->dest_conn_fd, req.full_url);
+            PMA_EPrintln(
+                "ERROR: Failed to send response to client {} (write_ret {})!",
+                data->addr_port_info.client_addr, write_ret);
+            return EventWorkers::StepResult::CLOSE;
           }
+        } else if (write_ret == -1) {
+          PMA_EPrintln("ERROR: Failed to write to client {}, errno {}!",
+                       data->addr_port_info.client_addr, errno);
+          return EventWorkers::StepResult::CLOSE;
+        } else {
+          // Success
+          // PMA_EPrintln("NOTICE: Connection closed due to success! {}: {}",
+          //             data->dest_conn_fd, req.full_url);
         }
-      } else {
-        PMA_EPrintln("ERROR {}: {}", PMA_HTTP::error_t_to_str(req.error_enum),
-                     req.url_or_err_msg);
-        break;
       }
-    } else if (read_ret == 0) {
+
+      if (!forward_flags.test(2) && !keep_alive) {
+        // Response fully sent and keep-alive is off for this connection.
+        return EventWorkers::StepResult::CLOSE;
+      }
+    } else {
+      PMA_EPrintln("ERROR {}: {}", PMA_HTTP::error_t_to_str(req.error_enum),
+                   req.url_or_err_msg);
+      return EventWorkers::StepResult::CLOSE;
+    }
+  } else if (read_ret == 0) {
 #ifndef NDEBUG
-      PMA_Println("EOF From client {}:{} -> {}, closing...",
-                  data->addr_port_info.client_addr,
-                  data->addr_port_info.remote_port,
-                  data->addr_port_info.local_port);
+    PMA_Println("EOF From client {}:{} -> {}, closing...",
+                data->addr_port_info.client_addr,
+                data->addr_port_info.remote_port,
+                data->addr_port_info.local_port);
 #endif
-      break;
+    return EventWorkers::StepResult::CLOSE;
+  }
+
+  return EventWorkers::StepResult::KEEP;
+}
+
+EventWorkers::StepResult event_handle_connection_fn(void *ud) {
+  return handle_connection_step(reinterpret_cast<ThreadData *>(ud));
+}
+
+void thread_handle_connection_fn(void *ud) {
+  ThreadData *data = reinterpret_cast<ThreadData *>(ud);
+
+  while (data->addr_port_info.ticks < THREAD_TIMEOUT_TICKS) {
+    std::this_thread::sleep_for(SLEEP_MILLISECONDS_CHRONO);
+    data->addr_port_info.ticks += 1;
+
+    if (handle_connection_step(data) == EventWorkers::StepResult::CLOSE) {
+      return;
     }
-  }  // while ticks < timeout ticks
+  }
 
-  if (data->addr_port_info.ticks >= THREAD_TIMEOUT_TICKS) {
 #ifndef NDEBUG
+  if (data->addr_port_info.ticks >= THREAD_TIMEOUT_TICKS) {
     PMA_Println("Timed out connection from {}:{} on port {}",
                 data->addr_port_info.client_addr,
                 data->addr_port_info.remote_port,
                 data->addr_port_info.local_port);
-#endif
   }
+#endif
 }
 
 void thread_cleanup_fn(void *ud) {
   ThreadData *data = reinterpret_cast<ThreadData *>(ud);
+  if (data->msql_conn_opt.has_value() && data->msql_pool) {
+    data->msql_pool->checkin(std::move(data->msql_conn_opt.value()));
+  }
   if (data->conn_fd > 0) {
     close(data->conn_fd);
   }
   if (data->dest_conn_fd > 0) {
-    close(data->dest_conn_fd);
+    // Keep the origin connection warm for the next forward to the same
+    // destination.
+    backend_pool_get().release(data->dest_conn_key, data->dest_conn_fd,
+                               std::chrono::steady_clock::now());
+    data->dest_conn_fd = -1;
   }
-  delete data;
+  metrics_get().connection_ended();
+  thread_data_release(data);
+}
+
+// Best-effort 503 for connections shed by the admission queue. The socket
+// is freshly accepted and nonblocking, so the single small write nearly
+// always completes; if it doesn't, the close alone signals the client.
+void reject_connection_fn(ThreadData *data) {
+  constexpr std::string_view resp =
+      "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: "
+      "close\r\n\r\n";
+  const ssize_t write_ret = write(data->conn_fd, resp.data(), resp.size());
+  (void)write_ret;
+  thread_cleanup_fn(data);
 }
 
 int main(int argc, char **argv) {
@@ -1886,6 +2428,48 @@ int main(int argc, char **argv) {
     PMA_MSQL::init_db(msql_conn_opt.value());
   }
 
+  // Pool of pre-authenticated msql connections shared by all connection
+  // handlers. Seeded with the startup connection used for init_db.
+  PMA_MSQL::ConnectionPool msql_pool;
+  if (args.flags.test(4)) {
+    msql_pool = PMA_MSQL::ConnectionPool(msql_conf_opt.value());
+    msql_pool.checkin(std::move(msql_conn_opt.value()));
+    msql_conn_opt.reset();
+  }
+
+  // Single long-lived sqlite ctx shared by all connection handlers. The db is
+  // opened in WAL mode and the ctx caches prepared statements internally.
+  PMA_SQL::SQLITECtx sqlite_ctx;
+  if (!args.flags.test(4)) {
+    PMA_SQL::ErrorT sql_err;
+    std::string sql_err_msg;
+    std::tie(sqlite_ctx, sql_err, sql_err_msg) =
+        PMA_SQL::init_sqlite(args.sqlite_path);
+    if (sql_err != PMA_SQL::ErrorT::SUCCESS) {
+      PMA_EPrintln("ERROR: Failed to initialize sqlite: {}, {}",
+                   PMA_SQL::error_t_to_string(sql_err), sql_err_msg);
+      return 9;
+    }
+
+    // Authoritative in-memory challenge table; challenge rows reach sqlite
+    // via write-behind only.
+    PMA_SQL::challenge_store_start(sqlite_ctx);
+
+    // Stale rows are expired off the request path in small batches.
+    PMA_SQL::cleanup_scheduler_start(sqlite_ctx, args.challenge_timeout,
+                                     args.allowed_timeout);
+  }
+  GenericCleanup<int> cleanup_scheduler(
+      0, [](int *) { PMA_SQL::cleanup_scheduler_stop(); });
+  GenericCleanup<int> cleanup_challenge_store(
+      0, [](int *) { PMA_SQL::challenge_store_stop(); });
+
+  // Background producer keeping pre-generated challenges so issuance on the
+  // request path is a pop instead of a full generation run.
+  challenge_pool_start(args.factors, CHALLENGE_POOL_CAPACITY);
+  GenericCleanup<int> cleanup_challenge_pool(0,
+                                             [](int *) { challenge_pool_stop(); });
+
   curl_global_init(CURL_GLOBAL_SSL);
 
   PMA_HELPER::MimeTypes mime_types{};
@@ -1902,37 +2486,49 @@ int main(int argc, char **argv) {
         }
       });
 
+  // With --accept-shards=N each addr/port gets N SO_REUSEPORT listeners so
+  // the kernel can spread incoming connections over the accept threads.
+  const bool reuse_port = args.accept_shards > 1;
   for (const PMA_ARGS::AddrPort &a : args.addr_ports) {
-    std::optional<int> socket_fd_opt;
-    bool is_ipv4;
-    const auto [err, msg_v6, socket_fd] =
-        PMA_HTTP::get_ipv6_socket_server(std::get<0>(a), std::get<1>(a));
-    if (err == PMA_HTTP::ErrorT::SUCCESS) {
-      socket_fd_opt = socket_fd;
-      is_ipv4 = false;
-    } else {
-      const auto [err, msg, socket_fd] =
-          PMA_HTTP::get_ipv4_socket_server(std::get<0>(a), std::get<1>(a));
+    for (uint32_t shard = 0; shard < args.accept_shards; ++shard) {
+      std::optional<int> socket_fd_opt;
+      bool is_ipv4;
+      const auto [err, msg_v6, socket_fd] = PMA_HTTP::get_ipv6_socket_server(
+          std::get<0>(a), std::get<1>(a), reuse_port);
       if (err == PMA_HTTP::ErrorT::SUCCESS) {
         socket_fd_opt = socket_fd;
-        is_ipv4 = true;
+        is_ipv4 = false;
       } else {
-        PMA_EPrintln(
-            "ERROR: Failed to get listening socket for addr \"{}\" on port "
-            "\"{}\" (ipv6: {}, ipv4: {})!",
-            std::get<0>(a), std::get<1>(a), msg_v6, msg);
-        return 1;
+        const auto [err, msg, socket_fd] = PMA_HTTP::get_ipv4_socket_server(
+            std::get<0>(a), std::get<1>(a), reuse_port);
+        if (err == PMA_HTTP::ErrorT::SUCCESS) {
+          socket_fd_opt = socket_fd;
+          is_ipv4 = true;
+        } else {
+          PMA_EPrintln(
+              "ERROR: Failed to get listening socket for addr \"{}\" on port "
+              "\"{}\" (ipv6: {}, ipv4: {})!",
+              std::get<0>(a), std::get<1>(a), msg_v6, msg);
+          return 1;
+        }
       }
-    }
 
-    if (socket_fd_opt.has_value() && socket_fd_opt.value() >= 0) {
-      sockets.emplace(socket_fd_opt.value(), conv_addr_port(a, is_ipv4));
-      PMA_Println("Listening on {}:{}", std::get<0>(a), std::get<1>(a));
-    } else {
-      PMA_EPrintln(
-          "ERROR: Invalid internal state with addr \"{}\" and port \"{}\"!",
-          std::get<0>(a), std::get<1>(a));
-      return 2;
+      if (socket_fd_opt.has_value() && socket_fd_opt.value() >= 0) {
+        sockets.emplace(socket_fd_opt.value(), conv_addr_port(a, is_ipv4));
+        if (shard == 0) {
+          if (reuse_port) {
+            PMA_Println("Listening on {}:{} ({} shards)", std::get<0>(a),
+                        std::get<1>(a), args.accept_shards);
+          } else {
+            PMA_Println("Listening on {}:{}", std::get<0>(a), std::get<1>(a));
+          }
+        }
+      } else {
+        PMA_EPrintln(
+            "ERROR: Invalid internal state with addr \"{}\" and port \"{}\"!",
+            std::get<0>(a), std::get<1>(a));
+        return 2;
+      }
     }
   }
 
@@ -1943,8 +2539,19 @@ int main(int argc, char **argv) {
 
   std::optional<ThreadPool> thread_pool;
   std::optional<ThreadLimit> thread_limit;
+  std::optional<EventWorkers> event_workers;
 
-  if (args.flags.test(6)) {
+  if (args.flags.test(9)) {
+    if (args.thread_count.has_value()) {
+      event_workers = EventWorkers(args.thread_count.value());
+      PMA_Println("NOTE: Using event workers with {} threads",
+                  args.thread_count.value());
+    } else {
+      event_workers = EventWorkers(DEFAULT_THREAD_COUNT);
+      PMA_Println("NOTE: Using event workers with default {} threads",
+                  DEFAULT_THREAD_COUNT);
+    }
+  } else if (args.flags.test(6)) {
     if (args.thread_count.has_value()) {
       thread_limit = ThreadLimit(args.thread_count.value());
       PMA_Println("NOTE: Set thread limit to {}", args.thread_count.value());
@@ -1963,164 +2570,354 @@ int main(int argc, char **argv) {
     }
   }
 
+  if (thread_pool.has_value()) {
+    metrics_get().set_queue_depth_fn(
+        [&thread_pool]() { return thread_pool->pending_count(); });
+  } else if (thread_limit.has_value()) {
+    metrics_get().set_limiter_stats_fn([&thread_limit]() {
+      return std::array<uint64_t, 3>{thread_limit->queued_count(),
+                                     thread_limit->active_count(),
+                                     thread_limit->rejected_count()};
+    });
+  }
+
   PMA_HELPER::set_signal_handler(SIGINT, receive_signal);
   PMA_HELPER::set_signal_handler(SIGHUP, receive_signal);
   PMA_HELPER::set_signal_handler(SIGTERM, receive_signal);
 
   PMA_HELPER::set_signal_handler(SIGPIPE, ignore_sigpipe);
 
-  struct sockaddr_in sain4;
-  std::memset(&sain4, 0, sizeof(struct sockaddr_in));
-  struct sockaddr_in6 sain6;
-  std::memset(&sain6, 0, sizeof(struct sockaddr_in6));
-  socklen_t sain_len;
-
   // std::deque<int> to_remove_connections;
   // std::array<char, REQ_READ_BUF_SIZE> buf;
 
-  std::mutex cached_allowed_mutex;
-  std::unordered_map<std::string,
-                     std::chrono::time_point<std::chrono::steady_clock> >
-      cached_allowed;
+  TTLCache cached_allowed(CACHED_TIMEOUT_T, CACHED_ALLOWED_SHARD_COUNT);
+
+  // Clients verified on a peer instance go straight into the allowed cache
+  // so they skip the challenge here too.
+  if (args.flags.test(11)) {
+    if (!peer_sync_start(
+            args.peer_listen.value(), args.peers,
+            [&cached_allowed](const std::string &ip, uint16_t port) {
+              cached_allowed.insert(std::format("{}:{}", ip, port),
+                                    std::chrono::steady_clock::now());
+            })) {
+      PMA_EPrintln("ERROR: Failed to start peer sync!");
+      return 1;
+    }
+    PMA_Println("Peer sync listening on {}:{} ({} peers)",
+                std::get<0>(args.peer_listen.value()),
+                std::get<1>(args.peer_listen.value()), args.peers.size());
+  }
+  GenericCleanup<int> cleanup_peer_sync(0, [](int *) { peer_sync_stop(); });
+
   std::chrono::time_point<std::chrono::steady_clock> time_now =
       std::chrono::steady_clock::now();
   std::chrono::time_point<std::chrono::steady_clock> time_prev = time_now;
 
-  int ret;
-  while (!interrupt_received) {
-    std::this_thread::sleep_for(SLEEP_MILLISECONDS_CHRONO);
-    time_now = std::chrono::steady_clock::now();
-    if (time_now - time_prev > CACHED_CLEAR_T) {
-      time_prev = time_now;
-      std::unique_lock<std::mutex> cached_allowed_lock(cached_allowed_mutex);
-      cached_allowed.clear();
-    }
+  // Accepts pending connections on a single listening socket until the
+  // nonblocking accept() reports EAGAIN/EWOULDBLOCK. Safe to call from
+  // multiple accept threads; all shared state below is locked or atomic.
+  const auto accept_conns_fn = [&](int listen_fd,
+                                   const AddrPortInfo &addr_port_info) {
+    struct sockaddr_in sain4;
+    std::memset(&sain4, 0, sizeof(struct sockaddr_in));
+    struct sockaddr_in6 sain6;
+    std::memset(&sain6, 0, sizeof(struct sockaddr_in6));
+    socklen_t sain_len;
+    int ret = 0;
+    while (ret >= 0) {
+      if (addr_port_info.flags.test(0)) {
+        // IPV4
+        sain_len = sizeof(struct sockaddr_in);
+        ret =
+            accept(listen_fd, reinterpret_cast<sockaddr *>(&sain4), &sain_len);
+
+        if (sain_len != sizeof(struct sockaddr_in)) {
+          PMA_EPrintln("WARNING: sockaddr return length {}, but should be {}",
+                       sain_len, sizeof(struct sockaddr_in));
+        }
+      } else {
+        // IPV6
+        sain_len = sizeof(struct sockaddr_in6);
+        ret =
+            accept(listen_fd, reinterpret_cast<sockaddr *>(&sain6), &sain_len);
+
+        if (sain_len != sizeof(struct sockaddr_in6)) {
+          PMA_EPrintln("WARNING: sockaddr return length {}, but should be {}",
+                       sain_len, sizeof(struct sockaddr_in6));
+        }
+      }
 
-    // Fetch new connections
-    for (auto iter = sockets.begin(); iter != sockets.end(); ++iter) {
-      ret = 0;
-      while (ret >= 0) {
-        if (iter->second.flags.test(0)) {
-          // IPV4
-          sain_len = sizeof(struct sockaddr_in);
-          ret = accept(iter->first, reinterpret_cast<sockaddr *>(&sain4),
-                       &sain_len);
-
-          if (sain_len != sizeof(struct sockaddr_in)) {
-            PMA_EPrintln("WARNING: sockaddr return length {}, but should be {}",
-                         sain_len, sizeof(struct sockaddr_in));
-          }
+      if (ret == -1) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          // Nonblocking-IO indicating no connection to accept
         } else {
-          // IPV6
-          sain_len = sizeof(struct sockaddr_in6);
-          ret = accept(iter->first, reinterpret_cast<sockaddr *>(&sain6),
-                       &sain_len);
-
-          if (sain_len != sizeof(struct sockaddr_in6)) {
-            PMA_EPrintln("WARNING: sockaddr return length {}, but should be {}",
-                         sain_len, sizeof(struct sockaddr_in6));
-          }
+          PMA_EPrintln(
+              "WARNING: Failed to accept connection from socket {} (errno "
+              "{})",
+              listen_fd, errno);
         }
-
-        if (ret == -1) {
-          if (errno == EAGAIN || errno == EWOULDBLOCK) {
-            // Nonblocking-IO indicating no connection to accept
-          } else {
-            PMA_EPrintln(
-                "WARNING: Failed to accept connection from socket {} (errno "
-                "{})",
-                iter->first, errno);
-          }
-        } else if (iter->second.flags.test(0)) {
-          // IPV4 new connection
-          std::string client_ipv4 =
-              PMA_HTTP::ipv4_addr_to_str(sain4.sin_addr.s_addr);
+      } else if (addr_port_info.flags.test(0)) {
+        // IPV4 new connection
+        std::string client_ipv4 =
+            PMA_HTTP::ipv4_addr_to_str(sain4.sin_addr.s_addr);
 #ifndef NDEBUG
-          PMA_Println("New connection from {}:{} on port {}", client_ipv4,
-                      PMA_HELPER::be_swap_u16(sain4.sin_port),
-                      iter->second.local_port);
+        PMA_Println("New connection from {}:{} on port {}", client_ipv4,
+                    PMA_HELPER::be_swap_u16(sain4.sin_port),
+                    addr_port_info.local_port);
 #endif
 
-          // Set nonblocking-IO on received connection fd
-          int fcntl_ret = fcntl(ret, F_SETFL, O_NONBLOCK);
-          if (fcntl_ret < 0) {
-            PMA_EPrintln(
-                "WARNING: Failed to set NONBLOCK on new connection (errno {}), "
-                "closing connection...",
-                errno);
-            close(ret);
-            continue;
-          }
+        // Set nonblocking-IO on received connection fd
+        int fcntl_ret = fcntl(ret, F_SETFL, O_NONBLOCK);
+        if (fcntl_ret < 0) {
+          PMA_EPrintln(
+              "WARNING: Failed to set NONBLOCK on new connection (errno {}), "
+              "closing connection...",
+              errno);
+          close(ret);
+          continue;
+        }
 
-          ThreadData *new_data = new ThreadData;
-          new_data->addr_port_info = iter->second;
-          new_data->addr_port_info.client_addr = client_ipv4;
-          new_data->addr_port_info.immediate_client_addr =
-              std::move(client_ipv4);
-          new_data->addr_port_info.remote_port =
-              PMA_HELPER::be_swap_u16(sain4.sin_port);
-          new_data->args = &args;
-          new_data->msql_conf_opt = &msql_conf_opt;
-          new_data->cached_allowed_mutex = &cached_allowed_mutex;
-          new_data->cached_allowed = &cached_allowed;
-          new_data->conn_fd = ret;
-          new_data->dest_conn_fd = -1;
-
-          if (args.flags.test(6)) {
-            thread_limit->add_thread(thread_handle_connection_fn, new_data,
-                                     thread_cleanup_fn);
-          } else {
-            thread_pool->add_func(thread_handle_connection_fn, new_data,
-                                  thread_cleanup_fn);
+        ThreadData *new_data = thread_data_acquire();
+        new_data->addr_port_info = addr_port_info;
+        new_data->addr_port_info.client_addr = client_ipv4;
+        new_data->addr_port_info.immediate_client_addr = std::move(client_ipv4);
+        new_data->addr_port_info.remote_port =
+            PMA_HELPER::be_swap_u16(sain4.sin_port);
+        new_data->sqlite_ctx = &sqlite_ctx;
+        new_data->args = &args;
+        new_data->msql_pool = &msql_pool;
+        new_data->cached_allowed = &cached_allowed;
+        new_data->conn_fd = ret;
+        new_data->dest_conn_fd = -1;
+        metrics_get().connection_started();
+
+        if (args.flags.test(9)) {
+          event_workers->add_connection(ret, event_handle_connection_fn,
+                                        new_data, thread_cleanup_fn);
+        } else if (args.flags.test(6)) {
+          if (!thread_limit->add_thread(thread_handle_connection_fn, new_data,
+                                        thread_cleanup_fn)) {
+            reject_connection_fn(new_data);
           }
         } else {
-          // IPV6 new connection
-          std::string client_ipv6 = PMA_HTTP::ipv6_addr_to_str(
-              *reinterpret_cast<std::array<uint8_t, 16> *>(
-                  sain6.sin6_addr.s6_addr));
+          thread_pool->add_func(thread_handle_connection_fn, new_data,
+                                thread_cleanup_fn);
+        }
+      } else {
+        // IPV6 new connection
+        std::string client_ipv6 =
+            PMA_HTTP::ipv6_addr_to_str(*reinterpret_cast<
+                                       std::array<uint8_t, 16> *>(
+                sain6.sin6_addr.s6_addr));
 #ifndef NDEBUG
-          PMA_Println("New connection from {}:{} on port {}", client_ipv6,
-                      PMA_HELPER::be_swap_u16(sain6.sin6_port),
-                      iter->second.local_port);
+        PMA_Println("New connection from {}:{} on port {}", client_ipv6,
+                    PMA_HELPER::be_swap_u16(sain6.sin6_port),
+                    addr_port_info.local_port);
 #endif
 
-          // Set nonblocking-IO on received connection fd
-          int fcntl_ret = fcntl(ret, F_SETFL, O_NONBLOCK);
-          if (fcntl_ret < 0) {
+        // Set nonblocking-IO on received connection fd
+        int fcntl_ret = fcntl(ret, F_SETFL, O_NONBLOCK);
+        if (fcntl_ret < 0) {
+          PMA_EPrintln(
+              "WARNING: Failed to set NONBLOCK on new connection (errno {}), "
+              "closing connection...",
+              errno);
+          close(ret);
+          continue;
+        }
+
+        ThreadData *new_data = thread_data_acquire();
+        new_data->addr_port_info = addr_port_info;
+        new_data->addr_port_info.client_addr = client_ipv6;
+        new_data->addr_port_info.immediate_client_addr = std::move(client_ipv6);
+        new_data->addr_port_info.remote_port =
+            PMA_HELPER::be_swap_u16(sain6.sin6_port);
+        new_data->sqlite_ctx = &sqlite_ctx;
+        new_data->args = &args;
+        new_data->msql_pool = &msql_pool;
+        new_data->cached_allowed = &cached_allowed;
+        new_data->conn_fd = ret;
+        new_data->dest_conn_fd = -1;
+        metrics_get().connection_started();
+
+        if (args.flags.test(9)) {
+          event_workers->add_connection(ret, event_handle_connection_fn,
+                                        new_data, thread_cleanup_fn);
+        } else if (args.flags.test(6)) {
+          if (!thread_limit->add_thread(thread_handle_connection_fn, new_data,
+                                        thread_cleanup_fn)) {
+            reject_connection_fn(new_data);
+          }
+        } else {
+          thread_pool->add_func(thread_handle_connection_fn, new_data,
+                                thread_cleanup_fn);
+        }
+      }
+    }  // while (ret >= 0)
+  };
+
+  // Incrementally expires cached_allowed entries: one shard is swept at a
+  // time, spaced so a full pass over all shards still completes once per
+  // CACHED_CLEAR_T, without the old full-clear lookup stampede.
+  const auto cached_clear_fn = [&]() {
+    time_now = std::chrono::steady_clock::now();
+    if (time_now - time_prev >
+        CACHED_CLEAR_T / cached_allowed.get_shard_count()) {
+      time_prev = time_now;
+      cached_allowed.prune_next_shard(time_now);
+      backend_pool_get().prune(time_now);
+    }
+  };
+
+  if (reuse_port) {
+    // One accept thread per SO_REUSEPORT listener. Each thread blocks on its
+    // own epoll fd (or sleep-polls with --disable-epoll) and hands accepted
+    // connections to the shared worker setup.
+    std::vector<std::thread> accept_threads;
+    for (auto iter = sockets.begin(); iter != sockets.end(); ++iter) {
+      accept_threads.emplace_back([&accept_conns_fn, &args,
+                                   listen_fd = iter->first,
+                                   info = &iter->second]() {
+        std::optional<int> shard_epoll_opt;
+        if (!args.flags.test(8)) {
+          int shard_epoll_fd = epoll_create1(0);
+          if (shard_epoll_fd < 0) {
             PMA_EPrintln(
-                "WARNING: Failed to set NONBLOCK on new connection (errno {}), "
-                "closing connection...",
+                "WARNING: Failed to create epoll instance for accept shard "
+                "(errno {}), falling back to sleep-poll!",
                 errno);
-            close(ret);
-            continue;
+          } else {
+            struct epoll_event event;
+            std::memset(&event, 0, sizeof(struct epoll_event));
+            event.events = EPOLLIN;
+            event.data.fd = listen_fd;
+            if (epoll_ctl(shard_epoll_fd, EPOLL_CTL_ADD, listen_fd, &event) !=
+                0) {
+              PMA_EPrintln(
+                  "WARNING: Failed to add listening socket {} to shard epoll "
+                  "(errno {}), falling back to sleep-poll!",
+                  listen_fd, errno);
+              close(shard_epoll_fd);
+            } else {
+              shard_epoll_opt = shard_epoll_fd;
+            }
           }
+        }
 
-          ThreadData *new_data = new ThreadData;
-          new_data->addr_port_info = iter->second;
-          new_data->addr_port_info.client_addr = client_ipv6;
-          new_data->addr_port_info.immediate_client_addr =
-              std::move(client_ipv6);
-          new_data->addr_port_info.remote_port =
-              PMA_HELPER::be_swap_u16(sain4.sin_port);
-          new_data->args = &args;
-          new_data->msql_conf_opt = &msql_conf_opt;
-          new_data->cached_allowed_mutex = &cached_allowed_mutex;
-          new_data->cached_allowed = &cached_allowed;
-          new_data->conn_fd = ret;
-          new_data->dest_conn_fd = -1;
-
-          if (args.flags.test(6)) {
-            thread_limit->add_thread(thread_handle_connection_fn, new_data,
-                                     thread_cleanup_fn);
+        while (!interrupt_received) {
+          if (shard_epoll_opt.has_value()) {
+            struct epoll_event event;
+            int event_count = epoll_wait(shard_epoll_opt.value(), &event, 1,
+                                         EPOLL_WAIT_TIMEOUT_MILLISECONDS);
+            if (event_count < 0 && errno != EINTR) {
+              PMA_EPrintln(
+                  "ERROR: epoll_wait failed on accept shard (errno {})!",
+                  errno);
+              break;
+            } else if (event_count > 0) {
+              accept_conns_fn(listen_fd, *info);
+            }
           } else {
-            thread_pool->add_func(thread_handle_connection_fn, new_data,
-                                  thread_cleanup_fn);
+            std::this_thread::sleep_for(SLEEP_MILLISECONDS_CHRONO);
+            accept_conns_fn(listen_fd, *info);
           }
         }
-      }  // while (ret >= 0)
-    }  // for (sockets ... )
 
-    std::cout << std::flush;
+        if (shard_epoll_opt.has_value()) {
+          close(shard_epoll_opt.value());
+        }
+      });
+    }
+
+    // Main thread only expires cached_allowed entries while the shard
+    // threads accept.
+    while (!interrupt_received) {
+      std::this_thread::sleep_for(SLEEP_MILLISECONDS_CHRONO);
+      cached_clear_fn();
+      std::cout << std::flush;
+    }
+
+    for (auto &accept_thread : accept_threads) {
+      accept_thread.join();
+    }
+
+    return 0;
+  }
+
+  std::optional<int> epoll_fd_opt;
+  if (!args.flags.test(8)) {
+    int epoll_fd = epoll_create1(0);
+    if (epoll_fd < 0) {
+      PMA_EPrintln(
+          "WARNING: Failed to create epoll instance (errno {}), falling back "
+          "to sleep-poll accept loop!",
+          errno);
+    } else {
+      epoll_fd_opt = epoll_fd;
+    }
+  }
+
+  if (epoll_fd_opt.has_value()) {
+    GenericCleanup<int> cleanup_epoll_fd(epoll_fd_opt.value(), [](int *fd) {
+      if (fd && *fd >= 0) {
+        close(*fd);
+      }
+    });
+
+    for (auto iter = sockets.begin(); iter != sockets.end(); ++iter) {
+      struct epoll_event event;
+      std::memset(&event, 0, sizeof(struct epoll_event));
+      event.events = EPOLLIN;
+      event.data.fd = iter->first;
+      if (epoll_ctl(epoll_fd_opt.value(), EPOLL_CTL_ADD, iter->first, &event) !=
+          0) {
+        PMA_EPrintln(
+            "ERROR: Failed to add listening socket {} to epoll (errno {})!",
+            iter->first, errno);
+        return 7;
+      }
+    }
+
+    std::array<struct epoll_event, EPOLL_MAX_EVENTS> events;
+    while (!interrupt_received) {
+      // Blocks until a listening socket is ready to accept. The timeout
+      // ensures cached_allowed is cleared periodically even when idle.
+      int event_count =
+          epoll_wait(epoll_fd_opt.value(), events.data(), EPOLL_MAX_EVENTS,
+                     EPOLL_WAIT_TIMEOUT_MILLISECONDS);
+      cached_clear_fn();
+
+      if (event_count < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        PMA_EPrintln("ERROR: epoll_wait failed (errno {})!", errno);
+        return 8;
+      }
+
+      for (int idx = 0; idx < event_count; ++idx) {
+        if (auto iter =
+                sockets.find(events.at(static_cast<size_t>(idx)).data.fd);
+            iter != sockets.end()) {
+          accept_conns_fn(iter->first, iter->second);
+        }
+      }
+
+      std::cout << std::flush;
+    }
+  } else {
+    while (!interrupt_received) {
+      std::this_thread::sleep_for(SLEEP_MILLISECONDS_CHRONO);
+      cached_clear_fn();
+
+      // Fetch new connections
+      for (auto iter = sockets.begin(); iter != sockets.end(); ++iter) {
+        accept_conns_fn(iter->first, iter->second);
+      }
+
+      std::cout << std::flush;
+    }
   }
 
   return 0;
@@ -0,0 +1,161 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "metrics.h"
+
+// Standard library includes
+#include <format>
+#include <utility>
+
+Metrics::Metrics() : active_connections(0) {
+  for (auto &hist : hists) {
+    for (auto &bucket : hist.buckets) {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+    hist.count.store(0, std::memory_order_relaxed);
+    hist.total_microseconds.store(0, std::memory_order_relaxed);
+  }
+}
+
+void Metrics::record(Stage stage, std::chrono::nanoseconds duration) {
+  const uint64_t microseconds = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+  StageHist &hist = hists.at(static_cast<size_t>(stage));
+
+  size_t bucket_idx = 0;
+  while (bucket_idx < BUCKET_BOUNDS_MICROSECONDS.size() &&
+         microseconds > BUCKET_BOUNDS_MICROSECONDS.at(bucket_idx)) {
+    ++bucket_idx;
+  }
+  hist.buckets.at(bucket_idx).fetch_add(1, std::memory_order_relaxed);
+  hist.count.fetch_add(1, std::memory_order_relaxed);
+  hist.total_microseconds.fetch_add(microseconds, std::memory_order_relaxed);
+}
+
+void Metrics::connection_started() {
+  active_connections.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Metrics::connection_ended() {
+  active_connections.fetch_sub(1, std::memory_order_relaxed);
+}
+
+uint64_t Metrics::active_connections_count() const {
+  return active_connections.load(std::memory_order_relaxed);
+}
+
+void Metrics::set_queue_depth_fn(std::function<size_t()> fn) {
+  queue_depth_fn = std::move(fn);
+}
+
+void Metrics::set_limiter_stats_fn(
+    std::function<std::array<uint64_t, 3>()> fn) {
+  limiter_stats_fn = std::move(fn);
+}
+
+std::string Metrics::render() const {
+  std::string out;
+
+  out.append(
+      "# HELP pma_active_connections Connections currently being handled.\n"
+      "# TYPE pma_active_connections gauge\n");
+  out.append(std::format("pma_active_connections {}\n",
+                         active_connections.load(std::memory_order_relaxed)));
+
+  if (queue_depth_fn) {
+    out.append(
+        "# HELP pma_thread_pool_queue_depth Queued connection handlers.\n"
+        "# TYPE pma_thread_pool_queue_depth gauge\n");
+    out.append(
+        std::format("pma_thread_pool_queue_depth {}\n", queue_depth_fn()));
+  }
+
+  if (limiter_stats_fn) {
+    const std::array<uint64_t, 3> stats = limiter_stats_fn();
+    out.append(
+        "# HELP pma_limiter_queued Connections queued for admission.\n"
+        "# TYPE pma_limiter_queued gauge\n");
+    out.append(std::format("pma_limiter_queued {}\n", stats.at(0)));
+    out.append(
+        "# HELP pma_limiter_active Connections admitted and running.\n"
+        "# TYPE pma_limiter_active gauge\n");
+    out.append(std::format("pma_limiter_active {}\n", stats.at(1)));
+    out.append(
+        "# HELP pma_limiter_rejected_total Connections rejected with 503.\n"
+        "# TYPE pma_limiter_rejected_total counter\n");
+    out.append(std::format("pma_limiter_rejected_total {}\n", stats.at(2)));
+  }
+
+  for (size_t stage_idx = 0;
+       stage_idx < static_cast<size_t>(Stage::STAGE_COUNT); ++stage_idx) {
+    const StageHist &hist = hists.at(stage_idx);
+    const char *name = stage_name(stage_idx);
+    out.append(std::format(
+        "# HELP pma_stage_{}_microseconds Latency of the {} stage.\n"
+        "# TYPE pma_stage_{}_microseconds histogram\n",
+        name, name, name));
+    uint64_t cumulative = 0;
+    for (size_t bucket_idx = 0; bucket_idx < BUCKET_COUNT; ++bucket_idx) {
+      cumulative +=
+          hist.buckets.at(bucket_idx).load(std::memory_order_relaxed);
+      if (bucket_idx < BUCKET_BOUNDS_MICROSECONDS.size()) {
+        out.append(std::format(
+            "pma_stage_{}_microseconds_bucket{{le=\"{}\"}} {}\n", name,
+            BUCKET_BOUNDS_MICROSECONDS.at(bucket_idx), cumulative));
+      } else {
+        out.append(
+            std::format("pma_stage_{}_microseconds_bucket{{le=\"+Inf\"}} {}\n",
+                        name, cumulative));
+      }
+    }
+    out.append(std::format(
+        "pma_stage_{}_microseconds_sum {}\n"
+        "pma_stage_{}_microseconds_count {}\n",
+        name, hist.total_microseconds.load(std::memory_order_relaxed), name,
+        hist.count.load(std::memory_order_relaxed)));
+  }
+
+  return out;
+}
+
+const char *Metrics::stage_name(size_t stage_idx) {
+  switch (static_cast<Stage>(stage_idx)) {
+    case Stage::PARSE:
+      return "parse";
+    case Stage::CHALLENGE_GENERATE:
+      return "challenge_generate";
+    case Stage::DB:
+      return "db";
+    case Stage::FORWARD:
+      return "forward";
+    default:
+      return "unknown";
+  }
+}
+
+MetricsTimer::MetricsTimer(Metrics::Stage stage)
+    : stage(stage), start(std::chrono::steady_clock::now()) {}
+
+MetricsTimer::~MetricsTimer() {
+  metrics_get().record(stage, std::chrono::duration_cast<
+                                  std::chrono::nanoseconds>(
+                                  std::chrono::steady_clock::now() - start));
+}
+
+Metrics &metrics_get() {
+  static Metrics internal_global_metrics{};
+  return internal_global_metrics;
+}
@@ -0,0 +1,107 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef SEODISPARATE_COM_POOR_MANS_ANUBIS_METRICS_H_
+#define SEODISPARATE_COM_POOR_MANS_ANUBIS_METRICS_H_
+
+// Standard library includes
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+/// Process-wide metrics: per-stage fixed-bucket latency histograms plus
+/// gauges for active connections and thread-pool queue depth. Recording is
+/// a few relaxed atomic increments, so it is safe to call from every
+/// connection handler; render() produces Prometheus text exposition format
+/// for the metrics endpoint.
+class Metrics {
+ public:
+  enum class Stage : size_t {
+    PARSE = 0,
+    CHALLENGE_GENERATE,
+    DB,
+    FORWARD,
+    STAGE_COUNT
+  };
+
+  /// Bucket upper bounds in microseconds; the last bucket is +Inf.
+  static constexpr std::array<uint64_t, 15> BUCKET_BOUNDS_MICROSECONDS = {
+      50,     100,    250,    500,     1000,    2500,    5000,   10000,
+      25000,  50000,  100000, 250000,  500000,  1000000, 5000000};
+  static constexpr size_t BUCKET_COUNT =
+      BUCKET_BOUNDS_MICROSECONDS.size() + 1;
+
+  Metrics();
+
+  // disallow copy
+  Metrics(const Metrics &) = delete;
+  Metrics &operator=(const Metrics &) = delete;
+
+  void record(Stage stage, std::chrono::nanoseconds duration);
+
+  void connection_started();
+  void connection_ended();
+
+  /// Current number of in-flight connections.
+  uint64_t active_connections_count() const;
+
+  /// The fn is sampled on render(); it must be safe to call from any thread.
+  void set_queue_depth_fn(std::function<size_t()> fn);
+
+  /// The fn is sampled on render(); it must be safe to call from any thread.
+  /// Values are the limiter's queued, active, and rejected counts.
+  void set_limiter_stats_fn(std::function<std::array<uint64_t, 3>()> fn);
+
+  std::string render() const;
+
+ private:
+  struct StageHist {
+    std::array<std::atomic_uint64_t, BUCKET_COUNT> buckets;
+    std::atomic_uint64_t count;
+    std::atomic_uint64_t total_microseconds;
+  };
+
+  static const char *stage_name(size_t stage_idx);
+
+  std::array<StageHist, static_cast<size_t>(Stage::STAGE_COUNT)> hists;
+  std::atomic_uint64_t active_connections;
+  std::function<size_t()> queue_depth_fn;
+  std::function<std::array<uint64_t, 3>()> limiter_stats_fn;
+};
+
+/// Records the duration of the enclosing scope into the process-wide
+/// Metrics on destruction.
+class MetricsTimer {
+ public:
+  MetricsTimer(Metrics::Stage stage);
+  ~MetricsTimer();
+
+  // disallow copy
+  MetricsTimer(const MetricsTimer &) = delete;
+  MetricsTimer &operator=(const MetricsTimer &) = delete;
+
+ private:
+  Metrics::Stage stage;
+  std::chrono::time_point<std::chrono::steady_clock> start;
+};
+
+Metrics &metrics_get();
+
+#endif
@@ -0,0 +1,302 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "peer_sync.h"
+
+// Standard library includes
+#include <array>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <optional>
+#include <utility>
+
+// Unix includes
+#include <netinet/in.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+// Local includes
+#include "helpers.h"
+#include "http.h"
+#include "poor_mans_print.h"
+
+// Datagram format: prefix, a space, the client ip (may contain colons), a
+// space, then the decimal local port.
+static const char *const PEER_SYNC_MSG_PREFIX = "PMA_ALLOW1 ";
+constexpr size_t PEER_SYNC_MSG_PREFIX_SIZE = 11;
+constexpr size_t PEER_SYNC_RECV_BUF_SIZE = 512;
+
+// Parses addr as ipv6 then ipv4 into a sockaddr with the given port.
+// Returns nullopt if addr is neither.
+static std::optional<std::tuple<struct sockaddr_storage, socklen_t> >
+internal_resolve_addr(const std::string &addr, uint16_t port) {
+  struct sockaddr_storage storage;
+  std::memset(&storage, 0, sizeof(struct sockaddr_storage));
+
+  try {
+    const auto [ipv6_addr, scope_id] = PMA_HTTP::str_to_ipv6_addr(addr);
+    struct sockaddr_in6 *sain6 =
+        reinterpret_cast<struct sockaddr_in6 *>(&storage);
+    sain6->sin6_family = AF_INET6;
+    sain6->sin6_port = PMA_HELPER::be_swap_u16(port);
+    std::memcpy(sain6->sin6_addr.s6_addr, ipv6_addr.data(), 16);
+    sain6->sin6_scope_id = scope_id;
+    return std::tuple<struct sockaddr_storage, socklen_t>{
+        storage, sizeof(struct sockaddr_in6)};
+  } catch (const std::exception &e) {
+    // Not ipv6; try ipv4 below.
+  }
+
+  try {
+    struct sockaddr_in *sain = reinterpret_cast<struct sockaddr_in *>(&storage);
+    sain->sin_family = AF_INET;
+    sain->sin_port = PMA_HELPER::be_swap_u16(port);
+    sain->sin_addr.s_addr = PMA_HTTP::str_to_ipv4_addr(addr);
+    return std::tuple<struct sockaddr_storage, socklen_t>{
+        storage, sizeof(struct sockaddr_in)};
+  } catch (const std::exception &e) {
+    return std::nullopt;
+  }
+}
+
+PeerSync::PeerSync()
+    : stop_var(),
+      peer_addrs(),
+      recv_fd(-1),
+      send_fd_ipv4(-1),
+      send_fd_ipv6(-1),
+      receiver_thread() {}
+
+PeerSync::PeerSync(const PMA_ARGS::AddrPort &listen_addr_port,
+                   std::deque<PMA_ARGS::AddrPort> peers, ApplyFn apply_fn)
+    : stop_var(std::make_shared<std::atomic_bool>(false)),
+      peer_addrs(),
+      recv_fd(-1),
+      send_fd_ipv4(-1),
+      send_fd_ipv6(-1),
+      receiver_thread() {
+  for (const PMA_ARGS::AddrPort &peer : peers) {
+    auto resolved_opt =
+        internal_resolve_addr(std::get<0>(peer), std::get<1>(peer));
+    if (!resolved_opt.has_value()) {
+      PMA_EPrintln("ERROR: Failed to parse peer addr \"{}\"!",
+                   std::get<0>(peer));
+      peer_addrs.clear();
+      return;
+    }
+    peer_addrs.push_back(PeerAddr{std::get<0>(resolved_opt.value()),
+                                  std::get<1>(resolved_opt.value())});
+  }
+
+  auto listen_resolved_opt = internal_resolve_addr(
+      std::get<0>(listen_addr_port), std::get<1>(listen_addr_port));
+  if (!listen_resolved_opt.has_value()) {
+    PMA_EPrintln("ERROR: Failed to parse peer-listen addr \"{}\"!",
+                 std::get<0>(listen_addr_port));
+    return;
+  }
+
+  const auto [listen_sockaddr, listen_sockaddr_len] =
+      listen_resolved_opt.value();
+  recv_fd = socket(listen_sockaddr.ss_family, SOCK_DGRAM, 0);
+  if (recv_fd == -1) {
+    PMA_EPrintln("ERROR: Failed to create peer-sync recv socket (errno {})!",
+                 errno);
+    return;
+  }
+
+  // Blocking recvfrom with a timeout so the receiver can notice stop_var.
+  {
+    struct timeval timeout;
+    timeout.tv_sec = 0;
+    timeout.tv_usec = 250000;
+    if (setsockopt(recv_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout,
+                   sizeof(timeout)) != 0) {
+      PMA_EPrintln("ERROR: Failed to set peer-sync recv timeout (errno {})!",
+                   errno);
+      close(recv_fd);
+      recv_fd = -1;
+      return;
+    }
+  }
+
+  if (bind(recv_fd, reinterpret_cast<const sockaddr *>(&listen_sockaddr),
+           listen_sockaddr_len) != 0) {
+    PMA_EPrintln("ERROR: Failed to bind peer-sync socket to {}:{} (errno {})!",
+                 std::get<0>(listen_addr_port), std::get<1>(listen_addr_port),
+                 errno);
+    close(recv_fd);
+    recv_fd = -1;
+    return;
+  }
+
+  // Unbound send sockets, one per address family a peer may use.
+  for (const PeerAddr &peer : peer_addrs) {
+    int &send_fd =
+        peer.addr.ss_family == AF_INET6 ? send_fd_ipv6 : send_fd_ipv4;
+    if (send_fd == -1) {
+      send_fd = socket(peer.addr.ss_family, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+      if (send_fd == -1) {
+        PMA_EPrintln(
+            "ERROR: Failed to create peer-sync send socket (errno {})!",
+            errno);
+        close(recv_fd);
+        recv_fd = -1;
+        return;
+      }
+    }
+  }
+
+  receiver_thread =
+      std::thread(receiver_function, stop_var, recv_fd, std::move(apply_fn));
+}
+
+PeerSync::~PeerSync() { cleanup(); }
+
+PeerSync::PeerSync(PeerSync &&other)
+    : stop_var(std::move(other.stop_var)),
+      peer_addrs(std::move(other.peer_addrs)),
+      recv_fd(other.recv_fd),
+      send_fd_ipv4(other.send_fd_ipv4),
+      send_fd_ipv6(other.send_fd_ipv6),
+      receiver_thread(std::move(other.receiver_thread)) {
+  other.recv_fd = -1;
+  other.send_fd_ipv4 = -1;
+  other.send_fd_ipv6 = -1;
+}
+
+PeerSync &PeerSync::operator=(PeerSync &&other) {
+  cleanup();
+  stop_var = std::move(other.stop_var);
+  peer_addrs = std::move(other.peer_addrs);
+  recv_fd = other.recv_fd;
+  send_fd_ipv4 = other.send_fd_ipv4;
+  send_fd_ipv6 = other.send_fd_ipv6;
+  receiver_thread = std::move(other.receiver_thread);
+  other.recv_fd = -1;
+  other.send_fd_ipv4 = -1;
+  other.send_fd_ipv6 = -1;
+  return *this;
+}
+
+bool PeerSync::is_valid() const { return recv_fd != -1; }
+
+void PeerSync::broadcast_allowed(const std::string &ip, uint16_t port) {
+  if (recv_fd == -1) {
+    return;
+  }
+
+  const std::string msg =
+      std::format("{}{} {}", PEER_SYNC_MSG_PREFIX, ip, port);
+  for (const PeerAddr &peer : peer_addrs) {
+    const int send_fd =
+        peer.addr.ss_family == AF_INET6 ? send_fd_ipv6 : send_fd_ipv4;
+    // Best effort; a dropped datagram only means the peer re-challenges.
+    sendto(send_fd, msg.c_str(), msg.size(), 0,
+           reinterpret_cast<const sockaddr *>(&peer.addr), peer.addr_len);
+  }
+}
+
+void PeerSync::receiver_function(std::shared_ptr<std::atomic_bool> stop_var,
+                                 int recv_fd, ApplyFn apply_fn) {
+  std::array<char, PEER_SYNC_RECV_BUF_SIZE> buf;
+
+  while (!stop_var->load()) {
+    const ssize_t received = recvfrom(recv_fd, buf.data(), buf.size() - 1, 0,
+                                      nullptr, nullptr);
+    if (received < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        PMA_EPrintln("WARNING: peer-sync recvfrom failed (errno {})!", errno);
+      }
+      continue;
+    }
+    buf.at(static_cast<size_t>(received)) = 0;
+
+    const std::string msg(buf.data(), static_cast<size_t>(received));
+    if (msg.size() <= PEER_SYNC_MSG_PREFIX_SIZE ||
+        msg.compare(0, PEER_SYNC_MSG_PREFIX_SIZE, PEER_SYNC_MSG_PREFIX) != 0) {
+      continue;
+    }
+
+    // The ip may contain colons, so the port is after the last space.
+    const size_t last_space_idx = msg.rfind(' ');
+    if (last_space_idx < PEER_SYNC_MSG_PREFIX_SIZE ||
+        last_space_idx + 1 >= msg.size()) {
+      continue;
+    }
+    const std::string ip =
+        msg.substr(PEER_SYNC_MSG_PREFIX_SIZE,
+                   last_space_idx - PEER_SYNC_MSG_PREFIX_SIZE);
+    if (ip.empty() || ip.find(' ') != std::string::npos) {
+      continue;
+    }
+
+    char *end = nullptr;
+    const unsigned long parsed =
+        std::strtoul(msg.c_str() + last_space_idx + 1, &end, 10);
+    if (end == msg.c_str() + last_space_idx + 1 || *end != 0 ||
+        parsed > 0xFFFF) {
+      continue;
+    }
+
+    apply_fn(ip, static_cast<uint16_t>(parsed));
+  }
+}
+
+void PeerSync::cleanup() {
+  if (stop_var) {
+    stop_var->store(true);
+  }
+  if (receiver_thread.joinable()) {
+    receiver_thread.join();
+  }
+  if (recv_fd != -1) {
+    close(recv_fd);
+    recv_fd = -1;
+  }
+  if (send_fd_ipv4 != -1) {
+    close(send_fd_ipv4);
+    send_fd_ipv4 = -1;
+  }
+  if (send_fd_ipv6 != -1) {
+    close(send_fd_ipv6);
+    send_fd_ipv6 = -1;
+  }
+}
+
+static std::optional<PeerSync> internal_global_peer_sync = std::nullopt;
+
+bool peer_sync_start(const PMA_ARGS::AddrPort &listen_addr_port,
+                     const std::deque<PMA_ARGS::AddrPort> &peers,
+                     PeerSync::ApplyFn apply_fn) {
+  internal_global_peer_sync.emplace(listen_addr_port, peers,
+                                    std::move(apply_fn));
+  if (!internal_global_peer_sync->is_valid()) {
+    internal_global_peer_sync.reset();
+    return false;
+  }
+  return true;
+}
+
+void peer_sync_stop() { internal_global_peer_sync.reset(); }
+
+void peer_sync_broadcast_allowed(const std::string &ip, uint16_t port) {
+  if (internal_global_peer_sync.has_value()) {
+    internal_global_peer_sync->broadcast_allowed(ip, port);
+  }
+}
@@ -0,0 +1,99 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef SEODISPARATE_COM_POOR_MANS_ANUBIS_PEER_SYNC_H_
+#define SEODISPARATE_COM_POOR_MANS_ANUBIS_PEER_SYNC_H_
+
+// Standard library includes
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Unix includes
+#include <sys/socket.h>
+
+// Local includes
+#include "args.h"
+
+/// Best-effort replication of the allowed-IP set across instances behind
+/// one load balancer. Each local verification success is broadcast as a
+/// small UDP datagram to the configured peers; received datagrams feed the
+/// in-memory allowed cache, so a client verified on one instance skips the
+/// challenge fleet-wide without a central-db round trip. Datagrams are
+/// unauthenticated, so the peer port must only be reachable from the
+/// fleet's own network. Received events are never re-broadcast, so there
+/// is no gossip loop.
+class PeerSync {
+ public:
+  using ApplyFn = std::function<void(const std::string &ip, uint16_t port)>;
+
+  PeerSync();
+  PeerSync(const PMA_ARGS::AddrPort &listen_addr_port,
+           std::deque<PMA_ARGS::AddrPort> peers, ApplyFn apply_fn);
+  ~PeerSync();
+
+  // disallow copy
+  PeerSync(const PeerSync &) = delete;
+  PeerSync &operator=(const PeerSync &) = delete;
+
+  // allow move
+  PeerSync(PeerSync &&);
+  PeerSync &operator=(PeerSync &&);
+
+  /// False if binding the listen socket or resolving a peer failed.
+  bool is_valid() const;
+
+  /// Sends one "allowed" event to every peer. Best effort: send errors are
+  /// ignored and the caller is never blocked.
+  void broadcast_allowed(const std::string &ip, uint16_t port);
+
+ private:
+  struct PeerAddr {
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+  };
+
+  static void receiver_function(std::shared_ptr<std::atomic_bool> stop_var,
+                                int recv_fd, ApplyFn apply_fn);
+
+  void cleanup();
+
+  std::shared_ptr<std::atomic_bool> stop_var;
+  std::vector<PeerAddr> peer_addrs;
+  int recv_fd;
+  int send_fd_ipv4;
+  int send_fd_ipv6;
+  std::thread receiver_thread;
+};
+
+/// Starts the process-wide peer sync. Returns false on failure (bad listen
+/// addr/port or unparsable peer).
+bool peer_sync_start(const PMA_ARGS::AddrPort &listen_addr_port,
+                     const std::deque<PMA_ARGS::AddrPort> &peers,
+                     PeerSync::ApplyFn apply_fn);
+
+/// Stops the process-wide peer sync.
+void peer_sync_stop();
+
+/// Broadcasts via the process-wide peer sync; no-op when it isn't running.
+void peer_sync_broadcast_allowed(const std::string &ip, uint16_t port);
+
+#endif
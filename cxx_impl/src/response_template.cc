@@ -0,0 +1,86 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "response_template.h"
+
+ResponseTemplate::ResponseTemplate() : segments(), slot_indices() {
+  segments.push_back(std::string_view{});
+}
+
+ResponseTemplate::ResponseTemplate(
+    std::string_view tmpl, const std::vector<std::string> &placeholders)
+    : segments(), slot_indices() {
+  size_t pos = 0;
+  while (true) {
+    // Earliest occurrence of any placeholder at or after pos.
+    size_t best_pos = std::string_view::npos;
+    size_t best_idx = 0;
+    for (size_t idx = 0; idx < placeholders.size(); ++idx) {
+      const size_t found = tmpl.find(placeholders.at(idx), pos);
+      if (found < best_pos) {
+        best_pos = found;
+        best_idx = idx;
+      }
+    }
+    if (best_pos == std::string_view::npos) {
+      break;
+    }
+    segments.push_back(tmpl.substr(pos, best_pos - pos));
+    slot_indices.push_back(best_idx);
+    pos = best_pos + placeholders.at(best_idx).size();
+  }
+  segments.push_back(tmpl.substr(pos));
+}
+
+size_t ResponseTemplate::size(
+    const std::vector<std::string_view> &values) const {
+  size_t total = 0;
+  for (const auto &segment : segments) {
+    total += segment.size();
+  }
+  for (const size_t idx : slot_indices) {
+    total += values.at(idx).size();
+  }
+  return total;
+}
+
+void ResponseTemplate::fill_iovecs(const std::vector<std::string_view> &values,
+                                   std::vector<struct iovec> &iovecs) const {
+  const auto push = [&iovecs](std::string_view part) {
+    if (!part.empty()) {
+      // writev(2) takes non-const iov_base; the memory is never written to.
+      iovecs.push_back(
+          iovec{const_cast<char *>(part.data()), part.size()});
+    }
+  };
+  for (size_t idx = 0; idx < slot_indices.size(); ++idx) {
+    push(segments.at(idx));
+    push(values.at(slot_indices.at(idx)));
+  }
+  push(segments.back());
+}
+
+std::string ResponseTemplate::to_string(
+    const std::vector<std::string_view> &values) const {
+  std::string out;
+  out.reserve(size(values));
+  for (size_t idx = 0; idx < slot_indices.size(); ++idx) {
+    out.append(segments.at(idx));
+    out.append(values.at(slot_indices.at(idx)));
+  }
+  out.append(segments.back());
+  return out;
+}
@@ -0,0 +1,69 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef SEODISPARATE_COM_POOR_MANS_ANUBIS_RESPONSE_TEMPLATE_H_
+#define SEODISPARATE_COM_POOR_MANS_ANUBIS_RESPONSE_TEMPLATE_H_
+
+// Standard library includes
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Unix includes
+#include <sys/uio.h>
+
+/// Splits a template containing "{PLACEHOLDER}" markers into static segments
+/// once, so a response can be emitted with writev(2) iovecs pointing at the
+/// segments plus the per-request values instead of search-and-replace over
+/// the whole page per request. The template string must outlive this object;
+/// segments are views into it.
+class ResponseTemplate {
+ public:
+  ResponseTemplate();
+  /// placeholders lists markers (e.g. "{UUID}") in the order their values
+  /// will be supplied to the member fns below.
+  ResponseTemplate(std::string_view tmpl,
+                   const std::vector<std::string> &placeholders);
+
+  // allow copy
+  ResponseTemplate(const ResponseTemplate &) = default;
+  ResponseTemplate &operator=(const ResponseTemplate &) = default;
+
+  // allow move
+  ResponseTemplate(ResponseTemplate &&) = default;
+  ResponseTemplate &operator=(ResponseTemplate &&) = default;
+
+  /// Total rendered size in bytes (for Content-Length).
+  size_t size(const std::vector<std::string_view> &values) const;
+
+  /// Appends iovecs over the static segments and values. The values must
+  /// stay alive until the writev(2) call completes.
+  void fill_iovecs(const std::vector<std::string_view> &values,
+                   std::vector<struct iovec> &iovecs) const;
+
+  /// Materializes the rendered template; used when a partial write forces
+  /// buffering the remainder.
+  std::string to_string(const std::vector<std::string_view> &values) const;
+
+ private:
+  // segments.size() == slot_indices.size() + 1; value slot_indices[i] is
+  // emitted between segments[i] and segments[i + 1].
+  std::vector<std::string_view> segments;
+  std::vector<size_t> slot_indices;
+};
+
+#endif
@@ -16,15 +16,39 @@
 
 // standard library includes
 #include <atomic>
+#include <chrono>
 #include <cstring>
+#include <mutex>
 #include <random>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// unix includes
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 // local includes
 #include "args.h"
+#include "asset_cache.h"
+#include "backend_pool.h"
+#include "challenge_pool.h"
+#include "challenge_store.h"
+#include "conn_arena.h"
+#include "constants.h"
+#include "db.h"
 #include "db_msql.h"
+#include "difficulty.h"
+#include "gzip_template.h"
 #include "helpers.h"
 #include "http.h"
+#include "metrics.h"
+#include "peer_sync.h"
 #include "poor_mans_print.h"
+#include "response_template.h"
+#include "thread_limit.h"
+#include "ttl_cache.h"
 
 #define ASSERT_TRUE(x)                                                 \
   test_count.fetch_add(1);                                             \
@@ -1202,6 +1226,251 @@ int main() {
     PMA_MSQL::Value double_v = PMA_MSQL::Value(1.23);
   }
 
+  // Test PMA_MSQL::ValueView and parse_row_pkt_view
+  {
+    PMA_MSQL::ValueView view;
+    CHECK_TRUE(view.type == PMA_MSQL::Value::INV_NULL);
+
+    std::string backing("Borrowed Bytes");
+    view = PMA_MSQL::ValueView(std::string_view(backing));
+    CHECK_TRUE(view.type == PMA_MSQL::Value::STRING);
+    CHECK_TRUE(view.owned.empty());
+    CHECK_TRUE(view.get_str() == "Borrowed Bytes");
+    CHECK_TRUE(view.get_str().data() == backing.data());
+    CHECK_TRUE(*view.to_value().get_str().value() == "Borrowed Bytes");
+
+    view = PMA_MSQL::ValueView(std::string("Owned Bytes"));
+    CHECK_TRUE(view.type == PMA_MSQL::Value::STRING);
+    CHECK_TRUE(view.get_str() == "Owned Bytes");
+
+    view = PMA_MSQL::ValueView(static_cast<int64_t>(-123));
+    CHECK_TRUE(view.type == PMA_MSQL::Value::SIGNED_INT);
+    CHECK_TRUE(view.sint == -123);
+    CHECK_TRUE(*view.to_value().get_signed_int().value() == -123);
+
+    view = PMA_MSQL::ValueView(static_cast<uint64_t>(456789));
+    CHECK_TRUE(view.type == PMA_MSQL::Value::UNSIGNED_INT);
+    CHECK_TRUE(*view.to_value().get_unsigned_int().value() == 456789);
+
+    view = PMA_MSQL::ValueView(1.5);
+    CHECK_TRUE(view.type == PMA_MSQL::Value::DOUBLE);
+    CHECK_TRUE(*view.to_value().get_double().value() == 1.5);
+
+    // Row pkt with cols LONGLONG (unsigned), VAR_STRING, and NULL LONGLONG.
+    std::vector<uint8_t> field_types{8, 253, 8};
+    std::vector<uint16_t> field_details{0x20, 0, 0};
+    std::vector<uint8_t> pkt;
+    pkt.push_back(0);
+    // NULL bitmap: third col NULL is bit (2 + 2).
+    pkt.push_back(0x10);
+    const uint64_t big = 0x1122334455667788ULL;
+    const uint8_t *big_bytes = reinterpret_cast<const uint8_t *>(&big);
+    for (size_t idx = 0; idx < 8; ++idx) {
+      pkt.push_back(big_bytes[idx]);
+    }
+    const std::string row_str("row string");
+    pkt.push_back(static_cast<uint8_t>(row_str.size()));
+    for (char c : row_str) {
+      pkt.push_back(static_cast<uint8_t>(c));
+    }
+
+    std::vector<PMA_MSQL::ValueView> views;
+    CHECK_TRUE(PMA_MSQL::parse_row_pkt_view(pkt.data(), pkt.size(),
+                                            field_types, field_details,
+                                            &views) == 0);
+    CHECK_TRUE(views.size() == 3);
+    CHECK_TRUE(views.at(0).type == PMA_MSQL::Value::UNSIGNED_INT);
+    CHECK_TRUE(views.at(0).uint == big);
+    CHECK_TRUE(views.at(1).type == PMA_MSQL::Value::STRING);
+    CHECK_TRUE(views.at(1).get_str() == row_str);
+    // The STRING bytes must be borrowed from the packet, not copied.
+    CHECK_TRUE(views.at(1).str.data() ==
+               reinterpret_cast<char *>(pkt.data()) + 11);
+    CHECK_TRUE(views.at(2).type == PMA_MSQL::Value::INV_NULL);
+
+    // The owning parse must decode the same row.
+    std::vector<PMA_MSQL::Value> values;
+    CHECK_TRUE(PMA_MSQL::parse_row_pkt(pkt.data(), pkt.size(), field_types,
+                                       field_details, &values) == 0);
+    CHECK_TRUE(values.size() == 3);
+    CHECK_TRUE(*values.at(0).get_unsigned_int().value() == big);
+    CHECK_TRUE(*values.at(1).get_str().value() == row_str);
+    CHECK_TRUE(values.at(2).get_type() == PMA_MSQL::Value::INV_NULL);
+  }
+
+  // Test Connection::execute_stmt_views with the trailing OK/EOF pkt in a
+  // separate read chunk from the last row. A fake server sizes the row so
+  // the first 4096-byte read ends exactly at the row pkt's end; the row's
+  // borrowed bytes must survive the extra read for the OK/EOF pkt.
+  {
+    auto frame = [](uint8_t seq, const std::vector<uint8_t> &payload) {
+      std::vector<uint8_t> out;
+      out.push_back(static_cast<uint8_t>(payload.size() & 0xFF));
+      out.push_back(static_cast<uint8_t>((payload.size() >> 8) & 0xFF));
+      out.push_back(static_cast<uint8_t>((payload.size() >> 16) & 0xFF));
+      out.push_back(seq);
+      out.insert(out.end(), payload.begin(), payload.end());
+      return out;
+    };
+
+    // Init handshake: proto 10, version, conn id, 8-byte seed, caps with
+    // only CLIENT_MYSQL and PLUGIN_AUTH set, then the plugin name.
+    std::vector<uint8_t> handshake{10};
+    for (char c : std::string_view("5.5.5-test")) {
+      handshake.push_back(static_cast<uint8_t>(c));
+    }
+    handshake.push_back(0);
+    handshake.insert(handshake.end(), {1, 0, 0, 0});
+    handshake.insert(handshake.end(), 8, 'A');
+    handshake.push_back(0);
+    handshake.insert(handshake.end(), {0x01, 0x00});
+    handshake.push_back(0xe0);
+    handshake.insert(handshake.end(), {0, 0});
+    handshake.insert(handshake.end(), {0x08, 0x00});
+    handshake.push_back(0);
+    handshake.insert(handshake.end(), 6, 0);
+    handshake.insert(handshake.end(), 4, 0);
+    for (char c : std::string_view("mysql_native_password")) {
+      handshake.push_back(static_cast<uint8_t>(c));
+    }
+
+    // OK pkt for auth: header, affected rows, insert id, status, warnings.
+    const std::vector<uint8_t> auth_ok{0, 0, 0, 0, 0, 0, 0};
+
+    // Prepare response: status 0, stmt id 1, 0 cols, 0 params, filler,
+    // 0 warnings.
+    const std::vector<uint8_t> prepare_resp{0, 1, 0, 0, 0, 0, 0,
+                                            0, 0, 0, 0, 0};
+
+    // Column def for a single VAR_STRING column named "C".
+    std::vector<uint8_t> col_def{3, 'd', 'e', 'f', 0, 0, 0, 1, 'C', 1, 'C'};
+    col_def.push_back(0x0c);
+    col_def.insert(col_def.end(), {0xe0, 0});        // charset
+    col_def.insert(col_def.end(), {0, 16, 0, 0});    // max col size
+    col_def.push_back(253);                          // field type
+    col_def.insert(col_def.end(), {0, 0});           // field detail
+    col_def.push_back(0);                            // decimals
+    col_def.insert(col_def.end(), {0, 0});           // unused
+
+    // Size the row string so col count + col def + row frames total 4096.
+    const std::vector<uint8_t> col_count_frame = frame(1, {1});
+    const size_t row_payload_size =
+        4096 - col_count_frame.size() - (4 + col_def.size()) - 4;
+    // Header byte, NULL bitmap, then 3-byte length-encoded string size.
+    const size_t row_str_size = row_payload_size - 2 - 3;
+    std::vector<uint8_t> row{0, 0, 0xFC,
+                             static_cast<uint8_t>(row_str_size & 0xFF),
+                             static_cast<uint8_t>((row_str_size >> 8) & 0xFF)};
+    for (size_t idx = 0; idx < row_str_size; ++idx) {
+      row.push_back(static_cast<uint8_t>('A' + idx % 26));
+    }
+
+    std::vector<uint8_t> exec_resp = col_count_frame;
+    const std::vector<uint8_t> col_def_frame = frame(2, col_def);
+    exec_resp.insert(exec_resp.end(), col_def_frame.begin(),
+                     col_def_frame.end());
+    const std::vector<uint8_t> row_frame = frame(3, row);
+    exec_resp.insert(exec_resp.end(), row_frame.begin(), row_frame.end());
+    CHECK_TRUE(exec_resp.size() == 4096);
+    const std::vector<uint8_t> eof_frame =
+        frame(4, {0xFE, 0, 0, 0, 0, 0, 0});
+    exec_resp.insert(exec_resp.end(), eof_frame.begin(), eof_frame.end());
+
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_TRUE(listen_fd >= 0);
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    ASSERT_TRUE(bind(listen_fd, reinterpret_cast<struct sockaddr *>(&addr),
+                     sizeof(addr)) == 0);
+    ASSERT_TRUE(listen(listen_fd, 1) == 0);
+    socklen_t addr_len = sizeof(addr);
+    ASSERT_TRUE(getsockname(listen_fd,
+                            reinterpret_cast<struct sockaddr *>(&addr),
+                            &addr_len) == 0);
+    const uint16_t server_port = ntohs(addr.sin_port);
+
+    std::thread server_thread([listen_fd, &frame, &handshake, &auth_ok,
+                               &prepare_resp, &exec_resp] {
+      int conn_fd = accept(listen_fd, nullptr, nullptr);
+      if (conn_fd < 0) {
+        return;
+      }
+      auto write_all = [conn_fd](const std::vector<uint8_t> &data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+          ssize_t ret = write(conn_fd, data.data() + sent, data.size() - sent);
+          if (ret <= 0) {
+            return false;
+          }
+          sent += static_cast<size_t>(ret);
+        }
+        return true;
+      };
+      auto read_pkt = [conn_fd] {
+        uint8_t hdr[4];
+        size_t got = 0;
+        while (got < 4) {
+          ssize_t ret = read(conn_fd, hdr + got, 4 - got);
+          if (ret <= 0) {
+            return false;
+          }
+          got += static_cast<size_t>(ret);
+        }
+        size_t len = static_cast<size_t>(hdr[0]) |
+                     (static_cast<size_t>(hdr[1]) << 8) |
+                     (static_cast<size_t>(hdr[2]) << 16);
+        std::vector<uint8_t> payload(len);
+        got = 0;
+        while (got < len) {
+          ssize_t ret = read(conn_fd, payload.data() + got, len - got);
+          if (ret <= 0) {
+            return false;
+          }
+          got += static_cast<size_t>(ret);
+        }
+        return true;
+      };
+
+      // Handshake, auth response, auth OK.
+      if (write_all(frame(0, handshake)) && read_pkt() &&
+          write_all(frame(2, auth_ok)) &&
+          // Prepare request and response.
+          read_pkt() && write_all(frame(1, prepare_resp)) &&
+          // Execute request, then the whole response in one write; the
+          // client's 4096-byte reads split it at the row/OK boundary.
+          read_pkt() && write_all(exec_resp)) {
+        // Drain COM_STMT_CLOSE and COM_QUIT until the client closes, so
+        // the client never writes to a closed socket.
+        uint8_t drain[64];
+        while (read(conn_fd, drain, sizeof(drain)) > 0) {
+        }
+      }
+      close(conn_fd);
+    });
+
+    auto conn_opt = PMA_MSQL::Connection::connect_msql(
+        "127.0.0.1", server_port, "user", "pass", "db");
+    ASSERT_TRUE(conn_opt.has_value());
+    std::vector<std::vector<PMA_MSQL::ValueView> > rows;
+    CHECK_TRUE(conn_opt->execute_stmt_views("SELECT C FROM T", {}, rows));
+    ASSERT_TRUE(rows.size() == 1);
+    ASSERT_TRUE(rows.at(0).size() == 1);
+    CHECK_TRUE(rows.at(0).at(0).type == PMA_MSQL::Value::STRING);
+    const std::string_view got = rows.at(0).at(0).get_str();
+    CHECK_TRUE(got.size() == row_str_size);
+    bool content_ok = got.size() == row_str_size;
+    for (size_t idx = 0; content_ok && idx < got.size(); ++idx) {
+      content_ok = got.at(idx) == static_cast<char>('A' + idx % 26);
+    }
+    CHECK_TRUE(content_ok);
+    conn_opt.reset();
+    server_thread.join();
+    close(listen_fd);
+  }
+
   // Test PMA_HELPER::str_replace_all
   {
     std::string s("One Two Three Four Five");
@@ -1230,21 +1499,17 @@ int main() {
   }
 
   // Test PMA_HELPER::MimeTypes::get_mimetype_from_ext
-  // NOTICE: Unused. Re-enable tests if needed to be used.
-  //{
-  //  PMA_HELPER::MimeTypes types{};
-  //  if (types.is_loaded()) {
-  //    std::string type = types.get_mimetype_from_ext("css");
-  //    PMA_EPrintln("css -> {}, is {}", type,
-  //                 type.empty() ? "empty" : "not empty");
-  //    CHECK_TRUE(types.get_mimetype_from_ext("html") == "text/html");
-  //    CHECK_TRUE(types.get_mimetype_from_ext("css") == "text/css");
-  //    CHECK_TRUE(types.get_mimetype_from_ext("js") == "text/javascript");
-  //    CHECK_TRUE(types.get_mimetype_from_ext("png") == "image/png");
-  //  } else {
-  //    PMA_Println("Cannot test MimeTypes: not loaded.");
-  //  }
-  //}
+  {
+    PMA_HELPER::MimeTypes types{};
+    if (types.is_loaded()) {
+      CHECK_TRUE(types.get_mimetype_from_ext("html") == "text/html");
+      CHECK_TRUE(types.get_mimetype_from_ext("css") == "text/css");
+      CHECK_TRUE(types.get_mimetype_from_ext("png") == "image/png");
+      CHECK_TRUE(types.get_mimetype_from_ext("nosuchext").empty());
+    } else {
+      PMA_Println("Cannot test MimeTypes: not loaded.");
+    }
+  }
 
   // TEST PMA_HELPER::vec_to_hexadecimal
   {
@@ -1252,6 +1517,590 @@ int main() {
     CHECK_TRUE(PMA_HELPER::vec_to_hexadecimal(data) == "120345ABC34D00F00F");
   }
 
+  // Test PMA_HELPER::next_hash with an inline (non-fn-pointer) hasher
+  {
+    std::string hash = PMA_HELPER::next_hash(
+        1234, [](void *data, size_t size) -> PMA_HELPER::HashResult {
+          PMA_HELPER::HashResult result{};
+          const uint8_t *bytes = reinterpret_cast<uint8_t *>(data);
+          for (size_t idx = 0; idx < size; ++idx) {
+            result.at(idx % result.size()) ^= bytes[idx];
+          }
+          return result;
+        });
+    CHECK_TRUE(hash.size() == PMA_HELPER::HASH_RESULT_SIZE * 2);
+    for (char c : hash) {
+      CHECK_TRUE((c >= '0' && c <= '9') || (c >= 'A' && c <= 'F'));
+    }
+  }
+
+  // Test ChallengePool
+  {
+    ChallengePool pool(2, 4);
+    for (int iter = 0; iter < 8; ++iter) {
+      Work_Factors wf = pool.get(2);
+      CHECK_TRUE(wf.value2 != nullptr);
+      CHECK_TRUE(wf.factors != nullptr);
+      work_cleanup_factors2(&wf);
+    }
+    // Mismatched quads falls back to inline generation.
+    Work_Factors wf = pool.get(3);
+    CHECK_TRUE(wf.value2 != nullptr);
+    work_cleanup_factors2(&wf);
+  }
+
+  // Test PMA_SQL::SQLITECtx move-assignment into a live ctx
+  {
+    PMA_SQL::SQLITECtx ctx;
+    PMA_SQL::ErrorT sql_err;
+    std::string sql_err_msg;
+    std::tie(ctx, sql_err, sql_err_msg) = PMA_SQL::init_sqlite(":memory:");
+    CHECK_TRUE(sql_err == PMA_SQL::ErrorT::SUCCESS);
+    // Assigning over an initialized ctx must release the old handle and
+    // leave the incoming one usable.
+    std::tie(ctx, sql_err, sql_err_msg) = PMA_SQL::init_sqlite(":memory:");
+    CHECK_TRUE(sql_err == PMA_SQL::ErrorT::SUCCESS);
+    CHECK_TRUE(ctx.get_sqlite_ctx() != nullptr);
+  }
+
+  // Test ChallengeStore
+  {
+    std::atomic_int insert_flushes{0};
+    std::atomic_int delete_flushes{0};
+    {
+      ChallengeStore store(
+          std::chrono::seconds(60),
+          [&insert_flushes,
+           &delete_flushes](const ChallengeStore::PendingWrite &write) {
+            if (write.is_delete) {
+              ++delete_flushes;
+            } else {
+              ++insert_flushes;
+            }
+          });
+      store.insert("id_a", "hash_a", "127.0.0.1", 8080);
+      CHECK_TRUE(store.contains("id_a"));
+      CHECK_TRUE(!store.contains("id_b"));
+
+      auto entry_opt = store.lookup("id_a", "hash_a");
+      ASSERT_TRUE(entry_opt.has_value());
+      CHECK_TRUE(std::get<0>(entry_opt.value()) == "127.0.0.1");
+      CHECK_TRUE(std::get<1>(entry_opt.value()) == 8080);
+
+      // Wrong factors hash must not match.
+      CHECK_TRUE(!store.lookup("id_a", "hash_b").has_value());
+
+      // Entry age is well under the 60 second ttl.
+      auto elapsed_opt = store.elapsed_since_insert("id_a");
+      ASSERT_TRUE(elapsed_opt.has_value());
+      CHECK_TRUE(elapsed_opt.value() >= std::chrono::milliseconds(0));
+      CHECK_TRUE(elapsed_opt.value() < std::chrono::seconds(60));
+      CHECK_TRUE(!store.elapsed_since_insert("id_b").has_value());
+
+      store.erase("id_a");
+      CHECK_TRUE(!store.contains("id_a"));
+    }
+    // Dtor joins the writer thread, so all queued writes were flushed.
+    CHECK_TRUE(insert_flushes.load() == 1);
+    CHECK_TRUE(delete_flushes.load() == 1);
+  }
+
+  // Test PMA_HTTP::handle_request_parse_view
+  {
+    const std::string raw =
+        "GET /path?id=abc&x=1 HTTP/1.1\r\n"
+        "Host: example.com\r\n"
+        "X-Real-IP: 1.2.3.4\r\n"
+        "\r\n"
+        "body_text";
+    PMA_HTTP::RequestView view = PMA_HTTP::handle_request_parse_view(raw);
+    ASSERT_TRUE(view.error_enum == PMA_HTTP::ErrorT::SUCCESS);
+    CHECK_TRUE(view.method == "GET");
+    CHECK_TRUE(view.url_or_err_msg == "/path");
+    CHECK_TRUE(view.full_url == "/path?id=abc&x=1");
+    CHECK_TRUE(view.body == "body_text");
+    ASSERT_TRUE(view.queries.size() == 2);
+    CHECK_TRUE(view.queries.at(0).first == "id");
+    CHECK_TRUE(view.queries.at(0).second == "abc");
+    // Views are slices over the original buffer, not copies.
+    CHECK_TRUE(view.body.data() >= raw.data() &&
+               view.body.data() < raw.data() + raw.size());
+    ASSERT_TRUE(view.find_header("x-real-ip").has_value());
+    CHECK_TRUE(view.find_header("x-real-ip").value() == "1.2.3.4");
+    CHECK_TRUE(!view.find_header("content-type").has_value());
+
+    PMA_HTTP::Request req = view.to_request();
+    ASSERT_TRUE(req.error_enum == PMA_HTTP::ErrorT::SUCCESS);
+    CHECK_TRUE(req.url_or_err_msg == "/path/");
+    ASSERT_TRUE(req.headers.find("x-real-ip") != req.headers.end());
+    CHECK_TRUE(req.headers.find("x-real-ip")->second == "1.2.3.4");
+    CHECK_TRUE(req.queries.find("id")->second == "abc");
+  }
+
+  // Test PMA_HTTP::parse_simple_json_streaming
+  {
+    const std::string json = "{\"type\": \"answer\", \"factors\": \"abc123\"}";
+    std::string_view type_view, factors_view;
+    PMA_HTTP::ErrorT err = PMA_HTTP::parse_simple_json_streaming(
+        json, json.size(),
+        [&type_view, &factors_view](std::string_view key,
+                                    std::string_view value) {
+          if (key == "type") {
+            type_view = value;
+          } else if (key == "factors") {
+            factors_view = value;
+          }
+        });
+    CHECK_TRUE(err == PMA_HTTP::ErrorT::SUCCESS);
+    CHECK_TRUE(type_view == "answer");
+    CHECK_TRUE(factors_view == "abc123");
+    // Values are slices over the original buffer, not copies.
+    CHECK_TRUE(factors_view.data() >= json.data() &&
+               factors_view.data() < json.data() + json.size());
+    // Size limit is enforced mid-parse.
+    err = PMA_HTTP::parse_simple_json_streaming(
+        json, 4, [](std::string_view, std::string_view) {});
+    CHECK_TRUE(err == PMA_HTTP::ErrorT::FAILED_TO_PARSE_JSON);
+  }
+
+  // Test TTLCache
+  {
+    TTLCache cache(std::chrono::seconds(60), 4);
+    const auto now = std::chrono::steady_clock::now();
+    cache.insert("1.2.3.4:80", now);
+    CHECK_TRUE(cache.check("1.2.3.4:80", now));
+    CHECK_TRUE(!cache.check("1.2.3.4:443", now));
+    // Expired on lookup.
+    CHECK_TRUE(!cache.check("1.2.3.4:80", now + std::chrono::seconds(61)));
+    // Pruned incrementally: a full rotation of the shards drops the entry.
+    cache.insert("1.2.3.4:80", now);
+    for (size_t idx = 0; idx < cache.get_shard_count(); ++idx) {
+      cache.prune_next_shard(now + std::chrono::seconds(61));
+    }
+    CHECK_TRUE(!cache.check("1.2.3.4:80", now));
+  }
+
+  // Test ConnArena
+  {
+    ConnArena arena;
+    char *first = reinterpret_cast<char *>(arena.alloc(100));
+    char *second = reinterpret_cast<char *>(arena.alloc(100));
+    CHECK_TRUE(first != second);
+    CHECK_TRUE(arena.block_count() == 1);
+    // Aligned for any type.
+    CHECK_TRUE(reinterpret_cast<uintptr_t>(second) %
+                   alignof(std::max_align_t) ==
+               0);
+    // Oversized allocations chain a new block instead of failing.
+    char *big = reinterpret_cast<char *>(arena.alloc(CONN_ARENA_BLOCK_SIZE));
+    CHECK_TRUE(big != nullptr);
+    CHECK_TRUE(arena.block_count() == 2);
+    // reset() reclaims the first block in place and drops overflow blocks.
+    arena.reset();
+    CHECK_TRUE(arena.block_count() == 1);
+    CHECK_TRUE(reinterpret_cast<char *>(arena.alloc(100)) == first);
+  }
+
+  // Test ResponseTemplate
+  {
+    const ResponseTemplate tmpl("<a href=\"{URL}\">{NAME}</a> by {NAME}",
+                                {"{URL}", "{NAME}"});
+    const std::vector<std::string_view> values{"/page/", "someone"};
+    CHECK_TRUE(tmpl.to_string(values) ==
+               "<a href=\"/page/\">someone</a> by someone");
+    CHECK_TRUE(tmpl.size(values) == tmpl.to_string(values).size());
+
+    std::vector<struct iovec> iovecs;
+    tmpl.fill_iovecs(values, iovecs);
+    std::string joined;
+    for (const auto &iov : iovecs) {
+      joined.append(reinterpret_cast<const char *>(iov.iov_base), iov.iov_len);
+    }
+    CHECK_TRUE(joined == tmpl.to_string(values));
+
+    // No placeholders degenerates to a single segment.
+    const ResponseTemplate plain("just text", {"{URL}"});
+    CHECK_TRUE(plain.to_string({}) == "just text");
+    CHECK_TRUE(plain.size({}) == 9);
+  }
+
+  // Test PMA_GZIP::crc32 and GzipResponseTemplate
+  {
+    // Known CRC-32 check value.
+    CHECK_TRUE(PMA_GZIP::crc32(0, reinterpret_cast<const uint8_t *>(
+                                      "123456789"),
+                               9) == 0xCBF43926);
+    // Incremental updates must match a one-shot pass.
+    const uint8_t *check_data =
+        reinterpret_cast<const uint8_t *>("123456789");
+    CHECK_TRUE(PMA_GZIP::crc32(PMA_GZIP::crc32(0, check_data, 4),
+                               check_data + 4, 5) == 0xCBF43926);
+
+    const char *gz_tmpl =
+        "<a href=\"{URL}\">{NAME}</a> by {NAME}, and repeated text repeated "
+        "text repeated text to give the compressor something to match.";
+    const ResponseTemplate ref(gz_tmpl, {"{URL}", "{NAME}"});
+    const GzipResponseTemplate gz(gz_tmpl, {"{URL}", "{NAME}"});
+    const std::vector<std::string_view> values{"/page/", "someone"};
+
+    const std::string rendered = ref.to_string(values);
+    const std::string gz_bytes = gz.to_string(values);
+    CHECK_TRUE(gz.size(values) == gz_bytes.size());
+    // RFC 1952 member header magic and deflate method.
+    CHECK_TRUE(gz_bytes.size() > 18);
+    CHECK_TRUE(static_cast<uint8_t>(gz_bytes.at(0)) == 0x1F);
+    CHECK_TRUE(static_cast<uint8_t>(gz_bytes.at(1)) == 0x8B);
+    CHECK_TRUE(static_cast<uint8_t>(gz_bytes.at(2)) == 0x08);
+    // Trailer: CRC-32 of the rendered plain text, then its size, both LE.
+    const auto read_u32_le = [&gz_bytes](size_t idx) {
+      return static_cast<uint32_t>(static_cast<uint8_t>(gz_bytes.at(idx))) |
+             (static_cast<uint32_t>(static_cast<uint8_t>(gz_bytes.at(idx + 1)))
+              << 8) |
+             (static_cast<uint32_t>(static_cast<uint8_t>(gz_bytes.at(idx + 2)))
+              << 16) |
+             (static_cast<uint32_t>(static_cast<uint8_t>(gz_bytes.at(idx + 3)))
+              << 24);
+    };
+    CHECK_TRUE(read_u32_le(gz_bytes.size() - 8) ==
+               PMA_GZIP::crc32(
+                   0, reinterpret_cast<const uint8_t *>(rendered.data()),
+                   rendered.size()));
+    CHECK_TRUE(read_u32_le(gz_bytes.size() - 4) == rendered.size());
+
+    // The iovec assembly must emit exactly the to_string() bytes.
+    std::string gz_scratch;
+    std::vector<struct iovec> gz_iovecs;
+    gz.fill_iovecs(values, gz_iovecs, gz_scratch);
+    std::string gz_joined;
+    for (const auto &iov : gz_iovecs) {
+      gz_joined.append(reinterpret_cast<const char *>(iov.iov_base),
+                       iov.iov_len);
+    }
+    CHECK_TRUE(gz_joined == gz_bytes);
+  }
+
+  // Test Metrics
+  {
+    Metrics &metrics = metrics_get();
+    metrics.record(Metrics::Stage::PARSE, std::chrono::microseconds(75));
+    metrics.record(Metrics::Stage::PARSE, std::chrono::microseconds(75));
+    metrics.record(Metrics::Stage::DB, std::chrono::seconds(10));
+    metrics.connection_started();
+    metrics.set_queue_depth_fn([]() { return size_t{7}; });
+
+    const std::string rendered = metrics.render();
+    CHECK_TRUE(rendered.find("pma_active_connections 1") != std::string::npos);
+    CHECK_TRUE(rendered.find("pma_thread_pool_queue_depth 7") !=
+               std::string::npos);
+    // Both 75us records fall in the le="100" bucket.
+    CHECK_TRUE(rendered.find(
+                   "pma_stage_parse_microseconds_bucket{le=\"100\"} 2") !=
+               std::string::npos);
+    CHECK_TRUE(rendered.find("pma_stage_parse_microseconds_count 2") !=
+               std::string::npos);
+    CHECK_TRUE(rendered.find("pma_stage_parse_microseconds_sum 150") !=
+               std::string::npos);
+    // 10s exceeds every bound; only the +Inf bucket holds it.
+    CHECK_TRUE(rendered.find(
+                   "pma_stage_db_microseconds_bucket{le=\"5000000\"} 0") !=
+               std::string::npos);
+    CHECK_TRUE(rendered.find(
+                   "pma_stage_db_microseconds_bucket{le=\"+Inf\"} 1") !=
+               std::string::npos);
+
+    metrics.connection_ended();
+  }
+
+  // test BackendPool
+  {
+    BackendPool pool(std::chrono::seconds(5), 2);
+    const auto now = std::chrono::steady_clock::now();
+    const std::string key = "127.0.0.1:8080";
+
+    // Empty pool has nothing to hand out.
+    CHECK_TRUE(pool.acquire(key, now) == -1);
+
+    // Release then acquire rides the same fd.
+    std::array<int, 2> pair_fds{-1, -1};
+    ASSERT_TRUE(socketpair(AF_UNIX, SOCK_STREAM, 0, pair_fds.data()) == 0);
+    pool.release(key, pair_fds[0], now);
+    CHECK_TRUE(pool.idle_count() == 1);
+    CHECK_TRUE(pool.acquire(key, now) == pair_fds[0]);
+    CHECK_TRUE(pool.idle_count() == 0);
+
+    // A connection whose peer closed fails validation on acquire.
+    pool.release(key, pair_fds[0], now);
+    close(pair_fds[1]);
+    CHECK_TRUE(pool.acquire(key, now) == -1);
+
+    // Pending data also fails validation; the fd must not be reused.
+    ASSERT_TRUE(socketpair(AF_UNIX, SOCK_STREAM, 0, pair_fds.data()) == 0);
+    CHECK_TRUE(write(pair_fds[1], "x", 1) == 1);
+    pool.release(key, pair_fds[0], now);
+    CHECK_TRUE(pool.idle_count() == 0);
+    close(pair_fds[1]);
+
+    // Entries past the idle timeout are skipped on acquire and pruned.
+    ASSERT_TRUE(socketpair(AF_UNIX, SOCK_STREAM, 0, pair_fds.data()) == 0);
+    pool.release(key, pair_fds[0], now);
+    CHECK_TRUE(pool.acquire(key, now + std::chrono::seconds(6)) == -1);
+    CHECK_TRUE(pool.idle_count() == 0);
+    close(pair_fds[1]);
+
+    // Per-key idle list is capped; overflow is closed, not pooled.
+    std::array<int, 2> second_pair_fds{-1, -1};
+    std::array<int, 2> third_pair_fds{-1, -1};
+    ASSERT_TRUE(socketpair(AF_UNIX, SOCK_STREAM, 0, pair_fds.data()) == 0);
+    ASSERT_TRUE(socketpair(AF_UNIX, SOCK_STREAM, 0, second_pair_fds.data()) ==
+                0);
+    ASSERT_TRUE(socketpair(AF_UNIX, SOCK_STREAM, 0, third_pair_fds.data()) ==
+                0);
+    pool.release(key, pair_fds[0], now);
+    pool.release(key, second_pair_fds[0], now);
+    pool.release(key, third_pair_fds[0], now);
+    CHECK_TRUE(pool.idle_count() == 2);
+
+    // prune() closes what idled out.
+    pool.prune(now + std::chrono::seconds(6));
+    CHECK_TRUE(pool.idle_count() == 0);
+    close(pair_fds[1]);
+    close(second_pair_fds[1]);
+    close(third_pair_fds[1]);
+  }
+
+  // test ThreadLimit::AdmissionQueue
+  {
+    ThreadLimit::AdmissionQueue queue(2);
+    const auto noop_fn = [](void *) {};
+    int first_marker = 0;
+    int second_marker = 0;
+
+    CHECK_TRUE(!queue.dequeue().has_value());
+    CHECK_TRUE(queue.enqueue(
+        std::make_tuple(noop_fn, &first_marker, noop_fn)));
+    CHECK_TRUE(queue.enqueue(
+        std::make_tuple(noop_fn, &second_marker, noop_fn)));
+    CHECK_TRUE(queue.size() == 2);
+
+    // Ring is bounded; a full ring rejects.
+    CHECK_TRUE(!queue.enqueue(std::make_tuple(noop_fn, nullptr, noop_fn)));
+
+    // FIFO order.
+    auto data_opt = queue.dequeue();
+    ASSERT_TRUE(data_opt.has_value());
+    CHECK_TRUE(std::get<1>(data_opt.value()) == &first_marker);
+    data_opt = queue.dequeue();
+    ASSERT_TRUE(data_opt.has_value());
+    CHECK_TRUE(std::get<1>(data_opt.value()) == &second_marker);
+    CHECK_TRUE(queue.size() == 0);
+
+    // Freed slots are reusable on the next lap.
+    CHECK_TRUE(queue.enqueue(std::make_tuple(noop_fn, nullptr, noop_fn)));
+    CHECK_TRUE(queue.dequeue().has_value());
+  }
+
+  // test ThreadLimit backpressure counters
+  {
+    std::atomic_bool release(false);
+    std::atomic_uint64_t done(0);
+    const auto blocking_fn = [&release](void *) {
+      while (!release.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    };
+    const auto done_fn = [&done](void *) { done.fetch_add(1); };
+
+    {
+      ThreadLimit limiter(1, 2);
+      // First admission runs immediately and holds the single active slot.
+      CHECK_TRUE(limiter.add_thread(blocking_fn, nullptr, done_fn));
+      CHECK_TRUE(limiter.active_count() == 1);
+      // Next two queue, third overflows the ring and is rejected.
+      CHECK_TRUE(limiter.add_thread(blocking_fn, nullptr, done_fn));
+      CHECK_TRUE(limiter.add_thread(blocking_fn, nullptr, done_fn));
+      CHECK_TRUE(limiter.queued_count() == 2);
+      CHECK_TRUE(!limiter.add_thread(blocking_fn, nullptr, done_fn));
+      CHECK_TRUE(limiter.rejected_count() == 1);
+
+      release.store(true);
+      // ~ThreadLimit waits for admitted work to finish.
+    }
+    CHECK_TRUE(done.load() == 3);
+  }
+
+  // Test compact binary answer codec.
+  {
+    // Varint round trips, including multi-byte and 64-bit values.
+    const std::array<uint64_t, 7> values = {
+        0, 1, 127, 128, 300, 0xFFFFFFFFull, 0xFFFFFFFFFFFFFFFFull};
+    for (const uint64_t value : values) {
+      std::vector<uint8_t> bytes;
+      PMA_HELPER::varint_append(value, bytes);
+      const auto [decoded, consumed] =
+          PMA_HELPER::varint_decode(bytes.data(), bytes.size());
+      CHECK_TRUE(decoded == value);
+      CHECK_TRUE(consumed == bytes.size());
+    }
+
+    // Truncated varint reports zero consumed.
+    {
+      const std::array<uint8_t, 2> truncated = {0x80, 0x80};
+      const auto [decoded, consumed] =
+          PMA_HELPER::varint_decode(truncated.data(), truncated.size());
+      CHECK_TRUE(consumed == 0);
+    }
+
+    // Base64 byte-wrapping round trips at every tail length.
+    for (size_t size = 0; size <= 9; ++size) {
+      std::vector<uint8_t> bytes;
+      for (size_t idx = 0; idx < size; ++idx) {
+        bytes.push_back(static_cast<uint8_t>(idx * 37 + 11));
+      }
+      const std::string b64 = PMA_HELPER::bytes_to_b64(bytes);
+      const auto decoded_opt = PMA_HELPER::b64_to_bytes(b64);
+      CHECK_TRUE(decoded_opt.has_value());
+      CHECK_TRUE(decoded_opt.value() == bytes);
+    }
+
+    // Invalid char and impossible length are rejected.
+    CHECK_TRUE(!PMA_HELPER::b64_to_bytes("AB=A").has_value());
+    CHECK_TRUE(!PMA_HELPER::b64_to_bytes("ABCDE").has_value());
+
+    // Compact answer decodes to the canonical factors string.
+    {
+      std::vector<uint8_t> bytes;
+      PMA_HELPER::varint_append(2, bytes);
+      PMA_HELPER::varint_append(3, bytes);
+      PMA_HELPER::varint_append(65537, bytes);
+      PMA_HELPER::varint_append(1, bytes);
+      const std::string b64 = PMA_HELPER::bytes_to_b64(bytes);
+      const auto str_opt = PMA_HELPER::compact_answer_to_factors_str(b64);
+      CHECK_TRUE(str_opt.has_value());
+      CHECK_TRUE(str_opt.value() == "2x3 65537x1");
+    }
+
+    // Empty and odd-pair payloads are malformed.
+    CHECK_TRUE(!PMA_HELPER::compact_answer_to_factors_str("").has_value());
+    {
+      std::vector<uint8_t> bytes;
+      PMA_HELPER::varint_append(2, bytes);
+      const std::string b64 = PMA_HELPER::bytes_to_b64(bytes);
+      CHECK_TRUE(
+          !PMA_HELPER::compact_answer_to_factors_str(b64).has_value());
+    }
+  }
+
+  // Test AssetCache.
+  {
+    const auto now = std::chrono::steady_clock::now();
+    AssetCache cache(std::chrono::seconds(5), 16);
+
+    CHECK_TRUE(!cache.lookup("80:/a.css", now).has_value());
+
+    cache.insert("80:/a.css", "text/css", "12345678", now);
+    auto hit_opt = cache.lookup("80:/a.css", now);
+    ASSERT_TRUE(hit_opt.has_value());
+    CHECK_TRUE(hit_opt.value().content_type == "text/css");
+    CHECK_TRUE(*hit_opt.value().body == "12345678");
+    CHECK_TRUE(cache.total_bytes() == 8);
+
+    // Expired entries miss and are erased.
+    CHECK_TRUE(
+        !cache.lookup("80:/a.css", now + std::chrono::seconds(6)).has_value());
+    CHECK_TRUE(cache.entry_count() == 0);
+
+    // The LRU entry is evicted when the byte cap is exceeded.
+    cache.insert("80:/a.css", "text/css", "12345678", now);
+    cache.insert("80:/b.js", "text/javascript", "1234", now);
+    CHECK_TRUE(cache.lookup("80:/a.css", now).has_value());
+    cache.insert("80:/c.png", "image/png", "123456", now);
+    CHECK_TRUE(cache.total_bytes() <= 16);
+    CHECK_TRUE(cache.lookup("80:/a.css", now).has_value());
+    CHECK_TRUE(!cache.lookup("80:/b.js", now).has_value());
+    CHECK_TRUE(cache.lookup("80:/c.png", now).has_value());
+
+    // Reinsert replaces in place.
+    cache.insert("80:/a.css", "text/css", "abcd", now);
+    hit_opt = cache.lookup("80:/a.css", now);
+    ASSERT_TRUE(hit_opt.has_value());
+    CHECK_TRUE(*hit_opt.value().body == "abcd");
+  }
+
+  // Test PeerSync over loopback.
+  {
+    std::mutex applied_mutex;
+    std::vector<std::tuple<std::string, uint16_t> > applied;
+
+    PeerSync receiver(PMA_ARGS::AddrPort{"127.0.0.1", 42171}, {},
+                      [&applied_mutex, &applied](const std::string &ip,
+                                                 uint16_t port) {
+                        std::unique_lock<std::mutex> lock(applied_mutex);
+                        applied.emplace_back(ip, port);
+                      });
+    ASSERT_TRUE(receiver.is_valid());
+
+    PeerSync sender(PMA_ARGS::AddrPort{"127.0.0.1", 42172},
+                    {PMA_ARGS::AddrPort{"127.0.0.1", 42171}},
+                    [](const std::string &, uint16_t) {});
+    ASSERT_TRUE(sender.is_valid());
+
+    sender.broadcast_allowed("10.1.2.3", 9001);
+    bool received = false;
+    for (int iter = 0; iter < 100 && !received; ++iter) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      std::unique_lock<std::mutex> lock(applied_mutex);
+      received = !applied.empty();
+    }
+    ASSERT_TRUE(received);
+    {
+      std::unique_lock<std::mutex> lock(applied_mutex);
+      CHECK_TRUE(std::get<0>(applied.at(0)) == "10.1.2.3");
+      CHECK_TRUE(std::get<1>(applied.at(0)) == 9001);
+    }
+  }
+
+  // Test DifficultyController.
+  {
+    DifficultyController controller;
+    CHECK_TRUE(controller.solve_ewma_milliseconds() == 0);
+
+    // No samples and no load leaves the base untouched.
+    CHECK_TRUE(controller.pick_quads(2200, 1100, 4400, 0) == 2200);
+
+    // Full connection pressure picks the top of the band.
+    CHECK_TRUE(controller.pick_quads(
+                   2200, 1100, 4400, DIFFICULTY_FULL_LOAD_CONNECTIONS) ==
+               4400);
+
+    // On-target solve times leave the base untouched.
+    controller.record_solve(
+        std::chrono::milliseconds(DIFFICULTY_TARGET_SOLVE_MILLISECONDS));
+    CHECK_TRUE(controller.solve_ewma_milliseconds() ==
+               DIFFICULTY_TARGET_SOLVE_MILLISECONDS);
+    CHECK_TRUE(controller.pick_quads(2200, 1100, 4400, 0) == 2200);
+
+    // Slow solvers lower difficulty, clamped to the band's bottom.
+    DifficultyController slow;
+    slow.record_solve(std::chrono::milliseconds(
+        DIFFICULTY_TARGET_SOLVE_MILLISECONDS * 10));
+    const uint64_t slow_quads = slow.pick_quads(2200, 1100, 4400, 0);
+    CHECK_TRUE(slow_quads == 1100);
+
+    // Fast solvers raise difficulty within the band.
+    DifficultyController fast;
+    fast.record_solve(std::chrono::milliseconds(
+        DIFFICULTY_TARGET_SOLVE_MILLISECONDS / 2));
+    const uint64_t fast_quads = fast.pick_quads(2200, 1100, 4400, 0);
+    CHECK_TRUE(fast_quads > 2200 && fast_quads <= 4400);
+
+    // The EWMA moves toward new samples instead of jumping.
+    DifficultyController ewma;
+    ewma.record_solve(std::chrono::milliseconds(1000));
+    ewma.record_solve(std::chrono::milliseconds(9000));
+    CHECK_TRUE(ewma.solve_ewma_milliseconds() > 1000);
+    CHECK_TRUE(ewma.solve_ewma_milliseconds() < 9000);
+  }
+
   PMA_Println("{} out of {} tests succeeded", test_succeeded.load(),
               test_count.load());
   return test_succeeded.load() == test_count.load() ? 0 : 1;
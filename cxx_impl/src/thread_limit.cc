@@ -22,8 +22,64 @@
 #include <cstdint>
 #include <thread>
 
+#include "constants.h"
 #include "poor_mans_print.h"
 
+ThreadLimit::AdmissionQueue::AdmissionQueue(size_t capacity)
+    : slots(), capacity_mask(0), enqueue_pos(0), dequeue_pos(0) {
+  size_t rounded = 1;
+  while (rounded < capacity) {
+    rounded <<= 1;
+  }
+  slots = std::make_unique<Slot[]>(rounded);
+  capacity_mask = rounded - 1;
+  for (size_t idx = 0; idx < rounded; ++idx) {
+    slots[idx].seq.store(idx, std::memory_order_relaxed);
+  }
+}
+
+bool ThreadLimit::AdmissionQueue::enqueue(ThreadLimit::ThreadData &&data) {
+  uint64_t pos = enqueue_pos.load(std::memory_order_relaxed);
+  while (true) {
+    Slot &slot = slots[pos & capacity_mask];
+    const uint64_t seq = slot.seq.load(std::memory_order_acquire);
+    const int64_t diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos);
+    if (diff == 0) {
+      if (enqueue_pos.compare_exchange_weak(pos, pos + 1,
+                                            std::memory_order_relaxed)) {
+        slot.data.emplace(std::move(data));
+        slot.seq.store(pos + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (diff < 0) {
+      // The slot one lap behind hasn't been consumed yet: ring is full.
+      return false;
+    } else {
+      pos = enqueue_pos.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+std::optional<ThreadLimit::ThreadData> ThreadLimit::AdmissionQueue::dequeue() {
+  const uint64_t pos = dequeue_pos.load(std::memory_order_relaxed);
+  Slot &slot = slots[pos & capacity_mask];
+  const uint64_t seq = slot.seq.load(std::memory_order_acquire);
+  if (seq != pos + 1) {
+    return std::nullopt;
+  }
+  ThreadData data = std::move(slot.data.value());
+  slot.data.reset();
+  slot.seq.store(pos + capacity_mask + 1, std::memory_order_release);
+  dequeue_pos.store(pos + 1, std::memory_order_relaxed);
+  return data;
+}
+
+size_t ThreadLimit::AdmissionQueue::size() const {
+  const uint64_t enq = enqueue_pos.load(std::memory_order_relaxed);
+  const uint64_t deq = dequeue_pos.load(std::memory_order_relaxed);
+  return enq > deq ? static_cast<size_t>(enq - deq) : 0;
+}
+
 void internal_thread_function(std::function<void(void *)> fn, void *user_data,
                               std::function<void(void *)> cleanup_fn,
                               std::shared_ptr<std::atomic_uint64_t> counter,
@@ -48,31 +104,42 @@ void internal_manager_function(
     const uint64_t limit, std::shared_ptr<std::atomic_uint64_t> counter,
     std::shared_ptr<std::condition_variable> cv,
     std::shared_ptr<std::atomic_bool> stop_flag,
-    std::shared_ptr<std::mutex> data_mutex,
-    std::shared_ptr<std::list<ThreadLimit::ThreadData> > overflow_data) {
-  std::unique_lock<std::mutex> lock(*data_mutex);
+    std::shared_ptr<std::mutex> wake_mutex,
+    std::shared_ptr<ThreadLimit::AdmissionQueue> overflow_queue) {
   while (!stop_flag->load()) {
-    while (counter->load() < limit && !overflow_data->empty()) {
-      ThreadLimit::ThreadData data = std::move(overflow_data->front());
-      overflow_data->pop_front();
+    while (counter->load() < limit) {
+      std::optional<ThreadLimit::ThreadData> data_opt =
+          overflow_queue->dequeue();
+      if (!data_opt.has_value()) {
+        break;
+      }
 
       ++(*counter);
       std::thread new_thread(internal_thread_function,
-                             std::move(std::get<0>(data)), std::get<1>(data),
-                             std::move(std::get<2>(data)), counter, cv);
+                             std::move(std::get<0>(data_opt.value())),
+                             std::get<1>(data_opt.value()),
+                             std::move(std::get<2>(data_opt.value())), counter,
+                             cv);
       new_thread.detach();
     }
 
-    cv->wait(lock);
+    // The wait has a timeout since producers notify without holding
+    // wake_mutex (the queue is lock-free), so a notify can race this wait.
+    std::unique_lock<std::mutex> lock(*wake_mutex);
+    cv->wait_for(lock, SLEEP_MILLISECONDS_CHRONO);
   }
 }
 
 ThreadLimit::ThreadLimit(uint64_t limit)
+    : ThreadLimit(limit, THREAD_LIMIT_QUEUE_CAPACITY) {}
+
+ThreadLimit::ThreadLimit(uint64_t limit, size_t queue_capacity)
     : counter(std::make_shared<std::atomic_uint64_t>(0)),
+      rejected(std::make_shared<std::atomic_uint64_t>(0)),
       cv(std::make_shared<std::condition_variable>()),
       stop_flag(std::make_shared<std::atomic_bool>(false)),
-      data_mutex(std::make_shared<std::mutex>()),
-      overflow_data(std::make_shared<std::list<ThreadLimit::ThreadData> >()),
+      wake_mutex(std::make_shared<std::mutex>()),
+      overflow_queue(std::make_shared<AdmissionQueue>(queue_capacity)),
       internal_manager_thread(),
       limit(limit) {
   if (this->limit == 0) {
@@ -80,7 +147,7 @@ ThreadLimit::ThreadLimit(uint64_t limit)
   }
   internal_manager_thread = std::make_shared<std::thread>(
       internal_manager_function, this->limit, counter, cv, stop_flag,
-      data_mutex, overflow_data);
+      wake_mutex, overflow_queue);
 }
 
 ThreadLimit::~ThreadLimit() {
@@ -92,11 +159,14 @@ ThreadLimit::~ThreadLimit() {
   cv->notify_all();
   internal_manager_thread->join();
 
-  if (overflow_data) {
-    for (auto iter = overflow_data->begin(); iter != overflow_data->end();
-         ++iter) {
+  if (overflow_queue) {
+    while (true) {
+      std::optional<ThreadData> data_opt = overflow_queue->dequeue();
+      if (!data_opt.has_value()) {
+        break;
+      }
       try {
-        std::get<2> (*iter)(std::get<1>(*iter));
+        std::get<2>(data_opt.value())(std::get<1>(data_opt.value()));
       } catch (const std::exception &e) {
         PMA_EPrintln(
             "WARNING: cleanup during ~ThreadLimit() threw exception: {}",
@@ -114,17 +184,19 @@ ThreadLimit::~ThreadLimit() {
 
 ThreadLimit::ThreadLimit(ThreadLimit &&other)
     : counter(other.counter),
+      rejected(other.rejected),
       cv(other.cv),
       stop_flag(other.stop_flag),
-      data_mutex(other.data_mutex),
-      overflow_data(other.overflow_data),
+      wake_mutex(other.wake_mutex),
+      overflow_queue(other.overflow_queue),
       internal_manager_thread(other.internal_manager_thread),
       limit(other.limit) {
   other.counter.reset();
+  other.rejected.reset();
   other.cv.reset();
   other.stop_flag.reset();
-  other.data_mutex.reset();
-  other.overflow_data.reset();
+  other.wake_mutex.reset();
+  other.overflow_queue.reset();
   other.internal_manager_thread.reset();
 }
 
@@ -139,11 +211,14 @@ ThreadLimit &ThreadLimit::operator=(ThreadLimit &&other) {
     }
   }
 
-  if (overflow_data) {
-    for (auto iter = overflow_data->begin(); iter != overflow_data->end();
-         ++iter) {
+  if (overflow_queue) {
+    while (true) {
+      std::optional<ThreadData> data_opt = overflow_queue->dequeue();
+      if (!data_opt.has_value()) {
+        break;
+      }
       try {
-        std::get<2> (*iter)(std::get<1>(*iter));
+        std::get<2>(data_opt.value())(std::get<1>(data_opt.value()));
       } catch (const std::exception &e) {
         PMA_EPrintln(
             "WARNING: cleanup during ThreadLimit::operator= threw exception: "
@@ -155,32 +230,44 @@ ThreadLimit &ThreadLimit::operator=(ThreadLimit &&other) {
 
   limit = other.limit;
   counter = other.counter;
+  rejected = other.rejected;
   cv = other.cv;
   stop_flag = other.stop_flag;
-  data_mutex = other.data_mutex;
-  overflow_data = other.overflow_data;
+  wake_mutex = other.wake_mutex;
+  overflow_queue = other.overflow_queue;
   internal_manager_thread = other.internal_manager_thread;
 
   other.counter.reset();
+  other.rejected.reset();
   other.cv.reset();
   other.stop_flag.reset();
-  other.data_mutex.reset();
-  other.overflow_data.reset();
+  other.wake_mutex.reset();
+  other.overflow_queue.reset();
   other.internal_manager_thread.reset();
 
   return *this;
 }
 
-void ThreadLimit::add_thread(std::function<void(void *)> fn, void *user_data,
+bool ThreadLimit::add_thread(std::function<void(void *)> fn, void *user_data,
                              std::function<void(void *)> cleanup_fn) {
   if (counter->load(std::memory_order_acquire) >= limit) {
-    std::lock_guard<std::mutex> lock(*this->data_mutex);
-    overflow_data->push_back(
-        std::make_tuple(std::move(fn), user_data, std::move(cleanup_fn)));
+    if (!overflow_queue->enqueue(
+            std::make_tuple(std::move(fn), user_data, std::move(cleanup_fn)))) {
+      rejected->fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    cv->notify_all();
   } else {
     ++(*counter);
     std::thread new_thread(internal_thread_function, std::move(fn), user_data,
                            std::move(cleanup_fn), counter, cv);
     new_thread.detach();
   }
+  return true;
 }
+
+uint64_t ThreadLimit::active_count() const { return counter->load(); }
+
+uint64_t ThreadLimit::queued_count() const { return overflow_queue->size(); }
+
+uint64_t ThreadLimit::rejected_count() const { return rejected->load(); }
@@ -20,16 +20,51 @@
 #include <atomic>
 #include <condition_variable>
 #include <functional>
-#include <list>
 #include <memory>
 #include <mutex>
+#include <optional>
 
 class ThreadLimit {
  public:
   using ThreadData = std::tuple<std::function<void(void *)>, void *,
                                 std::function<void(void *)> >;
 
+  /// Bounded lock-free ring holding overflow work: multiple accept/producer
+  /// threads enqueue, only the manager thread dequeues. Each slot carries a
+  /// sequence number (Vyukov-style) so producers claim slots with a single
+  /// CAS and never take a lock or allocate per enqueue.
+  class AdmissionQueue {
+   public:
+    /// Capacity is rounded up to a power of two.
+    AdmissionQueue(size_t capacity);
+
+    // disallow copy
+    AdmissionQueue(const AdmissionQueue &) = delete;
+    AdmissionQueue &operator=(const AdmissionQueue &) = delete;
+
+    /// Multi-producer safe. Returns false when the ring is full (caller
+    /// sheds the work).
+    bool enqueue(ThreadData &&data);
+
+    /// Single consumer only.
+    std::optional<ThreadData> dequeue();
+
+    size_t size() const;
+
+   private:
+    struct Slot {
+      std::atomic_uint64_t seq;
+      std::optional<ThreadData> data;
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    uint64_t capacity_mask;
+    std::atomic_uint64_t enqueue_pos;
+    std::atomic_uint64_t dequeue_pos;
+  };
+
   ThreadLimit(uint64_t limit);
+  ThreadLimit(uint64_t limit, size_t queue_capacity);
   ~ThreadLimit();
 
   // disallow copy
@@ -40,15 +75,25 @@ class ThreadLimit {
   ThreadLimit(ThreadLimit &&);
   ThreadLimit &operator=(ThreadLimit &&);
 
-  void add_thread(std::function<void(void *)> fn, void *user_data,
+  /// Returns false when the admission queue is full and the work was NOT
+  /// accepted (the caller owns user_data again and should respond with
+  /// backpressure, e.g. 503). Rejections are counted.
+  bool add_thread(std::function<void(void *)> fn, void *user_data,
                   std::function<void(void *)> cleanup_fn);
 
+  uint64_t active_count() const;
+  uint64_t queued_count() const;
+  uint64_t rejected_count() const;
+
  private:
   std::shared_ptr<std::atomic_uint64_t> counter;
+  std::shared_ptr<std::atomic_uint64_t> rejected;
   std::shared_ptr<std::condition_variable> cv;
   std::shared_ptr<std::atomic_bool> stop_flag;
-  std::shared_ptr<std::mutex> data_mutex;
-  std::shared_ptr<std::list<ThreadData> > overflow_data;
+  // Only guards the cv wait in the manager thread; the overflow queue
+  // itself is lock-free.
+  std::shared_ptr<std::mutex> wake_mutex;
+  std::shared_ptr<AdmissionQueue> overflow_queue;
   std::shared_ptr<std::thread> internal_manager_thread;
   uint64_t limit;
 };
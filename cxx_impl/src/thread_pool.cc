@@ -17,69 +17,77 @@
 #include "thread_pool.h"
 
 // Standard library includes
+#include <chrono>
 #include <optional>
 
 // Local includes
 #include "constants.h"
 #include "poor_mans_print.h"
 
-void ThreadPool::thread_function(
-    std::shared_ptr<std::atomic_bool> stop,
-    std::shared_ptr<CondVarTuple> cond_var,
-    std::shared_ptr<ThreadPool::PendingFnVec> pending_fns) {
-  std::optional<std::function<void(void *)> > fn = std::nullopt;
-  std::optional<void *> ud = std::nullopt;
-  std::optional<std::function<void(void *)> > cleanup_fn = std::nullopt;
-
-  std::unique_lock<std::mutex> lock(std::get<std::mutex>(*cond_var),
-                                    std::defer_lock);
+void ThreadPool::thread_function(uint32_t worker_idx,
+                                 std::shared_ptr<std::atomic_bool> stop,
+                                 std::shared_ptr<CondVarTuple> cond_var,
+                                 std::shared_ptr<WorkerQueues> queues) {
+  std::optional<PendingFn> pending = std::nullopt;
 
   while (!stop->load(std::memory_order_acquire)) {
-    if (!lock.owns_lock()) {
-      lock.lock();
-    }
-
-    if (pending_fns->empty()) {
-      std::get<std::condition_variable>(*cond_var).wait(lock);
+    // Pop from the back of this worker's own queue first.
+    {
+      WorkerQueue &own = *queues->at(worker_idx);
+      std::unique_lock<std::mutex> own_lock(own.mutex);
+      if (!own.fns.empty()) {
+        pending = std::move(own.fns.back());
+        own.fns.pop_back();
+      }
     }
 
-    if (!pending_fns->empty()) {
-      fn = std::move(std::get<0>(pending_fns->back()));
-      ud = std::get<1>(pending_fns->back());
-      cleanup_fn = std::move(std::get<2>(pending_fns->back()));
-      pending_fns->pop_back();
+    // Steal from the front of another worker's queue if idle.
+    if (!pending.has_value()) {
+      for (uint32_t offset = 1; offset < queues->size(); ++offset) {
+        WorkerQueue &other =
+            *queues->at((worker_idx + offset) % queues->size());
+        std::unique_lock<std::mutex> other_lock(other.mutex, std::try_to_lock);
+        if (other_lock.owns_lock() && !other.fns.empty()) {
+          pending = std::move(other.fns.front());
+          other.fns.pop_front();
+          break;
+        }
+      }
     }
 
-    if (fn.has_value() && ud.has_value() && cleanup_fn.has_value()) {
-      lock.unlock();
-
+    if (pending.has_value()) {
       try {
-        fn.value()(ud.value());
+        std::get<0>(pending.value())(std::get<1>(pending.value()));
       } catch (const std::exception &e) {
         PMA_EPrintln("WARNING: Thread threw exception during execution: {}",
                      e.what());
       }
       try {
-        cleanup_fn.value()(ud.value());
+        std::get<2>(pending.value())(std::get<1>(pending.value()));
       } catch (const std::exception &e) {
         PMA_EPrintln("WARNING: Thread threw exception during cleanup: {}",
                      e.what());
       }
 
-      fn = std::nullopt;
-      ud = std::nullopt;
-      cleanup_fn = std::nullopt;
+      pending = std::nullopt;
+    } else {
+      // The timed wait bounds how long a missed notify (or stealable work
+      // in another queue) can go unnoticed.
+      std::unique_lock<std::mutex> lock(std::get<std::mutex>(*cond_var));
+      std::get<std::condition_variable>(*cond_var)
+          .wait_for(lock, std::chrono::milliseconds(100));
     }
   }
 }
 
 ThreadPool::ThreadPool()
-    : pending_fns(std::make_shared<PendingFnVec>()),
+    : queues(std::make_shared<WorkerQueues>()),
       stop_var(std::make_shared<std::atomic_bool>(false)),
-      cond_var(std::make_shared<CondVarTuple>()) {}
+      cond_var(std::make_shared<CondVarTuple>()),
+      next_queue_idx(std::make_shared<std::atomic_uint32_t>(0)) {}
 
 ThreadPool::~ThreadPool() {
-  if (!stop_var || !cond_var || !pending_fns) {
+  if (!stop_var || !cond_var || !queues) {
     return;
   }
   stop_var->store(true, std::memory_order_release);
@@ -90,20 +98,23 @@ ThreadPool::~ThreadPool() {
     iter->join();
   }
 
-  for (auto iter = pending_fns->begin(); iter != pending_fns->end(); ++iter) {
-    // Call cleanup_fn on userdata.
-    std::get<2> (*iter)(std::get<1>(*iter));
+  for (auto &queue : *queues) {
+    for (auto iter = queue->fns.begin(); iter != queue->fns.end(); ++iter) {
+      // Call cleanup_fn on userdata.
+      std::get<2> (*iter)(std::get<1>(*iter));
+    }
   }
 }
 
 ThreadPool::ThreadPool(ThreadPool &&other)
     : thread_handles(std::move(other.thread_handles)),
-      pending_fns(std::move(other.pending_fns)),
+      queues(std::move(other.queues)),
       stop_var(std::move(other.stop_var)),
-      cond_var(std::move(other.cond_var)) {}
+      cond_var(std::move(other.cond_var)),
+      next_queue_idx(std::move(other.next_queue_idx)) {}
 
 ThreadPool &ThreadPool::operator=(ThreadPool &&other) {
-  if (stop_var && cond_var && pending_fns) {
+  if (stop_var && cond_var && queues) {
     stop_var->store(true, std::memory_order_release);
     std::get<std::condition_variable>(*cond_var).notify_all();
 
@@ -115,19 +126,24 @@ ThreadPool &ThreadPool::operator=(ThreadPool &&other) {
     thread_handles.clear();
 
     thread_handles = std::move(other.thread_handles);
-    {
-      std::unique_lock<std::mutex> lock(std::get<0>(*other.cond_var));
-      // thread_handles in "other" has a reference to "other.pending_fns".
-      // Populate "other.pending_fns" with still-not-executed fns.
-      while (!pending_fns->empty()) {
-        other.pending_fns->push_back(std::move(pending_fns->back()));
-        pending_fns->pop_back();
+    if (!other.queues->empty()) {
+      // thread_handles in "other" has a reference to "other.queues".
+      // Populate "other.queues" with still-not-executed fns.
+      for (auto &queue : *queues) {
+        while (!queue->fns.empty()) {
+          WorkerQueue &other_queue = *other.queues->at(
+              other.next_queue_idx->fetch_add(1) % other.queues->size());
+          std::unique_lock<std::mutex> lock(other_queue.mutex);
+          other_queue.fns.push_back(std::move(queue->fns.back()));
+          queue->fns.pop_back();
+        }
       }
     }
   }
-  pending_fns = std::move(other.pending_fns);
+  queues = std::move(other.queues);
   stop_var = std::move(other.stop_var);
   cond_var = std::move(other.cond_var);
+  next_queue_idx = std::move(other.next_queue_idx);
 
   return *this;
 }
@@ -143,26 +159,60 @@ void ThreadPool::set_thread_count(uint32_t count) {
 
   thread_handles.clear();
 
+  if (count == 0) {
+    count = 1;
+  }
+
+  // Keep still-not-executed fns from the old queues.
+  std::deque<PendingFn> leftovers;
+  for (auto &queue : *queues) {
+    while (!queue->fns.empty()) {
+      leftovers.push_back(std::move(queue->fns.front()));
+      queue->fns.pop_front();
+    }
+  }
+
   stop_var = std::make_shared<std::atomic_bool>(false);
   cond_var = std::make_shared<CondVarTuple>();
+  queues = std::make_shared<WorkerQueues>();
+  for (uint32_t idx = 0; idx < count; ++idx) {
+    queues->push_back(std::make_unique<WorkerQueue>());
+  }
+
+  while (!leftovers.empty()) {
+    queues->at(next_queue_idx->fetch_add(1) % count)
+        ->fns.push_back(std::move(leftovers.front()));
+    leftovers.pop_front();
+  }
 
   for (uint32_t idx = 0; idx < count; ++idx) {
-    thread_handles.emplace_back(thread_function, stop_var, cond_var,
-                                pending_fns);
+    thread_handles.emplace_back(thread_function, idx, stop_var, cond_var,
+                                queues);
   }
 }
 
 void ThreadPool::add_func(std::function<void(void *)> fn, void *user_data,
                           std::function<void(void *)> cleanup_fn) {
+  if (thread_handles.empty()) {
+    // Handle the case of "set_thread_count(...)" not being called before this.
+    set_thread_count(DEFAULT_THREAD_COUNT);
+  }
+
+  WorkerQueue &queue =
+      *queues->at(next_queue_idx->fetch_add(1) % queues->size());
   {
-    std::unique_lock<std::mutex> lock(std::get<std::mutex>(*cond_var));
-    pending_fns->push_back(
+    std::unique_lock<std::mutex> lock(queue.mutex);
+    queue.fns.push_back(
         std::make_tuple(std::move(fn), user_data, std::move(cleanup_fn)));
   }
   std::get<std::condition_variable>(*cond_var).notify_one();
+}
 
-  if (thread_handles.empty()) {
-    // Handle the case of "set_thread_count(...)" not being called before this.
-    set_thread_count(DEFAULT_THREAD_COUNT);
+size_t ThreadPool::pending_count() const {
+  size_t total = 0;
+  for (const auto &queue : *queues) {
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    total += queue->fns.size();
   }
+  return total;
 }
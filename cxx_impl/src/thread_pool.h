@@ -20,6 +20,7 @@
 #include <atomic>
 #include <condition_variable>
 #include <cstdint>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <thread>
@@ -43,20 +44,33 @@ class ThreadPool {
   void add_func(std::function<void(void *)> fn, void *user_data,
                 std::function<void(void *)> cleanup_fn);
 
+  /// Number of queued (not yet running) fns across all workers.
+  size_t pending_count() const;
+
  private:
-  using PendingFnVec =
-      std::vector<std::tuple<std::function<void(void *)>, void *,
-                             std::function<void(void *)> > >;
+  using PendingFn = std::tuple<std::function<void(void *)>, void *,
+                               std::function<void(void *)> >;
   using CondVarTuple = std::tuple<std::mutex, std::condition_variable>;
 
-  static void thread_function(std::shared_ptr<std::atomic_bool> stop_var,
+  // Each worker owns one queue. Workers pop from the back of their own
+  // queue and steal from the front of other workers' queues, so add_func
+  // only contends on a single worker's mutex instead of one global lock.
+  struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<PendingFn> fns;
+  };
+  using WorkerQueues = std::vector<std::unique_ptr<WorkerQueue> >;
+
+  static void thread_function(uint32_t worker_idx,
+                              std::shared_ptr<std::atomic_bool> stop_var,
                               std::shared_ptr<CondVarTuple> cond_var,
-                              std::shared_ptr<PendingFnVec> pending_fns);
+                              std::shared_ptr<WorkerQueues> queues);
 
   std::vector<std::thread> thread_handles;
-  std::shared_ptr<PendingFnVec> pending_fns;
+  std::shared_ptr<WorkerQueues> queues;
   std::shared_ptr<std::atomic_bool> stop_var;
   std::shared_ptr<CondVarTuple> cond_var;
+  std::shared_ptr<std::atomic_uint32_t> next_queue_idx;
 };
 
 #endif
@@ -0,0 +1,66 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "ttl_cache.h"
+
+// Standard library includes
+#include <functional>
+
+TTLCache::TTLCache() : TTLCache(std::chrono::seconds(0), 1) {}
+
+TTLCache::TTLCache(std::chrono::seconds ttl, size_t shard_count)
+    : ttl(ttl),
+      shards(std::make_shared<std::vector<Shard> >(
+          shard_count >= 1 ? shard_count : 1)),
+      prune_idx(std::make_shared<std::atomic_size_t>(0)) {}
+
+bool TTLCache::check(const std::string &key, TimePoint now) {
+  Shard &shard = shard_for(key);
+  std::unique_lock<std::mutex> lock(shard.mutex);
+  auto iter = shard.map.find(key);
+  if (iter == shard.map.end()) {
+    return false;
+  } else if (now - iter->second > ttl) {
+    shard.map.erase(iter);
+    return false;
+  }
+  return true;
+}
+
+void TTLCache::insert(const std::string &key, TimePoint now) {
+  Shard &shard = shard_for(key);
+  std::unique_lock<std::mutex> lock(shard.mutex);
+  shard.map.insert_or_assign(key, now);
+}
+
+void TTLCache::prune_next_shard(TimePoint now) {
+  const size_t idx = prune_idx->fetch_add(1) % shards->size();
+  Shard &shard = shards->at(idx);
+  std::unique_lock<std::mutex> lock(shard.mutex);
+  for (auto iter = shard.map.begin(); iter != shard.map.end();) {
+    if (now - iter->second > ttl) {
+      iter = shard.map.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+}
+
+size_t TTLCache::get_shard_count() const { return shards->size(); }
+
+TTLCache::Shard &TTLCache::shard_for(const std::string &key) {
+  return shards->at(std::hash<std::string>{}(key) % shards->size());
+}
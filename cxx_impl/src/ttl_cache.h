@@ -0,0 +1,70 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef SEODISPARATE_COM_POOR_MANS_ANUBIS_TTL_CACHE_H_
+#define SEODISPARATE_COM_POOR_MANS_ANUBIS_TTL_CACHE_H_
+
+// Standard library includes
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// TTL cache sharded by key hash, each shard with its own lock, so
+/// concurrent connection handlers only contend when they hash to the same
+/// shard. Entries expire incrementally: lazily on lookup and one shard at a
+/// time via prune_next_shard(), so there is never a full-cache clear.
+class TTLCache {
+ public:
+  using TimePoint = std::chrono::time_point<std::chrono::steady_clock>;
+
+  TTLCache();
+  TTLCache(std::chrono::seconds ttl, size_t shard_count);
+
+  // Copies share the same shards.
+
+  /// Returns true if the key is cached and unexpired. Erases the entry if it
+  /// has expired.
+  bool check(const std::string &key, TimePoint now);
+
+  /// Inserts or refreshes an entry.
+  void insert(const std::string &key, TimePoint now);
+
+  /// Removes expired entries from a single shard, rotating through the
+  /// shards on successive calls. Calling this shard_count times amounts to a
+  /// full sweep.
+  void prune_next_shard(TimePoint now);
+
+  size_t get_shard_count() const;
+
+ private:
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<std::string, TimePoint> map;
+  };
+
+  Shard &shard_for(const std::string &key);
+
+  std::chrono::seconds ttl;
+  std::shared_ptr<std::vector<Shard> > shards;
+  std::shared_ptr<std::atomic_size_t> prune_idx;
+};
+
+#endif